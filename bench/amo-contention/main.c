@@ -0,0 +1,49 @@
+#include "bench.h"
+
+/*
+ * All harts increment shared counters, once with amoadd.w and once with a
+ * lr.w/sc.w retry loop. On multi-hart platforms this exercises the bus lock
+ * and the reservation handling, on single-hart platforms the plain cost of
+ * the atomic instructions.
+ */
+
+#ifndef ITERATIONS
+#define ITERATIONS 50000
+#endif
+
+static volatile uint32_t amo_counter;
+static volatile uint32_t lrsc_counter;
+static volatile uint32_t done;
+
+static void run(void) {
+	for (unsigned i = 0; i < ITERATIONS; ++i) {
+		__atomic_fetch_add(&amo_counter, 1, __ATOMIC_RELAXED);
+
+		uint32_t tmp, fail;
+		asm volatile(
+		    "1: lr.w %0, (%2)\n"
+		    "addi %0, %0, 1\n"
+		    "sc.w %1, %0, (%2)\n"
+		    "bnez %1, 1b\n"
+		    : "=&r"(tmp), "=&r"(fail)
+		    : "r"(&lrsc_counter)
+		    : "memory");
+	}
+	__atomic_fetch_add(&done, 1, __ATOMIC_RELEASE);
+}
+
+void bench_secondary(unsigned hart) {
+	(void)hart;
+	run();
+}
+
+int main(void) {
+	unsigned harts = bench_harts();
+
+	run();
+	while (done < harts)
+		;
+
+	// the counters must not lose any update
+	return amo_counter != harts * ITERATIONS || lrsc_counter != harts * ITERATIONS;
+}
@@ -0,0 +1,88 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/*
+ * Minimal runtime of the benchmark programs: no C library, the programs only
+ * talk to the CLINT and the syscall device, both of which all platforms map
+ * at the same addresses.
+ */
+
+#define SYSCALL_ADDR 0x02010000
+#define CLINT_BASE 0x02000000
+#define CLINT_MTIMECMP (CLINT_BASE + 0x4000)
+#define CLINT_MTIME (CLINT_BASE + 0xbff8)
+
+#define SYS_WRITE 64
+#define SYS_EXIT 93
+
+// all randomness is derived from this seed to get reproducible runs
+#ifndef SEED
+#define SEED 0x2545f491
+#endif
+
+// incremented by every hart in bootstrap.S
+extern volatile uint32_t bench_num_harts;
+
+static inline unsigned bench_hart_id(void) {
+	unsigned long id;
+	asm volatile("csrr %0, mhartid" : "=r"(id));
+	return id;
+}
+
+// the syscall device reads the arguments from the registers of the hart
+// whose id is written to it and returns the result in a0
+static inline long bench_syscall(long n, long arg0, long arg1, long arg2) {
+	register long a0 asm("a0") = arg0;
+	register long a1 asm("a1") = arg1;
+	register long a2 asm("a2") = arg2;
+	register long a7 asm("a7") = n;
+	asm volatile(
+	    "csrr t0, mhartid\n"
+	    "sw t0, 0(%[sys])\n"
+	    : "+r"(a0)
+	    : "r"(a1), "r"(a2), "r"(a7), [sys] "r"(SYSCALL_ADDR)
+	    : "t0", "memory");
+	return a0;
+}
+
+// NOTE: stops the whole simulation, i.e. all harts
+static inline void __attribute__((noreturn)) bench_exit(int code) {
+	bench_syscall(SYS_EXIT, code, 0, 0);
+	for (;;)
+		;
+}
+
+static inline long bench_write(const void *buf, unsigned long len) {
+	return bench_syscall(SYS_WRITE, 1, (long)buf, len);
+}
+
+static inline uint64_t bench_mtime(void) {
+	volatile uint32_t *mtime = (volatile uint32_t *)CLINT_MTIME;
+	uint32_t hi, lo;
+	do {
+		hi = mtime[1];
+		lo = mtime[0];
+	} while (hi != mtime[1]);
+	return ((uint64_t)hi << 32) | lo;
+}
+
+// number of harts running the program, called by hart 0 after giving the
+// other harts some time to start up
+static inline unsigned bench_harts(void) {
+	for (volatile unsigned i = 0; i < 10000; ++i)
+		;
+	return bench_num_harts;
+}
+
+// xorshift32, cheap and identical on rv32 and rv64
+static inline uint32_t bench_rand(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+#endif
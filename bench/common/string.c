@@ -0,0 +1,21 @@
+#include <stddef.h>
+
+/*
+ * The compiler may emit calls to these for struct copies and initializations,
+ * even in freestanding code.
+ */
+
+void *memset(void *dst, int c, size_t n) {
+	unsigned char *d = dst;
+	while (n--)
+		*d++ = c;
+	return dst;
+}
+
+void *memcpy(void *dst, const void *src, size_t n) {
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	while (n--)
+		*d++ = *s++;
+	return dst;
+}
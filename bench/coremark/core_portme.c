@@ -0,0 +1,147 @@
+#include <stdarg.h>
+
+#include "bench.h"
+#include "coremark.h"
+
+#if VALIDATION_RUN
+volatile ee_s32 seed1_volatile = 0x3415;
+volatile ee_s32 seed2_volatile = 0x3415;
+volatile ee_s32 seed3_volatile = 0x66;
+#endif
+#if PERFORMANCE_RUN
+volatile ee_s32 seed1_volatile = 0x0;
+volatile ee_s32 seed2_volatile = 0x0;
+volatile ee_s32 seed3_volatile = 0x66;
+#endif
+#if PROFILE_RUN
+volatile ee_s32 seed1_volatile = 0x8;
+volatile ee_s32 seed2_volatile = 0x8;
+volatile ee_s32 seed3_volatile = 0x8;
+#endif
+volatile ee_s32 seed4_volatile = ITERATIONS;
+volatile ee_s32 seed5_volatile = 0;
+
+// mtime counts microseconds
+#define EE_TICKS_PER_SEC 1000000
+
+static CORETIMETYPE start_time_val, stop_time_val;
+
+void start_time(void) {
+	start_time_val = bench_mtime();
+}
+
+void stop_time(void) {
+	stop_time_val = bench_mtime();
+}
+
+CORE_TICKS get_time(void) {
+	return stop_time_val - start_time_val;
+}
+
+secs_ret time_in_secs(CORE_TICKS ticks) {
+	return ticks / EE_TICKS_PER_SEC;
+}
+
+ee_u32 default_num_contexts = 1;
+
+void portable_init(core_portable *p, int *argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+	if (sizeof(ee_ptr_int) != sizeof(ee_u8 *))
+		ee_printf("ERROR! Please define ee_ptr_int to a type that holds a pointer!\n");
+	if (sizeof(ee_u32) != 4)
+		ee_printf("ERROR! Please define ee_u32 to a 32b unsigned type!\n");
+	p->portable_id = 1;
+}
+
+void portable_fini(core_portable *p) {
+	p->portable_id = 0;
+}
+
+/*
+ * Minimal printf for the CoreMark report: %d %i %u %x %X %s %c with optional
+ * zero padding, field width and l modifier. Output is line buffered.
+ */
+
+static char line[128];
+static unsigned line_len;
+
+static void put(char c) {
+	line[line_len++] = c;
+	if (c == '\n' || line_len == sizeof(line)) {
+		bench_write(line, line_len);
+		line_len = 0;
+	}
+}
+
+static void put_number(unsigned long n, unsigned base, int negative, unsigned width, char pad, int upper) {
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char buf[24];
+	unsigned len = 0;
+
+	do {
+		buf[len++] = digits[n % base];
+		n /= base;
+	} while (n);
+	if (negative)
+		buf[len++] = '-';
+	while (len < width)
+		put(pad), --width;
+	while (len)
+		put(buf[--len]);
+}
+
+int ee_printf(const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+
+	for (; *fmt; ++fmt) {
+		if (*fmt != '%') {
+			put(*fmt);
+			continue;
+		}
+
+		char pad = ' ';
+		unsigned width = 0;
+		int is_long = 0;
+		if (*++fmt == '0')
+			pad = '0', ++fmt;
+		while (*fmt >= '0' && *fmt <= '9')
+			width = width * 10 + (*fmt++ - '0');
+		while (*fmt == 'l')
+			is_long = 1, ++fmt;
+
+		switch (*fmt) {
+			case 'd':
+			case 'i': {
+				long n = is_long ? va_arg(args, long) : va_arg(args, int);
+				put_number(n < 0 ? -(unsigned long)n : (unsigned long)n, 10, n < 0, width, pad, 0);
+				break;
+			}
+			case 'u':
+				put_number(is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned), 10, 0, width, pad, 0);
+				break;
+			case 'x':
+			case 'X':
+				put_number(is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned), 16, 0, width, pad,
+				           *fmt == 'X');
+				break;
+			case 's':
+				for (const char *s = va_arg(args, const char *); *s; ++s)
+					put(*s);
+				break;
+			case 'c':
+				put(va_arg(args, int));
+				break;
+			case '\0':
+				--fmt;
+				break;
+			default:
+				put(*fmt);
+				break;
+		}
+	}
+
+	va_end(args);
+	return 0;
+}
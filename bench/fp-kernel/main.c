@@ -0,0 +1,92 @@
+#include "bench.h"
+
+/*
+ * Single precision floating point: dense matrix multiplications followed by
+ * n-body steps, which add divisions and square roots. Only single precision
+ * is used, since the rv32 platforms do not implement the D extension.
+ */
+
+#ifndef ITERATIONS
+#define ITERATIONS 20
+#endif
+
+#define N 32
+#define BODIES 64
+
+static float a[N][N], b[N][N], c[N][N];
+
+static struct {
+	float x, y, z;
+	float vx, vy, vz;
+	float m;
+} bodies[BODIES];
+
+static float frand(uint32_t *state) {
+	return (bench_rand(state) >> 8) * (1.0f / (1 << 24));
+}
+
+static void matmul(void) {
+	for (unsigned i = 0; i < N; ++i) {
+		for (unsigned j = 0; j < N; ++j) {
+			float sum = 0;
+			for (unsigned k = 0; k < N; ++k)
+				sum += a[i][k] * b[k][j];
+			c[i][j] = sum;
+		}
+	}
+	// feed the result back, normalized to keep the values bounded
+	for (unsigned i = 0; i < N; ++i)
+		for (unsigned j = 0; j < N; ++j)
+			a[i][j] = c[i][j] / (c[i][j] + 1.0f);
+}
+
+static void nbody_step(float dt) {
+	for (unsigned i = 0; i < BODIES; ++i) {
+		float ax = 0, ay = 0, az = 0;
+		for (unsigned j = 0; j < BODIES; ++j) {
+			float dx = bodies[j].x - bodies[i].x;
+			float dy = bodies[j].y - bodies[i].y;
+			float dz = bodies[j].z - bodies[i].z;
+			float d2 = dx * dx + dy * dy + dz * dz + 0.01f;
+			float inv = 1.0f / (d2 * __builtin_sqrtf(d2));
+			ax += bodies[j].m * dx * inv;
+			ay += bodies[j].m * dy * inv;
+			az += bodies[j].m * dz * inv;
+		}
+		bodies[i].vx += ax * dt;
+		bodies[i].vy += ay * dt;
+		bodies[i].vz += az * dt;
+	}
+	for (unsigned i = 0; i < BODIES; ++i) {
+		bodies[i].x += bodies[i].vx * dt;
+		bodies[i].y += bodies[i].vy * dt;
+		bodies[i].z += bodies[i].vz * dt;
+	}
+}
+
+int main(void) {
+	uint32_t seed = SEED;
+
+	for (unsigned i = 0; i < N; ++i) {
+		for (unsigned j = 0; j < N; ++j) {
+			a[i][j] = frand(&seed);
+			b[i][j] = frand(&seed);
+		}
+	}
+	for (unsigned i = 0; i < BODIES; ++i) {
+		bodies[i].x = frand(&seed);
+		bodies[i].y = frand(&seed);
+		bodies[i].z = frand(&seed);
+		bodies[i].vx = bodies[i].vy = bodies[i].vz = 0;
+		bodies[i].m = frand(&seed) + 0.5f;
+	}
+
+	for (unsigned i = 0; i < ITERATIONS; ++i) {
+		matmul();
+		for (unsigned s = 0; s < 10; ++s)
+			nbody_step(0.001f);
+	}
+
+	// keep the results alive, any value is fine
+	return a[0][0] != a[0][0];
+}
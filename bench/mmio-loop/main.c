@@ -0,0 +1,34 @@
+#include "bench.h"
+
+/*
+ * Driver-like polling loop on the CLINT: every iteration reads the 64 bit
+ * mtime register and programs the timer compare register of the hart. All
+ * accesses are TLM transactions to a peripheral, exercising the bus routing
+ * and the peripheral register callbacks rather than the memory fast path.
+ * Interrupts stay disabled, hence the timer never fires.
+ */
+
+#ifndef ITERATIONS
+#define ITERATIONS 200000
+#endif
+
+int main(void) {
+	volatile uint32_t *mtime = (volatile uint32_t *)CLINT_MTIME;
+	volatile uint32_t *mtimecmp = (volatile uint32_t *)(uintptr_t)(CLINT_MTIMECMP + 8 * bench_hart_id());
+	uint32_t sum = 0;
+
+	for (unsigned i = 0; i < ITERATIONS; ++i) {
+		uint32_t lo = mtime[0];
+		uint32_t hi = mtime[1];
+
+		// high word first, so the compare value never lies in the past
+		mtimecmp[1] = 0xffffffff;
+		mtimecmp[0] = lo + 1000;
+		mtimecmp[1] = hi + 1;
+
+		sum += mtimecmp[0] ^ hi;
+	}
+	mtimecmp[1] = 0xffffffff;
+
+	return sum == 0;
+}
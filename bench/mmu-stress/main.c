@@ -0,0 +1,129 @@
+#include "bench.h"
+
+/*
+ * Random accesses through virtual memory in S-mode. A 4 MiB pool of 1024 pages
+ * is mapped in random order at a high virtual address, so that nearly every
+ * access hits a different page. The program itself stays identity mapped with
+ * superpages. A periodic sfence.vma flushes the TLB to add page table walks.
+ * Requires a platform with an MMU (tiny32, tiny64, linux).
+ */
+
+#ifndef ITERATIONS
+#define ITERATIONS 500000
+#endif
+
+#define PGSIZE 4096
+#define NPAGES 1024
+#define FLUSH_INTERVAL 4096
+
+#define PTE_V 0x01
+#define PTE_R 0x02
+#define PTE_W 0x04
+#define PTE_X 0x08
+#define PTE_A 0x40
+#define PTE_D 0x80
+#define PTE_LEAF (PTE_V | PTE_R | PTE_W | PTE_A | PTE_D)
+
+#if __riscv_xlen == 64
+// Sv39: 1 GiB superpages in the root table, the pool uses all three levels
+typedef uint64_t pte_t;
+#define SATP_MODE (8ul << 60)
+#define SUPERPAGE_SHIFT 30
+#define SUPERPAGES 1
+#define VA_BASE 0x100000000ul
+#else
+// Sv32: 4 MiB superpages in the root table, the pool uses both levels
+typedef uint32_t pte_t;
+#define SATP_MODE (1ul << 31)
+#define SUPERPAGE_SHIFT 22
+#define SUPERPAGES 16
+#define VA_BASE 0x40000000ul
+#endif
+
+#define PTES (PGSIZE / sizeof(pte_t))
+
+static uint8_t pool[NPAGES * PGSIZE] __attribute__((aligned(PGSIZE)));
+static pte_t root[PTES] __attribute__((aligned(PGSIZE)));
+static pte_t leaves[NPAGES / PTES][PTES] __attribute__((aligned(PGSIZE)));
+#if __riscv_xlen == 64
+static pte_t middle[PTES] __attribute__((aligned(PGSIZE)));
+#endif
+static uint16_t perm[NPAGES];
+
+static pte_t make_pte(uintptr_t pa, unsigned flags) {
+	return ((pte_t)(pa >> 12) << 10) | flags;
+}
+
+static void setup(uint32_t *seed) {
+	// identity map the superpages holding the program, its data and stacks
+	uintptr_t first = (uintptr_t)pool >> SUPERPAGE_SHIFT;
+	if (first >= SUPERPAGES / 2)
+		first -= SUPERPAGES / 2;
+	for (uintptr_t i = first; i < first + SUPERPAGES; ++i)
+		root[i] = make_pte(i << SUPERPAGE_SHIFT, PTE_LEAF | PTE_X);
+
+	// random permutation of the pool pages (Fisher-Yates)
+	for (unsigned i = 0; i < NPAGES; ++i)
+		perm[i] = i;
+	for (unsigned i = NPAGES - 1; i > 0; --i) {
+		unsigned j = bench_rand(seed) % (i + 1);
+		uint16_t tmp = perm[i];
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+
+	for (unsigned i = 0; i < NPAGES; ++i)
+		leaves[i / PTES][i % PTES] = make_pte((uintptr_t)&pool[perm[i] * PGSIZE], PTE_LEAF);
+
+#if __riscv_xlen == 64
+	root[VA_BASE >> 30] = make_pte((uintptr_t)middle, PTE_V);
+	for (unsigned i = 0; i < NPAGES / PTES; ++i)
+		middle[i] = make_pte((uintptr_t)leaves[i], PTE_V);
+#else
+	for (unsigned i = 0; i < NPAGES / PTES; ++i)
+		root[(VA_BASE >> 22) + i] = make_pte((uintptr_t)leaves[i], PTE_V);
+#endif
+}
+
+// runs in S-mode and terminates the benchmark with an ecall, see bootstrap.S
+static void __attribute__((noreturn)) stress(void) {
+	uint32_t seed = SEED;
+	uint32_t sum = 0;
+
+	for (unsigned i = 1; i <= ITERATIONS; ++i) {
+		uint32_t r = bench_rand(&seed);
+		uintptr_t page = r % NPAGES;
+		uintptr_t offset = (r >> 10) & (PGSIZE - 4);
+		volatile uint32_t *p = (volatile uint32_t *)(VA_BASE + page * PGSIZE + offset);
+
+		sum += *p;
+		*p = sum;
+
+		if (i % FLUSH_INTERVAL == 0)
+			asm volatile("sfence.vma" ::: "memory");
+	}
+
+	register long a0 asm("a0") = sum == 0xffffffff;
+	asm volatile("ecall" : : "r"(a0));
+	for (;;)
+		;
+}
+
+int main(void) {
+	uint32_t seed = SEED;
+	setup(&seed);
+
+	asm volatile("csrw satp, %0\n"
+	             "sfence.vma\n" ::"r"(SATP_MODE | ((uintptr_t)root >> 12))
+	             : "memory");
+
+	// mret into S-mode (mstatus.MPP = 1)
+	asm volatile("csrc mstatus, %0\n"
+	             "csrs mstatus, %1\n"
+	             "csrw mepc, %2\n"
+	             "mret\n" ::"r"(3ul << 11),
+	             "r"(1ul << 11), "r"(stress)
+	             : "memory");
+
+	return -1;
+}
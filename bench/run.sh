@@ -0,0 +1,149 @@
+#!/bin/sh
+#
+# Runs the benchmark programs on the VPs and reports host seconds, MIPS and
+# their variance over several runs as CSV and JSON. The numbers are taken
+# from the --stats-file report of the VP. Options:
+#
+#   -r RUNS        runs per configuration (default 5)
+#   -o DIR         output directory (default results)
+#   -p PLATFORMS   platforms to run (default "tiny32 tiny64 basic tiny32-mc linux")
+#   -b BENCHMARKS  benchmarks to run (default all)
+#   -m MODES       memory access modes, "tlm" and/or "dmi" (default both)
+#
+# The VP binaries are taken from VP_BIN (default ../vp/build/bin).
+
+set -e
+
+cd "$(dirname "$0")"
+
+RUNS=5
+OUT=results
+PLATFORMS="tiny32 tiny64 basic tiny32-mc linux"
+BENCHMARKS="coremark mmu-stress amo-contention mmio-loop fp-kernel"
+MODES="tlm dmi"
+VP_BIN=${VP_BIN:-../vp/build/bin}
+
+while getopts r:o:p:b:m: opt; do
+	case $opt in
+		r) RUNS=$OPTARG ;;
+		o) OUT=$OPTARG ;;
+		p) PLATFORMS=$OPTARG ;;
+		b) BENCHMARKS=$OPTARG ;;
+		m) MODES=$OPTARG ;;
+		*) exit 1 ;;
+	esac
+done
+
+mkdir -p "$OUT"
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# linux-vp requires a device tree, which the benchmarks do not use
+printf 'bench' > "$TMP/dummy.dtb"
+
+vp_command() {
+	case $1 in
+		tiny32) echo "$VP_BIN/tiny32-vp" ;;
+		tiny64) echo "$VP_BIN/tiny64-vp" ;;
+		basic) echo "$VP_BIN/riscv-vp" ;;
+		tiny32-mc) echo "$VP_BIN/tiny32-mc" ;;
+		linux) echo "$VP_BIN/linux-vp --dtb-file $TMP/dummy.dtb" ;;
+		*) echo "unknown platform: $1" >&2; exit 1 ;;
+	esac
+}
+
+variant() {
+	case $1 in
+		tiny64) echo rv64 ;;
+		linux) echo rv64-linux ;;
+		*) echo rv32 ;;
+	esac
+}
+
+supported() {
+	case $1:$2 in
+		# no MMU on these platforms
+		mmu-stress:basic | mmu-stress:tiny32-mc) return 1 ;;
+		*) return 0 ;;
+	esac
+}
+
+mode_flags() {
+	case $1 in
+		tlm) echo "" ;;
+		dmi) echo "--use-dmi" ;;
+		*) echo "unknown mode: $1" >&2; exit 1 ;;
+	esac
+}
+
+# prints "instructions wall_time_s mips" of a stats JSON file
+extract() {
+	awk '
+		/"wall_time_s"/ { sub(/.*"wall_time_s": /, ""); sub(/,.*/, ""); wall = $0 }
+		/"total"/ {
+			line = $0
+			sub(/.*"total": \{"instructions": /, "", line); sub(/,.*/, "", line); instrs = line
+			line = $0
+			sub(/.*"total": .*"mips": /, "", line); sub(/,.*/, "", line); mips = line
+		}
+		END { print instrs, wall, mips }' "$1"
+}
+
+CSV="$OUT/bench.csv"
+JSON="$OUT/bench.json"
+echo "benchmark,platform,mode,runs,instructions,host_s_mean,host_s_stddev,mips_mean,mips_stddev" > "$CSV"
+echo "[" > "$JSON"
+FAILED=0
+FIRST=1
+
+for bench in $BENCHMARKS; do
+	for platform in $PLATFORMS; do
+		supported "$bench" "$platform" || continue
+		elf="build/$(variant "$platform")/$bench.elf"
+		if [ ! -f "$elf" ]; then
+			echo "missing $elf, run make first" >&2
+			exit 1
+		fi
+
+		for mode in $MODES; do
+			: > "$TMP/samples"
+			i=0
+			while [ $i -lt "$RUNS" ]; do
+				rm -f "$TMP/stats.json"
+				$(vp_command "$platform") $(mode_flags "$mode") --stats-file "$TMP/stats.json" "$elf" \
+					> "$TMP/log" 2>&1 || true
+				if [ ! -s "$TMP/stats.json" ]; then
+					echo "FAILED: $bench on $platform ($mode), see $OUT/$bench-$platform-$mode.log" >&2
+					cp "$TMP/log" "$OUT/$bench-$platform-$mode.log"
+					FAILED=1
+					break
+				fi
+				extract "$TMP/stats.json" >> "$TMP/samples"
+				i=$((i + 1))
+			done
+			[ -s "$TMP/samples" ] || continue
+
+			# mean and sample standard deviation of the host time and the MIPS
+			result=$(awk '
+				{ n++; instrs = $1; t += $2; tt += $2 * $2; m += $3; mm += $3 * $3 }
+				END {
+					tmean = t / n; mmean = m / n
+					tvar = n > 1 ? (tt - n * tmean * tmean) / (n - 1) : 0
+					mvar = n > 1 ? (mm - n * mmean * mmean) / (n - 1) : 0
+					printf "%d %s %.6f %.6f %.3f %.3f\n", n, instrs, tmean, sqrt(tvar > 0 ? tvar : 0),
+					       mmean, sqrt(mvar > 0 ? mvar : 0)
+				}' "$TMP/samples")
+			set -- $result
+			echo "$bench,$platform,$mode,$1,$2,$3,$4,$5,$6" >> "$CSV"
+			[ $FIRST -eq 1 ] || echo "," >> "$JSON"
+			FIRST=0
+			printf '  {"benchmark": "%s", "platform": "%s", "mode": "%s", "runs": %s, "instructions": %s, "host_s_mean": %s, "host_s_stddev": %s, "mips_mean": %s, "mips_stddev": %s}' \
+				"$bench" "$platform" "$mode" "$1" "$2" "$3" "$4" "$5" "$6" >> "$JSON"
+			printf '%-15s %-10s %-4s %8.3f s +- %.3f  %8.2f MIPS +- %.2f\n' "$bench" "$platform" "$mode" "$3" "$4" "$5" "$6"
+		done
+	done
+done
+
+printf '\n]\n' >> "$JSON"
+echo "results written to $CSV and $JSON"
+exit $FAILED
@@ -37,6 +37,16 @@ struct Frame {
 	Color raw[screenHeight][screenWidth];  // Notice: Screen is on side
 };
 
+/*
+ * Rows [top, bottom) of the displayed image changed with frame `sequence`.
+ * Written by the VP only, see Framebuffer::DirtyLog.
+ */
+struct DirtyRegion {
+	uint32_t sequence;
+	uint16_t top;
+	uint16_t bottom;
+};
+
 struct Framebuffer {
 	enum class Type : uint8_t { foreground, background };
 	uint8_t activeFrame;
@@ -46,7 +56,21 @@ struct Framebuffer {
 		fillFrame,
 		applyFrame,
 		drawLine,
+		fillRect,
+		blit,
+		blend,
+		drawText,
 	} volatile command;
+	/*
+	 * Commands take effect immediately but the engine stays busy for
+	 * their modelled duration, then sets done and raises an interrupt.
+	 * The done bit is cleared by writing zero.
+	 */
+	enum Status : uint8_t {
+		statusBusy = 1,
+		statusDone = 2,
+	};
+	volatile uint8_t status;
 	union Parameter {
 		struct {
 			//fillframe
@@ -60,12 +84,57 @@ struct Framebuffer {
 			frame::PointF to;
 			Color color;
 		} line;
+		struct {
+			//fillRect, rows/columns [from, to)
+			Type frame;
+			frame::Point from;
+			frame::Point to;
+			Color color;
+		} rect;
+		struct {
+			//blit, blend of size pixels, clipped to the screen
+			Type srcFrame;
+			Type dstFrame;
+			uint8_t transparent;  // skip source pixels of color 0
+			uint8_t alpha;        // blend only, 255 is opaque
+			frame::Point src;
+			frame::Point dst;
+			frame::Point size;
+			uint32_t srcAddr;   // if nonzero, source image in memory instead of srcFrame
+			uint32_t srcPitch;  // pixels per row of the source image
+		} copy;
+		struct {
+			//drawText, glyphs are 8 pixels wide, one byte per row, MSB left
+			Type frame;
+			uint8_t opaque;  // also draw the background of the glyphs
+			uint8_t glyphHeight;
+			uint8_t firstChar;  // character of the first glyph in font
+			frame::Point pos;
+			Color color;
+			Color background;
+			uint32_t text;  // address of the characters
+			uint32_t length;
+			uint32_t font;  // address of the glyphs
+		} text;
 		inline Parameter(){};
 	} parameter;
 	Frame frames[2];
 	Frame background;
 
-	Framebuffer() : activeFrame(0), command(Command::none){};
+	/*
+	 * Ring of changed regions, appended by the VP whenever the displayed
+	 * image changes. `head` counts all regions ever written and `sequence`
+	 * all published frames, both are updated after the regions. A viewer
+	 * that fell behind by more than dirtyLogSize regions repaints all.
+	 */
+	static constexpr unsigned dirtyLogSize = 64;
+	struct DirtyLog {
+		uint32_t sequence;
+		uint32_t head;
+		DirtyRegion regions[dirtyLogSize];
+	} dirty;
+
+	Framebuffer() : activeFrame(0), command(Command::none), status(0){};
 
 	Frame& getActiveFrame() {
 		return frames[activeFrame % 2];
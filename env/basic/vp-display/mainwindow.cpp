@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include <qevent.h>
 #include <qpainter.h>
 #include <cassert>
 #include "framebuffer.h"
@@ -10,17 +11,17 @@ VPDisplay::VPDisplay(QWidget* mparent) : QWidget(mparent) {
 	                   QImage::Format_RGB444);  // two bytes per pixel
 	resize(800, 600);
 	setFixedSize(size());
-	server.startListening(std::bind(&VPDisplay::notifyChange, this, std::placeholders::_1));
+	server.startListening(std::bind(&VPDisplay::notifyChange, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 VPDisplay::~VPDisplay() {
 	delete frame;
 }
 
-void VPDisplay::drawMainPage(QImage* mem) {
-	Frame activeFrame = framebuffer->getActiveFrame();
-	Frame background = framebuffer->getBackground();
-	for (int row = 0; row < mem->height(); row++) {
+void VPDisplay::drawMainPage(QImage* mem, int top, int bottom) {
+	Frame& activeFrame = framebuffer->getActiveFrame();
+	Frame& background = framebuffer->getBackground();
+	for (int row = top; row < bottom; row++) {
 		uint16_t* line = reinterpret_cast<uint16_t*>(mem->scanLine(row));  // Two bytes per pixel
 		for (int x = 0; x < mem->width(); x++) {
 			line[x] = activeFrame.raw[row][x] == 0 ? background.raw[row][x] : activeFrame.raw[row][x];
@@ -28,7 +29,7 @@ void VPDisplay::drawMainPage(QImage* mem) {
 	}
 }
 
-void VPDisplay::paintEvent(QPaintEvent*) {
+void VPDisplay::paintEvent(QPaintEvent* e) {
 	QPainter painter(this);
 
 	// painter.scale(size_factor, size_factor);
@@ -36,12 +37,13 @@ void VPDisplay::paintEvent(QPaintEvent*) {
 	// Draw Header
 	// QPainter mempaint(&memory);
 
-	drawMainPage(frame);
-	painter.drawImage(QPoint(0, 0), *frame);
+	// only repaint the rows which changed
+	QRect rect = e->rect().intersected(frame->rect());
+	drawMainPage(frame, rect.top(), rect.bottom() + 1);
+	painter.drawImage(rect.topLeft(), *frame, rect);
 	painter.end();
 }
 
-void VPDisplay::notifyChange(bool success) {
-	assert(success);
-	update();
+void VPDisplay::notifyChange(int top, int bottom) {
+	update(0, top, screenWidth, bottom - top);
 }
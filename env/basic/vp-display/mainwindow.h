@@ -18,7 +18,7 @@ class VPDisplay : public QWidget {
 	~VPDisplay();
 	void paintEvent(QPaintEvent*);
 	// void keyPressEvent(QKeyEvent *e);
-	void drawMainPage(QImage* mem);
+	void drawMainPage(QImage* mem, int top, int bottom);
 
-	void notifyChange(bool success);
+	void notifyChange(int top, int bottom);
 };
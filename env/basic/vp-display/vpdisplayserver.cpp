@@ -4,6 +4,7 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/types.h>
+#include <chrono>
 #include <iostream>
 
 VPDisplayserver::VPDisplayserver(unsigned int sharedMemoryKey) : mSharedMemoryKey(sharedMemoryKey), stop(false) {}
@@ -29,17 +30,33 @@ Framebuffer* VPDisplayserver::createSM() {
 	return framebuffer;
 }
 
-void VPDisplayserver::startListening(std::function<void(bool)> notifyChange) {
-	// TODO: While loop around buffer changer
+void VPDisplayserver::startListening(std::function<void(int, int)> notifyChange) {
 	active_watch = std::thread([=]() {
-		uint8_t lastFrame = -1;
+		Framebuffer::DirtyLog& log = framebuffer->dirty;
+		uint32_t lastSequence = __atomic_load_n(&log.sequence, __ATOMIC_ACQUIRE);
+		uint32_t lastHead = __atomic_load_n(&log.head, __ATOMIC_ACQUIRE);
+
 		while (!stop.load()) {
-			if (framebuffer->activeFrame != lastFrame) {
-				notifyChange(true);
-				lastFrame = framebuffer->activeFrame;
+			uint32_t sequence = __atomic_load_n(&log.sequence, __ATOMIC_ACQUIRE);
+			if (sequence == lastSequence) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+
+			uint32_t head = __atomic_load_n(&log.head, __ATOMIC_ACQUIRE);
+			bool complete = head - lastHead <= Framebuffer::dirtyLogSize;
+			for (uint32_t i = lastHead; complete && i != head; i++) {
+				DirtyRegion r = log.regions[i % Framebuffer::dirtyLogSize];
+				notifyChange(r.top, r.bottom);
 			}
-			// std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+			// the regions may have been overwritten while reading them
+			if (!complete || __atomic_load_n(&log.head, __ATOMIC_ACQUIRE) - lastHead > Framebuffer::dirtyLogSize)
+				notifyChange(0, screenHeight);
+
+			lastSequence = sequence;
+			lastHead = head;
 		}
 	});
-	notifyChange(true);
+	notifyChange(0, screenHeight);
 }
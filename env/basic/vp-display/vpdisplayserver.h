@@ -14,5 +14,6 @@ class VPDisplayserver {
 	VPDisplayserver(unsigned int sharedMemoryKey = 1338);
 	~VPDisplayserver();
 	Framebuffer* createSM();
-	void startListening(std::function<void(bool)> notifyChange);
+	// notifyChange(top, bottom) is called for each band of changed rows
+	void startListening(std::function<void(int, int)> notifyChange);
 };
@@ -5,6 +5,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include "ui_mainwindow.h"
 
@@ -106,6 +107,9 @@ VPBreadboard::VPBreadboard(const char* configfile, const char* host, const char*
 
 	memset(buttons, 0, max_num_buttons * sizeof(Button*));
 
+	connect(&refreshTimer, SIGNAL(timeout()), this, SLOT(update()));
+	refreshTimer.start(16);
+
 	QFile confFile(configfile);
     if (!confFile.open(QIODevice::ReadOnly)) {
         std::cerr << "Could not open config file " << configfile << std::endl;
@@ -302,7 +306,9 @@ void VPBreadboard::paintEvent(QPaintEvent*) {
 	QPainter painter(this);
 
 	if (!inited || !gpio.update()) {
-		inited = gpio.setupConnection(host, port);
+		// shared memory only works if the VP runs on the same host
+		bool local = !strcmp(host, "localhost") || !strcmp(host, "127.0.0.1");
+		inited = gpio.setupConnection(host, port) && gpio.subscribe(local);
 		showConnectionErrorOverlay(painter);
 		if (!inited)
 			usleep(500000);
@@ -316,15 +322,20 @@ void VPBreadboard::paintEvent(QPaintEvent*) {
 	if(oled)
 		oled->draw(painter);
 
+	// pins which toggled since the last frame are drawn active for this
+	// frame, otherwise pulses shorter than a frame would never be visible
+	GpioCommon::Reg active_high = gpio.state | gpio.toggled;
+	GpioCommon::Reg active_low = gpio.state & ~gpio.toggled;
+
 	if(sevensegment)
 	{
-		sevensegment->map = translatePinNumberToSevensegment(translateGpioToExtPin(gpio.state));
+		sevensegment->map = translatePinNumberToSevensegment(translateGpioToExtPin(active_high));
 		sevensegment->draw(painter);
 	}
 
 	if(rgbLed)
 	{
-		rgbLed->map = translatePinNumberToRGBLed(translateGpioToExtPin(gpio.state));
+		rgbLed->map = translatePinNumberToRGBLed(translateGpioToExtPin(active_low));
 		rgbLed->draw(painter);
 	}
 
@@ -355,10 +366,6 @@ void VPBreadboard::paintEvent(QPaintEvent*) {
 			painter.drawRect(QRect(sevensegment->offs, QSize(sevensegment->extent.x(), sevensegment->extent.y())));
 	}
 	painter.end();
-	// intentional slow down
-	// TODO: update at fixed rate, async between redraw and gpioserver
-	usleep(10000);
-	this->update();
 }
 
 void VPBreadboard::notifyChange(bool success) {
@@ -1,5 +1,6 @@
 #pragma once
 #include <QMainWindow>
+#include <QTimer>
 #include <cassert>
 
 #include <gpio/gpio-client.hpp>
@@ -72,6 +73,8 @@ class VPBreadboard : public QWidget {
 	bool debugmode = false;
 	unsigned moving_button = 0;
 	bool inited = false;
+	// repaints at a fixed rate, the gpio state is pushed by the server
+	QTimer refreshTimer;
 
 	uint64_t translateGpioToExtPin(GpioCommon::Reg reg);
 	uint8_t translatePinNumberToSevensegment(uint64_t pinmap);
@@ -40,3 +40,5 @@ FORMS += \
 
 RESOURCES += \
     resources.qrc
+
+LIBS += -lrt
@@ -47,17 +47,11 @@ void fillRect(Framebuffer::Type frame, PointF ol, PointF ur, Color color) {
 	if (ol.y > ur.y) {
 		swap(ol.y, ur.y);
 	}
-	if (ur.x - ol.x > ur.y - ol.y) {
-		// Horizontal
-		for (uint16_t y = ol.y; y <= ur.y; y++) {
-			drawLine(frame, PointF(ol.x, y), PointF(ur.x, y), color);
-		}
-	} else {
-		// Vertical
-		for (uint16_t x = ol.x; x <= ur.x; x++) {
-			drawLine(frame, PointF(x, ol.y), PointF(x, ur.y), color);
-		}
-	}
+	framebuffer->parameter.rect.frame = frame;
+	framebuffer->parameter.rect.from = Point(ol.x, ol.y);
+	framebuffer->parameter.rect.to = Point((uint32_t)ur.x + 1, (uint32_t)ur.y + 1);
+	framebuffer->parameter.rect.color = color;
+	framebuffer->command = Framebuffer::Command::fillRect;
 }
 
 void applyFrame() {
@@ -70,4 +64,56 @@ void fillFrame(Framebuffer::Type frame, Color color) {
 	framebuffer->command = Framebuffer::Command::fillFrame;
 }
 
+void blit(Framebuffer::Type dst, Point to, Framebuffer::Type src, Point from, Point size, bool transparent) {
+	framebuffer->parameter.copy.srcFrame = src;
+	framebuffer->parameter.copy.dstFrame = dst;
+	framebuffer->parameter.copy.transparent = transparent;
+	framebuffer->parameter.copy.src = from;
+	framebuffer->parameter.copy.dst = to;
+	framebuffer->parameter.copy.size = size;
+	framebuffer->command = Framebuffer::Command::blit;
+}
+
+void blitImage(Framebuffer::Type dst, Point to, const Color* image, uint32_t pitch, Point size, bool transparent) {
+	framebuffer->parameter.copy.dstFrame = dst;
+	framebuffer->parameter.copy.transparent = transparent;
+	framebuffer->parameter.copy.dst = to;
+	framebuffer->parameter.copy.size = size;
+	framebuffer->parameter.copy.srcAddr = (uint32_t)image;
+	framebuffer->parameter.copy.srcPitch = pitch;
+	framebuffer->command = Framebuffer::Command::blit;
+}
+
+void blendImage(Framebuffer::Type dst, Point to, const Color* image, uint32_t pitch, Point size, uint8_t alpha,
+                bool transparent) {
+	framebuffer->parameter.copy.dstFrame = dst;
+	framebuffer->parameter.copy.transparent = transparent;
+	framebuffer->parameter.copy.alpha = alpha;
+	framebuffer->parameter.copy.dst = to;
+	framebuffer->parameter.copy.size = size;
+	framebuffer->parameter.copy.srcAddr = (uint32_t)image;
+	framebuffer->parameter.copy.srcPitch = pitch;
+	framebuffer->command = Framebuffer::Command::blend;
+}
+
+void drawText(Framebuffer::Type frame, Point pos, const char* text, uint32_t length, const uint8_t* font,
+              uint8_t glyphHeight, uint8_t first, Color color, Color background, bool opaque) {
+	framebuffer->parameter.text.frame = frame;
+	framebuffer->parameter.text.opaque = opaque;
+	framebuffer->parameter.text.glyphHeight = glyphHeight;
+	framebuffer->parameter.text.firstChar = first;
+	framebuffer->parameter.text.pos = pos;
+	framebuffer->parameter.text.color = color;
+	framebuffer->parameter.text.background = background;
+	framebuffer->parameter.text.text = (uint32_t)text;
+	framebuffer->parameter.text.length = length;
+	framebuffer->parameter.text.font = (uint32_t)font;
+	framebuffer->command = Framebuffer::Command::drawText;
+}
+
+void waitIdle() {
+	while (framebuffer->status & Framebuffer::statusBusy)
+		;
+}
+
 }  // namespace display
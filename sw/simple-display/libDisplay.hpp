@@ -31,4 +31,19 @@ void fillRect(Framebuffer::Type frame, PointF ol, PointF ur, Color color);
 void applyFrame();
 
 void fillFrame(Framebuffer::Type frame = Framebuffer::Type::foreground, Color color = 0);
+
+void blit(Framebuffer::Type dst, Point to, Framebuffer::Type src, Point from, Point size, bool transparent = false);
+
+void blitImage(Framebuffer::Type dst, Point to, const Color* image, uint32_t pitch, Point size,
+               bool transparent = false);
+
+void blendImage(Framebuffer::Type dst, Point to, const Color* image, uint32_t pitch, Point size, uint8_t alpha,
+                bool transparent = false);
+
+// glyphs are 8 pixels wide, one byte per row, the first one is for character first
+void drawText(Framebuffer::Type frame, Point pos, const char* text, uint32_t length, const uint8_t* font,
+              uint8_t glyphHeight, uint8_t first, Color color, Color background, bool opaque);
+
+// waits until the display completed all commands
+void waitIdle();
 };  // namespace display
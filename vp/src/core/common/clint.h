@@ -7,6 +7,10 @@
 #include <tlm_utils/simple_target_socket.h>
 #include <systemc>
 
+#include <algorithm>
+#include <set>
+#include <vector>
+
 #include "util/memory_map.h"
 
 template <unsigned NumberOfCores>
@@ -56,6 +60,12 @@ struct CLINT : public clint_if, public sc_core::sc_module {
 
 	std::array<clint_interrupt_target *, NumberOfCores> target_harts{};
 
+	// armed timers ordered by deadline (mtimecmp value, hart), shared by all
+	// harts, hence a wake-up only processes the harts whose deadline expired
+	std::set<std::pair<uint64_t, unsigned>> deadlines;
+	std::array<uint64_t, NumberOfCores> armed_deadline{};  // zero if not armed
+	std::vector<unsigned> changed_harts;                     // mtimecmp written since the last wake-up
+
 	SC_HAS_PROCESS(CLINT);
 
 	CLINT(sc_core::sc_module_name) {
@@ -80,30 +90,50 @@ struct CLINT : public clint_if, public sc_core::sc_module {
 		return mtime;
 	}
 
+	uint64_t get_mtime_scaler() override {
+		return scaler;
+	}
+
+	void rearm(unsigned hart) {
+		if (armed_deadline[hart]) {
+			deadlines.erase({armed_deadline[hart], hart});
+			armed_deadline[hart] = 0;
+		}
+
+		auto cmp = mtimecmp[hart];
+		if (cmp > 0 && mtime >= cmp) {
+			target_harts[hart]->trigger_timer_interrupt(true);
+		} else {
+			target_harts[hart]->trigger_timer_interrupt(false);
+			if (cmp > 0 && cmp < UINT64_MAX) {
+				deadlines.insert({cmp, hart});
+				armed_deadline[hart] = cmp;
+			}
+		}
+	}
+
 	void run() {
 		while (true) {
 			sc_core::wait(irq_event);
 
 			update_and_get_mtime();
 
-			for (unsigned i = 0; i < NumberOfCores; ++i) {
-				auto cmp = mtimecmp[i];
-				// std::cout << "[vp::clint] process mtimecmp[" << i << "]=" << cmp << ", mtime=" << mtime << std::endl;
-				if (cmp > 0 && mtime >= cmp) {
-					// std::cout << "[vp::clint] set timer interrupt for core " << i << std::endl;
-					target_harts[i]->trigger_timer_interrupt(true);
-				} else {
-					// std::cout << "[vp::clint] unset timer interrupt for core " << i << std::endl;
-					target_harts[i]->trigger_timer_interrupt(false);
-					if (cmp > 0 && cmp < UINT64_MAX) {
-						auto time = sc_core::sc_time::from_value(mtime * scaler);
-						auto goal = sc_core::sc_time::from_value(cmp * scaler);
-						// std::cout << "[vp::clint] time=" << time << std::endl;
-						// std::cout << "[vp::clint] goal=" << goal << std::endl;
-						// std::cout << "[vp::clint] goal-time=delay=" << goal-time << std::endl;
-						irq_event.notify(goal - time);
-					}
-				}
+			for (auto hart : changed_harts) rearm(hart);
+			changed_harts.clear();
+
+			while (!deadlines.empty() && deadlines.begin()->first <= mtime) {
+				unsigned hart = deadlines.begin()->second;
+				deadlines.erase(deadlines.begin());
+				armed_deadline[hart] = 0;
+
+				// std::cout << "[vp::clint] set timer interrupt for core " << hart << std::endl;
+				target_harts[hart]->trigger_timer_interrupt(true);
+			}
+
+			if (!deadlines.empty()) {
+				auto time = sc_core::sc_time::from_value(mtime * scaler);
+				auto goal = sc_core::sc_time::from_value(deadlines.begin()->first * scaler);
+				irq_event.notify(goal - time);
 			}
 		}
 	}
@@ -119,6 +149,9 @@ struct CLINT : public clint_if, public sc_core::sc_module {
 	void post_write_mtimecmp(RegisterRange::WriteInfo t) {
 		// std::cout << "[vp::clint] write mtimecmp[addr=" << t.addr << "]=" << mtimecmp[t.addr / 8] << ", mtime=" <<
 		// mtime << std::endl;
+		unsigned hart = t.addr / 8;
+		if (std::find(changed_harts.begin(), changed_harts.end(), hart) == changed_harts.end())
+			changed_harts.push_back(hart);
 		irq_event.notify(t.delay);
 	}
 
@@ -6,4 +6,8 @@ struct clint_if {
 	virtual ~clint_if() {}
 
 	virtual uint64_t update_and_get_mtime() = 0;
+
+	/* Number of SystemC time units (ps) per mtime tick. Allows harts to
+	 * derive mtime from their local time without calling into the CLINT. */
+	virtual uint64_t get_mtime_scaler() = 0;
 };
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "coverage.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include "core/rv32/elf_loader.h"
+#include "core/rv64/elf_loader.h"
+
+struct Coverage::Report {
+	struct Line {
+		bool hit = false;
+		// taken and not taken of every conditional branch on the line
+		std::vector<std::pair<bool, bool>> branches;
+	};
+
+	struct Function {
+		std::string name;
+		uint32_t line;
+		bool hit;
+	};
+
+	struct File {
+		std::map<uint32_t, Line> lines;
+		std::vector<Function> functions;
+	};
+
+	std::map<std::string, File> files;
+};
+
+namespace {
+
+template <typename Loader>
+void read_elf(const std::string &path, Coverage::Image &image) {
+	constexpr unsigned PF_X = 1;
+
+	Loader elf(path.c_str());
+
+	auto section = [&](const char *name) {
+		DwarfLineTable::Section s;
+		auto it = elf.sections_by_name.find(name);
+		if (it != elf.sections_by_name.end()) {
+			s.data = (const uint8_t *)elf.elf.data() + it->second->sh_offset;
+			s.size = it->second->sh_size;
+		}
+		return s;
+	};
+
+	auto debug_line = section(".debug_line");
+	if (!debug_line.data)
+		throw std::runtime_error("no line table (.debug_line) in " + path + ", not built with -g?");
+	image.lines.parse(debug_line, section(".debug_line_str"), section(".debug_str"));
+
+	for (auto p : elf.get_load_sections()) {
+		if (!(p->p_flags & PF_X))
+			continue;
+		auto begin = (const uint8_t *)elf.elf.data() + p->p_offset;
+		image.code.push_back({p->p_vaddr, std::vector<uint8_t>(begin, begin + p->p_filesz)});
+	}
+
+	image.symbols = elf.get_symbols();
+}
+
+Coverage::Image read_image(const SymbolIndex::File &elf) {
+	// EI_CLASS: 1 is 32 bit, 2 is 64 bit
+	char ident[5] = {0};
+	std::ifstream in(elf.path, std::ios::binary);
+	if (!in.read(ident, sizeof(ident)) || ident[0] != 0x7f || ident[1] != 'E' || ident[2] != 'L' || ident[3] != 'F')
+		throw std::runtime_error("not an ELF file");
+
+	Coverage::Image image;
+	image.offset = elf.offset;
+	if (ident[4] == 1) {
+		image.arch = RV32;
+		read_elf<rv32::ELFLoader>(elf.path, image);
+	} else {
+		image.arch = RV64;
+		read_elf<rv64::ELFLoader>(elf.path, image);
+	}
+	return image;
+}
+
+bool is_conditional_branch(Instruction instr, Architecture arch) {
+	try {
+		auto op = instr.is_compressed() ? instr.decode_and_expand_compressed(arch) : instr.decode_normal(arch);
+		return op >= Opcode::BEQ && op <= Opcode::BGEU;
+	} catch (std::runtime_error &) {
+		// not every reserved compressed encoding is mapped
+		return false;
+	}
+}
+
+std::string xml_escape(const std::string &s) {
+	std::string out;
+	for (char c : s) {
+		switch (c) {
+			case '&':
+				out += "&amp;";
+				break;
+			case '<':
+				out += "&lt;";
+				break;
+			case '>':
+				out += "&gt;";
+				break;
+			case '"':
+				out += "&quot;";
+				break;
+			default:
+				out += c;
+		}
+	}
+	return out;
+}
+
+std::string rate(unsigned covered, unsigned valid) {
+	return std::to_string(valid ? (double)covered / valid : 1.0);
+}
+
+}  // namespace
+
+Coverage::Coverage(const std::string &path, const std::vector<SymbolIndex::File> &elfs) : path(path), elfs(elfs) {
+	// fail early instead of after the simulation
+	std::ofstream out(path);
+	if (!out)
+		throw std::runtime_error("unable to write coverage file " + path);
+}
+
+Coverage::~Coverage() {
+	std::vector<Image> images;
+	for (auto &elf : elfs) {
+		try {
+			images.push_back(read_image(elf));
+		} catch (std::exception &e) {
+			std::cerr << "[coverage] skipping " << elf.path << ": " << e.what() << std::endl;
+		}
+	}
+
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "[coverage] unable to write " << path << std::endl;
+		return;
+	}
+
+	write(out, images, path.size() >= 4 && path.compare(path.size() - 4, 4, ".xml") == 0);
+}
+
+void Coverage::write(std::ostream &out, const std::vector<Image> &images, bool cobertura) const {
+	Report report;
+	for (auto &image : images) add_image(image, report);
+
+	if (cobertura)
+		write_cobertura(out, report);
+	else
+		write_lcov(out, report);
+}
+
+Coverage::Page *Coverage::get_page(uint64_t number) {
+	auto &p = pages[number];
+	if (!p)
+		p.reset(new Page());
+	return p.get();
+}
+
+const Coverage::Page *Coverage::find_page(uint64_t addr) const {
+	auto it = pages.find(addr >> page_bits);
+	return it == pages.end() ? nullptr : it->second.get();
+}
+
+void Coverage::add_image(const Image &image, Report &report) const {
+	auto segment = [&](uint64_t addr, uint64_t size) -> const Image::Segment * {
+		for (auto &s : image.code) {
+			if (s.contains(addr, size))
+				return &s;
+		}
+		return nullptr;
+	};
+	auto executed = [&](uint64_t addr) {
+		auto p = find_page(addr + image.offset);
+		return p && test(p->executed, addr + image.offset);
+	};
+
+	// ranges outside of the loaded code, e.g. of functions removed by the linker, are ignored
+	for (auto &r : image.lines.ranges) {
+		const Image::Segment *s = segment(r.start, r.end - r.start);
+		if (!s)
+			continue;
+
+		auto &line = report.files[image.lines.files[r.file]].lines[r.line];
+		for (uint64_t addr = r.start; addr + 2 <= r.end;) {
+			Instruction instr(s->half(addr));
+			unsigned size = 2;
+			if (!instr.is_compressed()) {
+				if (addr + 4 > r.end)
+					break;
+				instr = Instruction(instr.data() | (s->half(addr + 2) << 16));
+				size = 4;
+			}
+
+			uint64_t pc = addr + image.offset;
+			const Page *p = find_page(pc);
+			if (p && test(p->executed, pc))
+				line.hit = true;
+
+			if (is_conditional_branch(instr, image.arch))
+				line.branches.push_back({p && test(p->taken, pc), p && test(p->not_taken, pc)});
+
+			addr += size;
+		}
+	}
+
+	// functions are attributed to the line of their entry
+	std::map<uint64_t, const DwarfLineTable::Range *> by_start;
+	for (auto &r : image.lines.ranges) by_start.emplace(r.start, &r);
+
+	std::set<uint64_t> seen;
+	for (auto &sym : image.symbols) {
+		if (!sym.code || sym.size == 0 || !segment(sym.addr, 2) || !seen.insert(sym.addr).second)
+			continue;
+
+		auto it = by_start.upper_bound(sym.addr);
+		if (it == by_start.begin())
+			continue;
+		const DwarfLineTable::Range *r = (--it)->second;
+		if (sym.addr >= r->end)
+			continue;
+
+		report.files[image.lines.files[r->file]].functions.push_back({sym.name, r->line, executed(sym.addr)});
+	}
+}
+
+void Coverage::write_lcov(std::ostream &out, const Report &report) const {
+	out << "TN:\n";
+	for (auto &f : report.files) {
+		out << "SF:" << f.first << "\n";
+
+		unsigned functions_hit = 0;
+		for (auto &fn : f.second.functions) out << "FN:" << fn.line << "," << fn.name << "\n";
+		for (auto &fn : f.second.functions) {
+			out << "FNDA:" << fn.hit << "," << fn.name << "\n";
+			functions_hit += fn.hit;
+		}
+		out << "FNF:" << f.second.functions.size() << "\nFNH:" << functions_hit << "\n";
+
+		// every conditional branch is a block with the branches taken (0) and not taken (1)
+		unsigned branches = 0, branches_hit = 0;
+		for (auto &l : f.second.lines) {
+			unsigned block = 0;
+			for (auto &b : l.second.branches) {
+				bool reached = b.first || b.second;
+				for (unsigned i = 0; i < 2; ++i) {
+					bool hit = i == 0 ? b.first : b.second;
+					out << "BRDA:" << l.first << "," << block << "," << i << ",";
+					if (reached)
+						out << hit << "\n";
+					else
+						out << "-\n";
+					branches_hit += hit;
+				}
+				branches += 2;
+				++block;
+			}
+		}
+		out << "BRF:" << branches << "\nBRH:" << branches_hit << "\n";
+
+		unsigned lines_hit = 0;
+		for (auto &l : f.second.lines) {
+			out << "DA:" << l.first << "," << l.second.hit << "\n";
+			lines_hit += l.second.hit;
+		}
+		out << "LF:" << f.second.lines.size() << "\nLH:" << lines_hit << "\n";
+		out << "end_of_record\n";
+	}
+}
+
+void Coverage::write_cobertura(std::ostream &out, const Report &report) const {
+	struct Totals {
+		unsigned lines = 0, lines_hit = 0;
+		unsigned branches = 0, branches_hit = 0;
+
+		void add(const Report::Line &l) {
+			++lines;
+			lines_hit += l.hit;
+			for (auto &b : l.branches) {
+				branches += 2;
+				branches_hit += b.first + b.second;
+			}
+		}
+	};
+
+	Totals all;
+	std::map<std::string, Totals> per_file;
+	for (auto &f : report.files) {
+		for (auto &l : f.second.lines) {
+			all.add(l.second);
+			per_file[f.first].add(l.second);
+		}
+	}
+
+	out << "<?xml version=\"1.0\" ?>\n";
+	out << "<!DOCTYPE coverage SYSTEM \"http://cobertura.sourceforge.net/xml/coverage-04.dtd\">\n";
+	out << "<coverage line-rate=\"" << rate(all.lines_hit, all.lines) << "\" branch-rate=\""
+	    << rate(all.branches_hit, all.branches) << "\" lines-covered=\"" << all.lines_hit << "\" lines-valid=\""
+	    << all.lines << "\" branches-covered=\"" << all.branches_hit << "\" branches-valid=\"" << all.branches
+	    << "\" complexity=\"0\" version=\"riscv-vp\" timestamp=\"" << time(nullptr) << "\">\n";
+	out << "  <sources>\n    <source>.</source>\n  </sources>\n";
+	out << "  <packages>\n";
+	out << "    <package name=\"\" line-rate=\"" << rate(all.lines_hit, all.lines) << "\" branch-rate=\""
+	    << rate(all.branches_hit, all.branches) << "\" complexity=\"0\">\n";
+	out << "      <classes>\n";
+
+	for (auto &f : report.files) {
+		auto &t = per_file[f.first];
+		std::string name = xml_escape(f.first);
+		out << "        <class name=\"" << name << "\" filename=\"" << name << "\" line-rate=\""
+		    << rate(t.lines_hit, t.lines) << "\" branch-rate=\"" << rate(t.branches_hit, t.branches)
+		    << "\" complexity=\"0\">\n";
+
+		out << "          <methods>\n";
+		for (auto &fn : f.second.functions) {
+			out << "            <method name=\"" << xml_escape(fn.name) << "\" signature=\"\" line-rate=\""
+			    << (fn.hit ? "1" : "0") << "\" branch-rate=\"1\" complexity=\"0\">\n";
+			out << "              <lines>\n                <line number=\"" << fn.line << "\" hits=\"" << fn.hit
+			    << "\"/>\n              </lines>\n";
+			out << "            </method>\n";
+		}
+		out << "          </methods>\n";
+
+		out << "          <lines>\n";
+		for (auto &l : f.second.lines) {
+			out << "            <line number=\"" << l.first << "\" hits=\"" << l.second.hit << "\" branch=\"";
+			if (l.second.branches.empty()) {
+				out << "false\"/>\n";
+				continue;
+			}
+			unsigned n = 0;
+			for (auto &b : l.second.branches) n += b.first + b.second;
+			unsigned total = 2 * l.second.branches.size();
+			out << "true\" condition-coverage=\"" << n * 100 / total << "% (" << n << "/" << total << ")\"/>\n";
+		}
+		out << "          </lines>\n";
+		out << "        </class>\n";
+	}
+
+	out << "      </classes>\n    </package>\n  </packages>\n</coverage>\n";
+}
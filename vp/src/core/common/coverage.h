@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dwarf_line.h"
+#include "instr.h"
+#include "symbol_index.h"
+
+/*
+ * Guest code coverage (--coverage-file) of unmodified, e.g. release, ELFs
+ * built with -g, as alternative to gcov instrumented guests (sw/basic-gcov).
+ * While running only bitmaps are updated: one bit per halfword for executed
+ * instructions and, for conditional branches, taken and not taken. The
+ * bitmaps are allocated per 4 KiB page on first execution and shared by
+ * all harts. At exit the DWARF line tables of the guest ELFs map the bits
+ * to source lines and an lcov tracefile is written, or Cobertura XML if the
+ * file name ends in ".xml". As only bits are recorded, every hit count is
+ * zero or one.
+ */
+class Coverage {
+	static constexpr unsigned page_bits = 12;
+	static constexpr uint64_t page_mask = (1 << page_bits) - 1;
+	static constexpr unsigned page_words = (1 << page_bits) / 2 / 64;
+
+	struct Page {
+		uint64_t executed[page_words] = {};
+		uint64_t taken[page_words] = {};
+		uint64_t not_taken[page_words] = {};
+	};
+
+	struct Report;
+
+	const std::string path;
+	const std::vector<SymbolIndex::File> elfs;
+
+	std::unordered_map<uint64_t, std::unique_ptr<Page>> pages;
+	uint64_t last_page_number = ~0ull;
+	Page *last_page = nullptr;
+
+   public:
+	// the code and line table of a guest ELF
+	struct Image {
+		// contents of an executable PT_LOAD segment
+		struct Segment {
+			uint64_t start;
+			std::vector<uint8_t> data;
+
+			bool contains(uint64_t addr, uint64_t size) const {
+				return addr >= start && addr + size <= start + data.size();
+			}
+
+			uint32_t half(uint64_t addr) const {
+				return data[addr - start] | (data[addr - start + 1] << 8);
+			}
+		};
+
+		Architecture arch;
+		int64_t offset = 0;  // added to the addresses of the ELF when loaded
+		DwarfLineTable lines;
+		std::vector<Segment> code;
+		std::vector<ElfSymbol> symbols;
+	};
+
+   private:
+	Page *get_page(uint64_t number);
+	const Page *find_page(uint64_t addr) const;
+	void add_image(const Image &image, Report &report) const;
+	void write_lcov(std::ostream &out, const Report &report) const;
+	void write_cobertura(std::ostream &out, const Report &report) const;
+
+	Page *page(uint64_t addr) {
+		uint64_t number = addr >> page_bits;
+		if (number != last_page_number) {
+			last_page = get_page(number);
+			last_page_number = number;
+		}
+		return last_page;
+	}
+
+	static void set(uint64_t *bits, uint64_t addr) {
+		unsigned i = (addr & page_mask) >> 1;
+		bits[i / 64] |= 1ull << (i % 64);
+	}
+
+	static bool test(const uint64_t *bits, uint64_t addr) {
+		unsigned i = (addr & page_mask) >> 1;
+		return bits[i / 64] & (1ull << (i % 64));
+	}
+
+   public:
+	// the ELFs to map the coverage to, usually the input program and --symbols files
+	Coverage(const std::string &path, const std::vector<SymbolIndex::File> &elfs);
+	// writes the report
+	~Coverage();
+
+	// writes the report of the images, as Cobertura XML or lcov tracefile
+	void write(std::ostream &out, const std::vector<Image> &images, bool cobertura) const;
+
+	// called after every executed instruction, instr is the (expanded) instruction at pc
+	void step(uint64_t pc, uint64_t next_pc, Instruction instr, Opcode::Mapping op) {
+		Page *p = page(pc);
+		set(p->executed, pc);
+		if (op >= Opcode::BEQ && op <= Opcode::BGEU)
+			set(next_pc == pc + (int64_t)instr.B_imm() ? p->taken : p->not_taken, pc);
+	}
+
+	// called for instructions which trapped, e.g. ecall, they were reached nonetheless
+	void reached(uint64_t pc) {
+		set(page(pc)->executed, pc);
+	}
+};
@@ -0,0 +1,340 @@
+#include "dwarf_line.h"
+
+#include <string.h>
+
+#include <stdexcept>
+
+namespace {
+
+// standard opcodes
+constexpr uint8_t DW_LNS_copy = 1;
+constexpr uint8_t DW_LNS_advance_pc = 2;
+constexpr uint8_t DW_LNS_advance_line = 3;
+constexpr uint8_t DW_LNS_set_file = 4;
+constexpr uint8_t DW_LNS_const_add_pc = 8;
+constexpr uint8_t DW_LNS_fixed_advance_pc = 9;
+
+// extended opcodes
+constexpr uint8_t DW_LNE_end_sequence = 1;
+constexpr uint8_t DW_LNE_set_address = 2;
+constexpr uint8_t DW_LNE_define_file = 3;
+
+// DWARF 5 entry formats
+constexpr uint64_t DW_LNCT_path = 1;
+constexpr uint64_t DW_LNCT_directory_index = 2;
+
+constexpr uint64_t DW_FORM_block = 0x09;
+constexpr uint64_t DW_FORM_data1 = 0x0b;
+constexpr uint64_t DW_FORM_data2 = 0x05;
+constexpr uint64_t DW_FORM_data4 = 0x06;
+constexpr uint64_t DW_FORM_data8 = 0x07;
+constexpr uint64_t DW_FORM_data16 = 0x1e;
+constexpr uint64_t DW_FORM_string = 0x08;
+constexpr uint64_t DW_FORM_strp = 0x0e;
+constexpr uint64_t DW_FORM_line_strp = 0x1f;
+constexpr uint64_t DW_FORM_udata = 0x0f;
+
+// bounds checked little endian reader
+struct Reader {
+	const uint8_t *p;
+	const uint8_t *end;
+
+	void need(size_t n) {
+		if ((size_t)(end - p) < n)
+			throw std::runtime_error("truncated .debug_line section");
+	}
+
+	uint64_t fixed(unsigned n) {
+		need(n);
+		uint64_t v = 0;
+		for (unsigned i = 0; i < n; ++i) v |= (uint64_t)p[i] << (8 * i);
+		p += n;
+		return v;
+	}
+
+	uint8_t u8() {
+		return fixed(1);
+	}
+
+	uint64_t uleb() {
+		uint64_t v = 0;
+		unsigned shift = 0;
+		uint8_t b;
+		do {
+			b = u8();
+			if (shift < 64)
+				v |= (uint64_t)(b & 0x7f) << shift;
+			shift += 7;
+		} while (b & 0x80);
+		return v;
+	}
+
+	int64_t sleb() {
+		int64_t v = 0;
+		unsigned shift = 0;
+		uint8_t b;
+		do {
+			b = u8();
+			if (shift < 64)
+				v |= (int64_t)(b & 0x7f) << shift;
+			shift += 7;
+		} while (b & 0x80);
+		if (shift < 64 && (b & 0x40))
+			v |= -((int64_t)1 << shift);
+		return v;
+	}
+
+	std::string str() {
+		auto n = strnlen((const char *)p, end - p);
+		need(n + 1);
+		std::string s((const char *)p, n);
+		p += n + 1;
+		return s;
+	}
+
+	void skip(size_t n) {
+		need(n);
+		p += n;
+	}
+};
+
+std::string section_string(DwarfLineTable::Section s, uint64_t offset) {
+	if (offset >= s.size)
+		throw std::runtime_error("invalid string offset in .debug_line");
+	return std::string((const char *)s.data + offset, strnlen((const char *)s.data + offset, s.size - offset));
+}
+
+std::string join_path(const std::string &dir, const std::string &name) {
+	if (dir.empty() || name.empty() || name[0] == '/')
+		return name;
+	return dir + "/" + name;
+}
+
+}  // namespace
+
+void DwarfLineTable::parse(Section debug_line, Section debug_line_str, Section debug_str) {
+	Reader r{debug_line.data, debug_line.data + debug_line.size};
+
+	while (r.p < r.end) {
+		uint64_t length = r.fixed(4);
+		bool dwarf64 = length == 0xffffffff;
+		if (dwarf64)
+			length = r.fixed(8);
+
+		r.need(length);
+		parse_unit(r.p, r.p + length, dwarf64, debug_line_str, debug_str);
+		r.p += length;
+	}
+}
+
+void DwarfLineTable::parse_unit(const uint8_t *begin, const uint8_t *end, bool dwarf64, Section debug_line_str,
+                                Section debug_str) {
+	Reader r{begin, end};
+	unsigned offset_size = dwarf64 ? 8 : 4;
+
+	unsigned version = r.fixed(2);
+	if (version < 2 || version > 5)
+		throw std::runtime_error("unsupported .debug_line version " + std::to_string(version));
+	if (version >= 5) {
+		r.u8();  // address size, DW_LNE_set_address tells it as well
+		r.u8();  // segment selector size
+	}
+
+	uint64_t header_length = r.fixed(offset_size);
+	r.need(header_length);
+	const uint8_t *program = r.p + header_length;
+
+	unsigned min_instr_length = r.u8();
+	if (version >= 4)
+		r.u8();  // maximum operations per instruction, only relevant for VLIW
+	r.u8();  // default is_stmt, all rows are used
+	int line_base = (int8_t)r.u8();
+	unsigned line_range = r.u8();
+	unsigned opcode_base = r.u8();
+	if (line_range == 0)
+		throw std::runtime_error("invalid .debug_line header");
+
+	std::vector<uint8_t> opcode_lengths(opcode_base);
+	for (unsigned i = 1; i < opcode_base; ++i) opcode_lengths[i] = r.u8();
+
+	// files of this unit, indexes into the deduplicated table of all units
+	std::vector<std::string> dirs;
+	std::vector<uint32_t> unit_files;
+	unsigned first_file = 0;
+	auto add_file = [&](const std::string &path) {
+		auto it = file_index.emplace(path, files.size());
+		if (it.second)
+			files.push_back(path);
+		unit_files.push_back(it.first->second);
+	};
+
+	if (version < 5) {
+		// directory 0 is the compilation directory, which is not part of the line table
+		dirs.push_back("");
+		for (std::string dir = r.str(); !dir.empty(); dir = r.str()) dirs.push_back(dir);
+
+		// file numbers start at one
+		first_file = 1;
+		unit_files.push_back(0);
+		for (std::string name = r.str(); !name.empty(); name = r.str()) {
+			uint64_t dir = r.uleb();
+			r.uleb();  // modification time
+			r.uleb();  // length
+			add_file(join_path(dir < dirs.size() ? dirs[dir] : "", name));
+		}
+	} else {
+		auto read_entries = [&](std::vector<std::pair<std::string, uint64_t>> &entries) {
+			std::vector<std::pair<uint64_t, uint64_t>> format(r.u8());
+			for (auto &f : format) {
+				f.first = r.uleb();
+				f.second = r.uleb();
+			}
+
+			uint64_t count = r.uleb();
+			for (uint64_t i = 0; i < count; ++i) {
+				std::string path;
+				uint64_t dir = 0;
+				for (auto &f : format) {
+					std::string s;
+					uint64_t v = 0;
+					switch (f.second) {
+						case DW_FORM_string:
+							s = r.str();
+							break;
+						case DW_FORM_line_strp:
+							s = section_string(debug_line_str, r.fixed(offset_size));
+							break;
+						case DW_FORM_strp:
+							s = section_string(debug_str, r.fixed(offset_size));
+							break;
+						case DW_FORM_udata:
+							v = r.uleb();
+							break;
+						case DW_FORM_data1:
+							v = r.fixed(1);
+							break;
+						case DW_FORM_data2:
+							v = r.fixed(2);
+							break;
+						case DW_FORM_data4:
+							v = r.fixed(4);
+							break;
+						case DW_FORM_data8:
+							v = r.fixed(8);
+							break;
+						case DW_FORM_data16:
+							r.skip(16);
+							break;
+						case DW_FORM_block:
+							r.skip(r.uleb());
+							break;
+						default:
+							throw std::runtime_error("unsupported form " + std::to_string(f.second) + " in .debug_line");
+					}
+
+					if (f.first == DW_LNCT_path)
+						path = s;
+					else if (f.first == DW_LNCT_directory_index)
+						dir = v;
+				}
+				entries.push_back({path, dir});
+			}
+		};
+
+		std::vector<std::pair<std::string, uint64_t>> dir_entries, file_entries;
+		read_entries(dir_entries);
+		for (auto &d : dir_entries) dirs.push_back(d.first);
+
+		// file numbers start at zero
+		read_entries(file_entries);
+		for (auto &f : file_entries) add_file(join_path(f.second < dirs.size() ? dirs[f.second] : "", f.first));
+	}
+
+	// the line number program
+	r.p = program;
+
+	uint64_t address = 0;
+	uint64_t file = 1;
+	int64_t line = 1;
+	bool sequence = false;
+	uint64_t row_address = 0;
+	uint64_t row_file = 0;
+	int64_t row_line = 0;
+
+	auto emit_row = [&]() {
+		if (sequence && address > row_address && row_file >= first_file && row_file < unit_files.size() &&
+		    row_line > 0)
+			ranges.push_back({row_address, address, unit_files[row_file], (uint32_t)row_line});
+		sequence = true;
+		row_address = address;
+		row_file = file;
+		row_line = line;
+	};
+
+	while (r.p < r.end) {
+		uint8_t opcode = r.u8();
+
+		if (opcode >= opcode_base) {
+			// special opcode
+			unsigned adjusted = opcode - opcode_base;
+			address += (adjusted / line_range) * min_instr_length;
+			line += line_base + (int)(adjusted % line_range);
+			emit_row();
+			continue;
+		}
+
+		switch (opcode) {
+			case 0: {
+				uint64_t length = r.uleb();
+				r.need(length);
+				if (length == 0)
+					break;
+				const uint8_t *next = r.p + length;
+				uint8_t sub = r.u8();
+				if (sub == DW_LNE_end_sequence) {
+					emit_row();
+					sequence = false;
+					address = 0;
+					file = 1;
+					line = 1;
+				} else if (sub == DW_LNE_set_address) {
+					address = r.fixed(length - 1 < 8 ? length - 1 : 8);
+				} else if (sub == DW_LNE_define_file && version < 5) {
+					std::string name = r.str();
+					uint64_t dir = r.uleb();
+					add_file(join_path(dir < dirs.size() ? dirs[dir] : "", name));
+				}
+				r.p = next;
+			} break;
+
+			case DW_LNS_copy:
+				emit_row();
+				break;
+
+			case DW_LNS_advance_pc:
+				address += r.uleb() * min_instr_length;
+				break;
+
+			case DW_LNS_advance_line:
+				line += r.sleb();
+				break;
+
+			case DW_LNS_set_file:
+				file = r.uleb();
+				break;
+
+			case DW_LNS_const_add_pc:
+				address += ((255 - opcode_base) / line_range) * min_instr_length;
+				break;
+
+			case DW_LNS_fixed_advance_pc:
+				address += r.fixed(2);
+				break;
+
+			default:
+				// other standard opcodes only change state not needed here, skip their operands
+				for (unsigned i = 0; i < opcode_lengths[opcode]; ++i) r.uleb();
+				break;
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Decoder of the DWARF line number programs in .debug_line (DWARF 2 to 5),
+ * mapping code address ranges to source lines. Only the line tables are
+ * read, not .debug_info, hence file names relative to the compilation
+ * directory of DWARF 4 and older units stay relative.
+ */
+class DwarfLineTable {
+   public:
+	struct Section {
+		const uint8_t *data = nullptr;
+		size_t size = 0;
+	};
+
+	// [start, end) belongs to the line, file indexes files
+	struct Range {
+		uint64_t start;
+		uint64_t end;
+		uint32_t file;
+		uint32_t line;
+	};
+
+	std::vector<std::string> files;
+	std::vector<Range> ranges;
+
+	// .debug_line_str and .debug_str are only needed for DWARF 5
+	void parse(Section debug_line, Section debug_line_str, Section debug_str);
+
+   private:
+	std::unordered_map<std::string, uint32_t> file_index;
+
+	void parse_unit(const uint8_t *begin, const uint8_t *end, bool dwarf64, Section debug_line_str, Section debug_str);
+};
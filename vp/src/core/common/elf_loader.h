@@ -2,9 +2,22 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+struct ElfSymbol {
+	std::string name;
+	uint64_t addr;
+	uint64_t size;  // zero if unknown (e.g. assembler labels)
+	bool code;      // function or untyped label, otherwise a data object
+};
+
 template <typename T>
 struct GenericElfLoader {
 	typedef typename T::addr_t addr_t;
@@ -18,10 +31,43 @@ struct GenericElfLoader {
 	boost::iostreams::mapped_file_source elf;
 	const Elf_Ehdr *hdr;
 
+	// built once at load, the first entry wins for duplicate names
+	std::unordered_map<std::string, const Elf_Shdr *> sections_by_name;
+	std::unordered_map<std::string, const Elf_Sym *> symbols_by_name;
+
 	GenericElfLoader(const char *filename) : filename(filename), elf(filename) {
 		assert(elf.is_open() && "file not open");
 
 		hdr = reinterpret_cast<const Elf_Ehdr *>(elf.data());
+		build_index();
+	}
+
+	void build_index() {
+		if (hdr->e_shoff == 0)
+			return;
+
+		const char *strings = get_section_string_table();
+		for (unsigned i = 0; i < hdr->e_shnum; ++i) {
+			const Elf_Shdr *s = reinterpret_cast<const Elf_Shdr *>(elf.data() + hdr->e_shoff + hdr->e_shentsize * i);
+			sections_by_name.emplace(strings + s->sh_name, s);
+		}
+
+		auto symtab = sections_by_name.find(".symtab");
+		auto strtab = sections_by_name.find(".strtab");
+		if (symtab == sections_by_name.end() || strtab == sections_by_name.end())
+			return;  // stripped
+
+		const Elf_Shdr *s = symtab->second;
+		assert(s->sh_size % sizeof(Elf_Sym) == 0);
+		strings = elf.data() + strtab->second->sh_offset;
+
+		auto num_entries = s->sh_size / sizeof(Elf_Sym);
+		symbols_by_name.reserve(num_entries);
+		for (unsigned i = 0; i < num_entries; ++i) {
+			const Elf_Sym *p = reinterpret_cast<const Elf_Sym *>(elf.data() + s->sh_offset + i * sizeof(Elf_Sym));
+			if (p->st_name)
+				symbols_by_name.emplace(strings + p->st_name, p);
+		}
 	}
 
 	std::vector<const Elf_Phdr *> get_load_sections() {
@@ -104,23 +150,12 @@ struct GenericElfLoader {
 	}
 
 	const Elf_Sym *get_symbol(const char *symbol_name) {
-		const Elf_Shdr *s = get_section(".symtab");
-		const char *strings = get_symbol_string_table();
-
-		assert(s->sh_size % sizeof(Elf_Sym) == 0);
-
-		auto num_entries = s->sh_size / sizeof(typename T::Elf_Sym);
-		for (unsigned i = 0; i < num_entries; ++i) {
-			const Elf_Sym *p = reinterpret_cast<const Elf_Sym *>(elf.data() + s->sh_offset + i * sizeof(Elf_Sym));
+		get_section(".symtab");  // throws if there is no symbol table
 
-			// std::cout << "check symbol: " << strings + p->st_name << std::endl;
-
-			if (!strcmp(strings + p->st_name, symbol_name)) {
-				return p;
-			}
-		}
-
-		throw std::runtime_error("unable to find symbol in the symbol table " + std::string(symbol_name));
+		auto it = symbols_by_name.find(symbol_name);
+		if (it == symbols_by_name.end())
+			throw std::runtime_error("unable to find symbol in the symbol table " + std::string(symbol_name));
+		return it->second;
 	}
 
 	addr_t get_begin_signature_address() {
@@ -138,23 +173,52 @@ struct GenericElfLoader {
         return p->st_value;
     }
 
+	// defined functions, untyped labels and data objects, e.g. for a SymbolIndex
+	std::vector<ElfSymbol> get_symbols() {
+		constexpr unsigned STT_NOTYPE = 0;
+		constexpr unsigned STT_OBJECT = 1;
+		constexpr unsigned STT_FUNC = 2;
+		constexpr unsigned SHF_EXECINSTR = 4;
+
+		std::vector<ElfSymbol> symbols;
+		auto symtab = sections_by_name.find(".symtab");
+		auto strtab = sections_by_name.find(".strtab");
+		if (symtab == sections_by_name.end() || strtab == sections_by_name.end())
+			return symbols;
+
+		// all entries, names of local symbols need not be unique
+		const Elf_Shdr *s = symtab->second;
+		const char *strings = elf.data() + strtab->second->sh_offset;
+		auto num_entries = s->sh_size / sizeof(Elf_Sym);
+		for (unsigned i = 0; i < num_entries; ++i) {
+			const Elf_Sym *p = reinterpret_cast<const Elf_Sym *>(elf.data() + s->sh_offset + i * sizeof(Elf_Sym));
+			unsigned type = p->st_info & 0xf;
+			const char *name = strings + p->st_name;
+
+			// skip undefined and absolute symbols as well as local labels
+			if ((type != STT_FUNC && type != STT_NOTYPE && type != STT_OBJECT) || p->st_shndx == 0 ||
+			    p->st_shndx >= 0xff00 || !*name || name[0] == '.' || name[0] == '$')
+				continue;
+
+			// untyped labels are code if they are in an executable section
+			const Elf_Shdr *section =
+			    reinterpret_cast<const Elf_Shdr *>(elf.data() + hdr->e_shoff + hdr->e_shentsize * p->st_shndx);
+			bool code = type == STT_FUNC || (type == STT_NOTYPE && (section->sh_flags & SHF_EXECINSTR));
+			symbols.push_back({name, p->st_value, type == STT_NOTYPE ? 0 : p->st_size, code});
+		}
+
+		return symbols;
+	}
+
 	const Elf_Shdr *get_section(const char *section_name) {
 		if (hdr->e_shoff == 0) {
 			throw std::runtime_error("unable to find section address, section table not available: " +
 			                         std::string(section_name));
 		}
 
-		const char *strings = get_section_string_table();
-
-		for (unsigned i = 0; i < hdr->e_shnum; ++i) {
-			const Elf_Shdr *s = reinterpret_cast<const Elf_Shdr *>(elf.data() + hdr->e_shoff + hdr->e_shentsize * i);
-
-			// std::cout << "check section: " << strings + s->sh_name << std::endl;
-
-			if (!strcmp(strings + s->sh_name, section_name)) {
-				return s;
-			}
-		}
+		auto it = sections_by_name.find(section_name);
+		if (it != sections_by_name.end())
+			return it->second;
 
 		throw std::runtime_error("unable to find section address, section seems not available: " +
 		                         std::string(section_name));
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -16,6 +17,10 @@
 
 #include "gdb_server.h"
 #include "platform/common/async_event.h"
+#include "platform/common/io_reactor.h"
+
+/* maximum amount of bytes read from a GDB connection at once */
+#define GDB_READ_SIZE 4096
 
 extern std::map<std::string, GDBServer::packet_handler> handlers;
 
@@ -50,8 +55,8 @@ GDBServer::GDBServer(sc_core::sc_module_name name,
 
 	SC_THREAD(run);
 
-	thr = std::thread(&GDBServer::serve, this);
-	thr.detach();
+	IOReactor::get().add(sockfd, EPOLLIN,
+	                     std::bind(&GDBServer::accept_conn, this, std::placeholders::_1));
 }
 
 sc_core::sc_event *GDBServer::get_stop_event(debug_target_if *hart) {
@@ -235,46 +240,130 @@ void GDBServer::retransmit(int conn) {
 	 * packet transmit in the send_packet function */
 }
 
-void GDBServer::dispatch(int conn) {
-	FILE *stream;
-	gdb_packet_t *pkt;
+void GDBServer::accept_conn(uint32_t events) {
+	int conn;
 
-	if (!(stream = fdopen(conn, "r")))
-		throw std::system_error(errno, std::generic_category());
+	if (!(events & EPOLLIN))
+		return;
 
-	for (;;) {
-		mtx.lock();
-		if (!(pkt = gdb_parse_pkt(stream))) {
-			mtx.unlock();
-			break;
-		}
+	if ((conn = accept(sockfd, NULL, NULL)) == -1) {
+		warn("accept failed");
+		return;
+	}
 
-		pktq.push(std::make_tuple(conn, pkt));
-		asyncEvent.notify();
+	/* only serve one connection at a time, accepting is
+	 * resumed by the run() thread after disconnect */
+	IOReactor::get().modify(sockfd, 0);
+	inbuf.clear();
+	conn_closed = false;
+
+	IOReactor::get().add(conn, EPOLLIN,
+	                     std::bind(&GDBServer::receive, this, conn, std::placeholders::_1));
+}
 
-		/* further processing is performed in the SystemC run()
-		 * thread which interacts with the ISS objects and
-		 * unlocks the mutex after finishing all operations. */
+void GDBServer::receive(int conn, uint32_t events) {
+	char buf[GDB_READ_SIZE];
+	ssize_t ret;
+
+	/* don't read further input while run() is lagging behind */
+	bool drained = drain_backlog();
+	IOReactor::get().modify(conn, (drained && !conn_closed) ? EPOLLIN : 0);
+	if (!drained || conn_closed || !(events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+		return;
+
+	ret = read(conn, buf, sizeof(buf));
+	if (ret == -1 && (errno == EAGAIN || errno == EINTR))
+		return;
+
+	if (ret <= 0) {
+		if (ret == -1)
+			warn("read failed");
+
+		/* the connection is closed by run() after
+		 * it processed all outstanding packets */
+		conn_closed = true;
+		IOReactor::get().modify(conn, 0);
+		enqueue(conn, NULL);
+		return;
 	}
 
-	fclose(stream);
+	inbuf.append(buf, ret);
+	parse_packets(conn);
+
+	if (!backlog.empty())
+		IOReactor::get().modify(conn, 0);
 }
 
-void GDBServer::serve(void) {
-	int conn;
+void GDBServer::parse_packets(int conn) {
+	size_t pos = 0;
 
-	for (;;) {
-		if ((conn = accept(sockfd, NULL, NULL)) == -1) {
-			warn("accept failed");
+	while (pos < inbuf.size()) {
+		size_t len;
+
+		switch (inbuf[pos]) {
+		case '+':
+		case '-':
+			len = 1;
+			break;
+		case '$':
+		case '%': {
+			/* checksum consists of two characters after '#' */
+			size_t end = inbuf.find('#', pos);
+			if (end == std::string::npos || end + GDB_CSUM_LEN >= inbuf.size())
+				goto ret; /* incomplete packet */
+			len = end + GDB_CSUM_LEN + 1 - pos;
+			break;
+		}
+		default:
+			pos++; /* skip garbage between packets */
 			continue;
 		}
 
-		dispatch(conn);
-		close(conn);
+		FILE *stream;
+		gdb_packet_t *pkt;
 
-		free(prevpkt);
-		prevpkt = NULL;
+		if (!(stream = fmemopen(&inbuf[pos], len, "r")))
+			throw std::system_error(errno, std::generic_category());
+		pkt = gdb_parse_pkt(stream);
+		fclose(stream);
+
+		if (pkt)
+			enqueue(conn, pkt);
+		else
+			warnx("received malformed packet");
+		pos += len;
 	}
+
+ret:
+	inbuf.erase(0, pos);
+}
+
+void GDBServer::enqueue(int conn, gdb_packet_t *pkt) {
+	backlog.push_back(std::make_tuple(conn, pkt));
+	drain_backlog();
+}
+
+bool GDBServer::drain_backlog(void) {
+	bool pushed = false;
+
+	while (!backlog.empty()) {
+		if (!pktq.push(backlog.front())) {
+			/* Stop reading until run() consumed some packets.
+			 * Set the flag first to not miss a concurrent pop. */
+			if (!stalled.exchange(true))
+				continue;
+			break;
+		}
+		backlog.pop_front();
+		pushed = true;
+	}
+
+	if (backlog.empty())
+		stalled = false;
+	if (pushed)
+		asyncEvent.notify();
+
+	return backlog.empty();
 }
 
 void GDBServer::run(void) {
@@ -284,10 +373,26 @@ void GDBServer::run(void) {
 	packet_handler handler;
 
 	for (;;) {
-		sc_core::wait(asyncEvent);
+		ctx c;
+
+		if (!pktq.pop(c)) {
+			sc_core::wait(asyncEvent);
+			continue;
+		}
+		std::tie (conn, pkt) = c;
+
+		if (stalled)
+			IOReactor::get().wakeup(conn);
 
-		auto ctx = pktq.front();
-		std::tie (conn, pkt) = ctx;
+		if (!pkt) { /* connection was closed */
+			IOReactor::get().remove(conn);
+			close(conn);
+			free(prevpkt);
+			prevpkt = NULL;
+
+			IOReactor::get().modify(sockfd, EPOLLIN);
+			continue;
+		}
 
 		switch (pkt->kind) {
 		case GDB_KIND_NACK:
@@ -320,7 +425,5 @@ next2:
 		gdb_free_cmd(cmd);
 next1:
 		gdb_free_packet(pkt);
-		pktq.pop();
-		mtx.unlock();
 	}
 }
@@ -5,10 +5,10 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-#include <queue>
-#include <mutex>
+#include <atomic>
+#include <deque>
+#include <string>
 #include <systemc>
-#include <thread>
 #include <map>
 #include <tuple>
 #include <functional>
@@ -19,6 +19,7 @@
 #include "debug.h"
 #include "core_defs.h"
 #include "platform/common/async_event.h"
+#include "util/spsc_queue.h"
 #include "debug_memory.h" // DebugMemoryInterface
 
 SC_MODULE(GDBServer) {
@@ -68,12 +69,17 @@ private:
 	AsyncEvent asyncEvent;
 	Architecture arch;
 	std::vector<debug_target_if*> harts;
-	std::thread thr;
 	char *prevpkt;
-	std::queue<ctx> pktq;
-	std::mutex mtx;
 	int sockfd;
 
+	/* Packets are received on the IOReactor thread and processed in
+	 * the SystemC run() thread. A NULL packet signals disconnect. */
+	SPSCQueue<ctx, 64> pktq;
+	std::deque<ctx> backlog; /* only accessed by the reactor */
+	std::atomic<bool> stalled{false};
+	std::string inbuf;       /* only accessed by the reactor */
+	bool conn_closed = false; /* only accessed by the reactor */
+
 	/* operation → thread id */
 	std::map<char, int> thread_ops;
 
@@ -91,8 +97,11 @@ private:
 	void writeall(int, char *, size_t);
 	void send_packet(int, const char *, gdb_kind_t = GDB_KIND_PACKET);
 	void retransmit(int);
-	void dispatch(int conn);
-	void serve(void);
+	void accept_conn(uint32_t);
+	void receive(int conn, uint32_t);
+	void parse_packets(int conn);
+	void enqueue(int conn, gdb_packet_t *);
+	bool drain_backlog(void);
 	void run(void);
 };
 
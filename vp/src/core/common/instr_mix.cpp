@@ -0,0 +1,180 @@
+#include "instr_mix.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+struct InstrMix::Counts {
+	// indexed by privilege level, then opcode
+	std::array<std::array<uint64_t, Opcode::NUMBER_OF_INSTRUCTIONS>, 4> instrs{};
+	std::array<uint64_t, HartInstrMix::num_branches> taken{};
+
+	void add(const HartInstrMix &h) {
+		for (unsigned op = 0; op < Opcode::NUMBER_OF_INSTRUCTIONS; ++op) {
+			// every instruction counted by the hart is counted by its stats as well
+			uint64_t below_machine = 0;
+			for (unsigned prv = 0; prv < MachineMode; ++prv) {
+				instrs[prv][op] += h.instrs[prv][op];
+				below_machine += h.instrs[prv][op];
+			}
+			instrs[MachineMode][op] += h.stats.instrs[op] - below_machine;
+		}
+		for (unsigned b = 0; b < taken.size(); ++b) taken[b] += h.taken[b];
+	}
+};
+
+namespace {
+
+// "name": count pairs of the non zero counts, highest first
+void write_opcodes(std::ostream &out, const std::array<uint64_t, Opcode::NUMBER_OF_INSTRUCTIONS> &counts) {
+	std::vector<unsigned> ops;
+	for (unsigned op = 0; op < counts.size(); ++op) {
+		if (counts[op])
+			ops.push_back(op);
+	}
+	std::stable_sort(ops.begin(), ops.end(), [&](unsigned a, unsigned b) { return counts[a] > counts[b]; });
+
+	out << "{";
+	for (size_t i = 0; i < ops.size(); ++i)
+		out << (i ? ", " : "") << "\"" << Opcode::mappingStr[ops[i]] << "\": " << counts[ops[i]];
+	out << "}";
+}
+
+void write_branch(std::ostream &out, const char *name, uint64_t taken, uint64_t executed) {
+	out << "\"" << name << "\": {\"taken\": " << taken << ", \"not_taken\": " << executed - taken
+	    << ", \"taken_ratio\": " << (executed ? (double)taken / executed : 0) << "}";
+}
+
+}  // namespace
+
+unsigned InstrMix::access_size(Opcode::Mapping op) {
+	using namespace Opcode;
+
+	switch (op) {
+		case LB:
+		case LBU:
+		case SB:
+			return 1;
+
+		case LH:
+		case LHU:
+		case SH:
+			return 2;
+
+		case LW:
+		case LWU:
+		case SW:
+		case FLW:
+		case FSW:
+			return 4;
+
+		case LD:
+		case SD:
+		case FLD:
+		case FSD:
+			return 8;
+
+		default:
+			break;
+	}
+
+	if (op >= LR_W && op <= AMOMAXU_W)
+		return 4;
+	if (op >= LR_D && op <= AMOMAXU_D)
+		return 8;
+	return 0;
+}
+
+InstrMix::InstrMix(const std::string &path) : path(path) {
+	// fail early instead of after the simulation
+	std::ofstream out(path);
+	if (!out)
+		throw std::runtime_error("unable to write instruction mix file " + path);
+}
+
+InstrMix::~InstrMix() {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "[instr-mix] unable to write " << path << std::endl;
+		return;
+	}
+
+	Counts total;
+	out << "{\"harts\": [";
+	for (size_t i = 0; i < harts.size(); ++i) {
+		Counts counts;
+		counts.add(*harts[i]);
+		total.add(*harts[i]);
+
+		out << (i ? ",\n   " : "\n   ") << "{\"hart\": " << harts[i]->hart_id << ", ";
+		write_json(out, counts);
+		out << "}";
+	}
+	out << "],\n \"total\": {";
+	write_json(out, total);
+	out << "}}" << std::endl;
+}
+
+void InstrMix::write_json(std::ostream &out, const Counts &mix) {
+	static const char *prv_names[] = {"U", "S", "H", "M"};
+
+	std::array<uint64_t, Opcode::NUMBER_OF_INSTRUCTIONS> opcodes{};
+	for (auto &counts : mix.instrs) {
+		for (unsigned op = 0; op < counts.size(); ++op) opcodes[op] += counts[op];
+	}
+
+	uint64_t instrs = 0;
+	for (auto n : opcodes) instrs += n;
+	out << "\"instructions\": " << instrs << ",\n    \"privilege\": {";
+
+	bool first = true;
+	for (unsigned prv = 0; prv < mix.instrs.size(); ++prv) {
+		uint64_t n = 0;
+		for (auto c : mix.instrs[prv]) n += c;
+		if (!n)
+			continue;
+		out << (first ? "" : ",") << "\n      \"" << prv_names[prv] << "\": {\"instructions\": " << n
+		    << ", \"opcodes\": ";
+		write_opcodes(out, mix.instrs[prv]);
+		out << "}";
+		first = false;
+	}
+	out << "},\n    \"opcodes\": ";
+	write_opcodes(out, opcodes);
+
+	// accesses by kind and size in bytes (1, 2, 4, 8)
+	uint64_t sizes[3][4] = {};
+	for (unsigned op = 0; op < opcodes.size(); ++op) {
+		unsigned size = access_size((Opcode::Mapping)op);
+		if (!size || !opcodes[op])
+			continue;
+		auto c = Stats::classify((Opcode::Mapping)op);
+		unsigned kind = c == Stats::LOAD ? 0 : (c == Stats::STORE ? 1 : 2);
+		sizes[kind][__builtin_ctz(size)] += opcodes[op];
+	}
+	static const char *kinds[] = {"load", "store", "atomic"};
+	out << ",\n    \"access_sizes\": {";
+	for (unsigned k = 0; k < 3; ++k) {
+		out << (k ? ", " : "") << "\"" << kinds[k] << "\": {";
+		for (unsigned s = 0; s < 4; ++s) out << (s ? ", " : "") << "\"" << (1 << s) << "\": " << sizes[k][s];
+		out << "}";
+	}
+
+	uint64_t taken = 0, executed = 0;
+	out << "},\n    \"branches\": {";
+	for (unsigned b = 0; b < mix.taken.size(); ++b) {
+		unsigned op = Opcode::BEQ + b;
+		write_branch(out, Opcode::mappingStr[op], mix.taken[b], opcodes[op]);
+		out << ", ";
+		taken += mix.taken[b];
+		executed += opcodes[op];
+	}
+	write_branch(out, "all", taken, executed);
+	out << "}";
+}
+
+HartInstrMix *InstrMix::add_hart(unsigned hart_id, const HartStats &stats) {
+	harts.emplace_back(new HartInstrMix(hart_id, stats));
+	return harts.back().get();
+}
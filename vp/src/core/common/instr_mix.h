@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "instr.h"
+#include "irq_if.h"
+#include "stats.h"
+
+/*
+ * Instruction mix (--instr-mix-file) for workload characterization. The
+ * executed instructions per opcode are the HartStats counters, which are
+ * always maintained. On top of them every hart counts its instructions per
+ * opcode in the user, supervisor and hypervisor level, the machine level
+ * ones follow from the difference, and the taken conditional branches per
+ * opcode, in plain arrays. Harts without a HartInstrMix only pay for the
+ * null pointer checks. At exit the counts are written as JSON together with
+ * the load, store and atomic access sizes, which follow from the opcodes,
+ * and the branch taken ratios.
+ */
+class HartInstrMix {
+	friend class InstrMix;
+
+	static constexpr unsigned num_branches = Opcode::BGEU - Opcode::BEQ + 1;
+
+	const unsigned hart_id;
+	const HartStats &stats;
+
+	// indexed by privilege level below MachineMode, then opcode
+	std::array<std::array<uint64_t, Opcode::NUMBER_OF_INSTRUCTIONS>, MachineMode> instrs{};
+	// indexed by the offset of the opcode to BEQ, not taken ones follow from the executed ones
+	std::array<uint64_t, num_branches> taken{};
+
+   public:
+	HartInstrMix(unsigned hart_id, const HartStats &stats) : hart_id(hart_id), stats(stats) {}
+
+	// called for every decoded instruction, with the privilege level it executes in
+	void begin(PrivilegeLevel prv, Opcode::Mapping op) {
+		if (prv != MachineMode)
+			++instrs[prv][op];
+	}
+
+	// called after every executed instruction, instr is the (expanded) instruction at pc
+	void end(uint64_t pc, uint64_t next_pc, Instruction instr, Opcode::Mapping op) {
+		if (op >= Opcode::BEQ && op <= Opcode::BGEU && next_pc == pc + (int64_t)instr.B_imm())
+			++taken[op - Opcode::BEQ];
+	}
+};
+
+class InstrMix {
+	struct Counts;
+
+	const std::string path;
+
+	std::vector<std::unique_ptr<HartInstrMix>> harts;
+
+	static void write_json(std::ostream &out, const Counts &mix);
+
+   public:
+	// bytes accessed by loads, stores and atomics, zero for other instructions
+	static unsigned access_size(Opcode::Mapping op);
+
+	InstrMix(const std::string &path);
+	// writes the JSON report
+	~InstrMix();
+
+	// stats are the counters of the same hart
+	HartInstrMix *add_hart(unsigned hart_id, const HartStats &stats);
+};
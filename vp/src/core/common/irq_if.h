@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include <functional>
+
 typedef uint32_t PrivilegeLevel;
 
 constexpr uint32_t MachineMode = 0b11;
@@ -28,7 +30,26 @@ struct clint_interrupt_target {
 struct interrupt_gateway {
 	virtual ~interrupt_gateway() {}
 
+	/* Must be safe to call from host threads other than the SystemC
+	 * thread, e.g. from IOReactor handlers. */
 	virtual void gateway_trigger_interrupt(uint32_t irq_id) = 0;
+
+	/*
+	 * Optional interface for devices that generate interrupts periodically.
+	 * Such devices only need to schedule events while at least one hart has
+	 * the interrupt enabled. The callback is invoked whenever the enable state
+	 * of the given interrupt may have changed. Gateways that do not track this
+	 * report every interrupt as enabled.
+	 */
+	virtual bool gateway_interrupt_enabled(uint32_t irq_id) {
+		(void)irq_id;
+		return true;
+	}
+
+	virtual void gateway_on_enable_change(uint32_t irq_id, std::function<void()> callback) {
+		(void)irq_id;
+		(void)callback;
+	}
 };
 
 #endif  // RISCV_ISA_IRQ_IF_H
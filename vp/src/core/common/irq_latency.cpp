@@ -0,0 +1,157 @@
+#include "irq_latency.h"
+
+#include <stdio.h>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+unsigned LatencyHistogram::bucket(uint64_t v) {
+	// values below 2^sub_bits have a bucket each, above the leading bits select one
+	if (v < (1u << sub_bits))
+		return v;
+	unsigned shift = 63 - __builtin_clzll(v) - sub_bits;
+	return ((shift + 1) << sub_bits) | ((v >> shift) & ((1u << sub_bits) - 1));
+}
+
+uint64_t LatencyHistogram::bucket_max(unsigned i) {
+	if (i < (1u << sub_bits))
+		return i;
+	unsigned shift = (i >> sub_bits) - 1;
+	uint64_t lower = (uint64_t)((1u << sub_bits) | (i & ((1u << sub_bits) - 1))) << shift;
+	return lower + ((uint64_t)1 << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+	if (!count)
+		return 0;
+
+	uint64_t rank = std::ceil(p / 100 * count);
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < buckets.size(); ++i) {
+		seen += buckets[i];
+		if (seen >= rank)
+			return std::min(bucket_max(i), max);
+	}
+	return max;
+}
+
+const char *IrqLatency::stage_name(Stage s) {
+	static const char *names[NUM_STAGES] = {"trigger_to_raise", "trigger_to_entry", "trigger_to_claim",
+	                                        "claim_to_complete"};
+	return names[s];
+}
+
+IrqLatency::IrqLatency(unsigned num_irqs, unsigned num_harts, sc_core::sc_time cycle_time)
+    : cycle_time(cycle_time.value()), triggered(num_irqs), harts(num_harts), irqs(num_irqs) {}
+
+void IrqLatency::trigger(uint32_t irq, const sc_core::sc_time &now) {
+	if (irq >= triggered.size())
+		return;
+	uint64_t none = 0;
+	triggered[irq].compare_exchange_strong(none, now.value() + 1);
+}
+
+void IrqLatency::raise(unsigned hart, const sc_core::sc_time &now) {
+	if (hart < harts.size() && !harts[hart].raised)
+		harts[hart].raised = now.value() + 1;
+}
+
+void IrqLatency::enter(unsigned hart, const sc_core::sc_time &now) {
+	if (hart < harts.size())
+		harts[hart].entered = now.value() + 1;
+}
+
+void IrqLatency::claim(unsigned hart, uint32_t irq, const sc_core::sc_time &now) {
+	if (hart >= harts.size() || irq == 0 || irq >= triggered.size())
+		return;
+
+	auto &h = harts[hart];
+	uint64_t t = now.value() + 1;
+	uint64_t trig = triggered[irq].exchange(0);
+	if (trig) {
+		// raise and entry belong to this interrupt only if they follow its trigger
+		if (h.raised >= trig)
+			add(irq, TRIGGER_TO_RAISE, trig, h.raised);
+		if (h.entered >= trig)
+			add(irq, TRIGGER_TO_ENTRY, trig, h.entered);
+		add(irq, TRIGGER_TO_CLAIM, trig, t);
+	}
+	// the next raise is due to another interrupt
+	h.raised = 0;
+
+	h.claimed_irq = irq;
+	h.claimed = t;
+}
+
+void IrqLatency::complete(unsigned hart, uint32_t irq, const sc_core::sc_time &now) {
+	if (hart >= harts.size())
+		return;
+
+	auto &h = harts[hart];
+	if (h.claimed && h.claimed_irq == irq)
+		add(irq, CLAIM_TO_COMPLETE, h.claimed, now.value() + 1);
+	h.claimed = 0;
+}
+
+void IrqLatency::add(uint32_t irq, Stage stage, uint64_t from, uint64_t to) {
+	auto &i = irqs[irq];
+	if (!i)
+		i.reset(new Irq());
+	i->stages[stage].add(to >= from ? (to - from) / cycle_time : 0);
+}
+
+void IrqLatency::print(std::ostream &out) const {
+	char buf[128];
+	out << "=[ interrupt latency ]====================" << std::endl;
+	snprintf(buf, sizeof(buf), "%4s  %-18s %8s %8s %10s %8s %8s\n", "irq", "stage (cycles)", "count", "min", "avg", "p99",
+	         "max");
+	out << buf;
+	for (unsigned irq = 0; irq < irqs.size(); ++irq) {
+		if (!irqs[irq])
+			continue;
+		for (unsigned s = 0; s < NUM_STAGES; ++s) {
+			auto &h = irqs[irq]->stages[s];
+			if (!h.count)
+				continue;
+			snprintf(buf, sizeof(buf), "%4u  %-18s %8lu %8lu %10.1f %8lu %8lu\n", irq, stage_name((Stage)s),
+			         (unsigned long)h.count, (unsigned long)h.min, h.avg(), (unsigned long)h.percentile(99),
+			         (unsigned long)h.max);
+			out << buf;
+		}
+	}
+}
+
+void IrqLatency::write_json(std::ostream &out) const {
+	out << "{\"cycle_time_s\": " << sc_core::sc_time::from_value(cycle_time).to_seconds() << ",\n \"irqs\": [";
+	bool first = true;
+	for (unsigned irq = 0; irq < irqs.size(); ++irq) {
+		if (!irqs[irq])
+			continue;
+		out << (first ? "\n   " : ",\n   ") << "{\"irq\": " << irq;
+		for (unsigned s = 0; s < NUM_STAGES; ++s) {
+			auto &h = irqs[irq]->stages[s];
+			out << ", \"" << stage_name((Stage)s) << "\": {\"count\": " << h.count;
+			if (h.count) {
+				out << ", \"min\": " << h.min << ", \"avg\": " << h.avg() << ", \"p99\": " << h.percentile(99)
+				    << ", \"max\": " << h.max;
+			}
+			out << "}";
+		}
+		out << "}";
+		first = false;
+	}
+	out << "]}" << std::endl;
+}
+
+void IrqLatency::report(const std::string &json_path) const {
+	print(std::cout);
+
+	if (!json_path.empty()) {
+		std::ofstream out(json_path);
+		if (!out)
+			std::cerr << "[irq-latency] unable to write " << json_path << std::endl;
+		else
+			write_json(out);
+	}
+}
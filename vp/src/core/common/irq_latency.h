@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <systemc>
+#include <vector>
+
+/*
+ * Latency of PLIC interrupts (--irq-latency) in simulated cycles. The PLIC
+ * timestamps the gateway trigger of every interrupt and the raise of the
+ * external interrupt of a hart, the ISS the entry of its trap handler and
+ * the PLIC again claim and complete. When a hart claims an interrupt its
+ * latencies since the trigger are added to histograms of that interrupt,
+ * hence polled interrupts count as well, only without raise and entry.
+ * The histograms have fixed log-linear buckets, so recording is a handful
+ * of arithmetic and min, avg, p99 and max are available at exit.
+ */
+class LatencyHistogram {
+   public:
+	// 8 buckets per power of two, hence percentiles are within 12.5%
+	static constexpr unsigned sub_bits = 3;
+	static constexpr unsigned num_buckets = (64 - sub_bits + 1) << sub_bits;
+
+	static unsigned bucket(uint64_t v);
+	// the largest value of bucket i
+	static uint64_t bucket_max(unsigned i);
+
+   private:
+	std::array<uint64_t, num_buckets> buckets{};
+
+   public:
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t min = UINT64_MAX;
+	uint64_t max = 0;
+
+	void add(uint64_t v) {
+		++buckets[bucket(v)];
+		++count;
+		sum += v;
+		min = std::min(min, v);
+		max = std::max(max, v);
+	}
+
+	double avg() const {
+		return count ? (double)sum / count : 0;
+	}
+
+	// upper bound of the bucket containing the percentile, at most max
+	uint64_t percentile(double p) const;
+};
+
+class IrqLatency {
+   public:
+	enum Stage { TRIGGER_TO_RAISE, TRIGGER_TO_ENTRY, TRIGGER_TO_CLAIM, CLAIM_TO_COMPLETE, NUM_STAGES };
+
+	static const char *stage_name(Stage s);
+
+	IrqLatency(unsigned num_irqs, unsigned num_harts, sc_core::sc_time cycle_time);
+
+	/* Thread-safe like interrupt_gateway::gateway_trigger_interrupt. Only
+	 * the first trigger until the claim counts. */
+	void trigger(uint32_t irq, const sc_core::sc_time &now);
+	// the PLIC raised the external interrupt of the hart
+	void raise(unsigned hart, const sc_core::sc_time &now);
+	// the hart entered the trap handler of an external interrupt
+	void enter(unsigned hart, const sc_core::sc_time &now);
+	void claim(unsigned hart, uint32_t irq, const sc_core::sc_time &now);
+	void complete(unsigned hart, uint32_t irq, const sc_core::sc_time &now);
+
+	void print(std::ostream &out) const;
+	void write_json(std::ostream &out) const;
+	// prints the report and writes the JSON file, if any
+	void report(const std::string &json_path) const;
+
+   private:
+	// times are in units of the SystemC time resolution, plus one so zero means none
+	struct Hart {
+		uint64_t raised = 0;
+		uint64_t entered = 0;
+		uint32_t claimed_irq = 0;
+		uint64_t claimed = 0;
+	};
+
+	struct Irq {
+		std::array<LatencyHistogram, NUM_STAGES> stages;
+	};
+
+	const uint64_t cycle_time;
+
+	std::vector<std::atomic<uint64_t>> triggered;
+	std::vector<Hart> harts;
+	std::vector<std::unique_ptr<Irq>> irqs;  // allocated on the first claim
+
+	void add(uint32_t irq, Stage stage, uint64_t from, uint64_t to);
+};
@@ -0,0 +1,199 @@
+#include "metrics.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <system_error>
+#include <systemc>
+
+MetricsServer::MetricsServer(const std::string &path, const Stats &stats)
+    : stats(stats),
+      path(path),
+      time_resolution(sc_core::sc_get_time_resolution().to_seconds()),
+      start(clock::now()) {
+	create_sock();
+
+	last = sample();
+	mips.resize(stats.harts.size());
+	interrupt_rate.resize(stats.harts.size());
+
+	thread = std::thread(&MetricsServer::run, this);
+}
+
+MetricsServer::~MetricsServer() {
+	stop = true;
+	thread.join();
+
+	close(sockfd);
+	unlink(path.c_str());
+}
+
+void MetricsServer::create_sock() {
+	struct sockaddr_un addr;
+
+	if (path.size() >= sizeof(addr.sun_path))
+		throw std::runtime_error("metrics socket path too long: " + path);
+
+	sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sockfd == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	// remove a stale socket of a previous run
+	unlink(path.c_str());
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path.c_str());
+
+	if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+		goto err;
+	if (listen(sockfd, 4) == -1)
+		goto err;
+
+	return;
+err:
+	close(sockfd);
+	throw std::system_error(errno, std::generic_category());
+}
+
+void MetricsServer::run() {
+	struct pollfd fds = {sockfd, POLLIN, 0};
+
+	while (!stop) {
+		// wake up regularly to check for termination and to update the rates
+		int ret = poll(&fds, 1, 250);
+		if (ret > 0) {
+			int fd = accept4(sockfd, NULL, NULL, SOCK_CLOEXEC);
+			if (fd != -1) {
+				serve(fd);
+				close(fd);
+			}
+		}
+
+		if (clock::now() - last.time >= std::chrono::seconds(1))
+			update_rates();
+	}
+}
+
+MetricsServer::Sample MetricsServer::sample() {
+	Sample s;
+	s.time = clock::now();
+	for (auto &h : stats.harts) {
+		uint64_t instret = 0;
+		for (auto &n : h.stats->instrs) instret += n;
+		s.instret.push_back(instret);
+		s.interrupts.push_back(h.stats->interrupts);
+	}
+	return s;
+}
+
+void MetricsServer::update_rates() {
+	Sample s = sample();
+	double seconds = std::chrono::duration<double>(s.time - last.time).count();
+
+	for (size_t i = 0; i < s.instret.size(); ++i) {
+		mips[i] = (s.instret[i] - last.instret[i]) / seconds / 1e6;
+		interrupt_rate[i] = (s.interrupts[i] - last.interrupts[i]) / seconds;
+	}
+	last = std::move(s);
+}
+
+std::string MetricsServer::format() {
+	std::string out;
+	char buf[256];
+
+	auto header = [&](const char *name, const char *type, const char *help) {
+		snprintf(buf, sizeof(buf), "# HELP riscv_vp_%s %s\n# TYPE riscv_vp_%s %s\n", name, help, name, type);
+		out += buf;
+	};
+	auto hart_values = [&](const char *name, const char *type, const char *help, double (*value)(MetricsServer &, size_t)) {
+		header(name, type, help);
+		for (size_t i = 0; i < stats.harts.size(); ++i) {
+			snprintf(buf, sizeof(buf), "riscv_vp_%s{hart=\"%u\"} %.17g\n", name, stats.harts[i].id, value(*this, i));
+			out += buf;
+		}
+	};
+
+	auto hart_counter = [&](const char *name, Counter HartStats::*field, const char *help) {
+		header(name, "counter", help);
+		for (auto &h : stats.harts) {
+			snprintf(buf, sizeof(buf), "riscv_vp_%s{hart=\"%u\"} %lu\n", name, h.id, (unsigned long)(h.stats->*field));
+			out += buf;
+		}
+	};
+
+	header("uptime_seconds", "gauge", "Host time since the simulation started.");
+	snprintf(buf, sizeof(buf), "riscv_vp_uptime_seconds %.3f\n",
+	         std::chrono::duration<double>(clock::now() - start).count());
+	out += buf;
+
+	hart_values("instret_total", "counter", "Instructions executed.", [](MetricsServer &m, size_t i) {
+		uint64_t instret = 0;
+		for (auto &n : m.stats.harts[i].stats->instrs) instret += n;
+		return (double)instret;
+	});
+	hart_values("mips", "gauge", "Million instructions per host second over the last second.",
+	            [](MetricsServer &m, size_t i) { return m.mips[i]; });
+	hart_values("sim_time_seconds", "gauge", "Simulated time at the last quantum sync.", [](MetricsServer &m, size_t i) {
+		return m.stats.harts[i].stats->sim_time * m.time_resolution;
+	});
+	hart_counter("traps_total", &HartStats::traps, "Synchronous traps taken.");
+	hart_counter("interrupts_total", &HartStats::interrupts, "Interrupts taken.");
+	hart_values("interrupts_per_second", "gauge", "Interrupts taken per host second over the last second.",
+	            [](MetricsServer &m, size_t i) { return m.interrupt_rate[i]; });
+	hart_counter("quantum_syncs_total", &HartStats::quantum_syncs, "Synchronizations with the SystemC kernel.");
+	hart_counter("tlb_hits_total", &HartStats::tlb_hits, "TLB hits.");
+	hart_counter("tlb_misses_total", &HartStats::tlb_misses, "TLB misses, each causing a page table walk.");
+	hart_counter("dmi_accesses_total", &HartStats::dmi_accesses, "Memory accesses through DMI.");
+	hart_counter("tlm_accesses_total", &HartStats::tlm_accesses, "Memory accesses through TLM transactions.");
+	hart_counter("bus_lock_waits_total", &HartStats::bus_lock_waits, "Waits for a bus lock held by another hart.");
+
+	if (!stats.targets.empty()) {
+		header("bus_transactions_total", "counter", "Bus transactions per target.");
+		for (auto &t : stats.targets) {
+			snprintf(buf, sizeof(buf), "riscv_vp_bus_transactions_total{bus=\"%s\",target=\"%u\",start=\"0x%lx\"} %lu\n",
+			         t.bus.c_str(), t.index, (unsigned long)t.start, (unsigned long)*t.transactions);
+			out += buf;
+		}
+		header("bus_bytes_total", "counter", "Bytes transferred per bus target.");
+		for (auto &t : stats.targets) {
+			snprintf(buf, sizeof(buf), "riscv_vp_bus_bytes_total{bus=\"%s\",target=\"%u\",start=\"0x%lx\"} %lu\n",
+			         t.bus.c_str(), t.index, (unsigned long)t.start, (unsigned long)*t.bytes);
+			out += buf;
+		}
+	}
+
+	return out;
+}
+
+void MetricsServer::serve(int fd) {
+	// HTTP clients send a request first, plain socket clients only connect
+	char request[512];
+	ssize_t n = 0;
+	struct pollfd fds = {fd, POLLIN, 0};
+	if (poll(&fds, 1, 100) > 0)
+		n = recv(fd, request, sizeof(request), MSG_DONTWAIT);
+
+	std::string body = format();
+	std::string response;
+	if (n >= 4 && !memcmp(request, "GET ", 4)) {
+		response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+		           std::to_string(body.size()) + "\r\n\r\n";
+	}
+	response += body;
+
+	const char *p = response.data();
+	size_t left = response.size();
+	while (left > 0) {
+		ssize_t ret = send(fd, p, left, MSG_NOSIGNAL);
+		if (ret <= 0)
+			return;
+		p += ret;
+		left -= ret;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stats.h"
+
+/*
+ * Exports the Stats counters live on a Unix socket (--metrics-socket) in the
+ * Prometheus text format, e.g. for a dashboard or a watchdog detecting hangs:
+ *
+ *   curl --unix-socket vp.sock http://localhost/metrics
+ *   socat - UNIX-CONNECT:vp.sock
+ *
+ * The server runs in its own thread and reads the counters without any
+ * synchronization with the simulation (see Counter). Rates such as the MIPS
+ * are computed by the server over the last second.
+ */
+class MetricsServer {
+	typedef HartStats::clock clock;
+
+	struct Sample {
+		clock::time_point time;
+		std::vector<uint64_t> instret;
+		std::vector<uint64_t> interrupts;
+	};
+
+	const Stats &stats;
+	const std::string path;
+	const double time_resolution;  // seconds per SystemC time unit
+	const clock::time_point start;
+
+	int sockfd = -1;
+	std::atomic<bool> stop{false};
+	std::thread thread;
+
+	// server thread only
+	Sample last;
+	std::vector<double> mips;
+	std::vector<double> interrupt_rate;
+
+	void create_sock();
+	void run();
+	Sample sample();
+	void update_rates();
+	std::string format();
+	void serve(int fd);
+
+   public:
+	// all harts and buses must be registered with the stats before
+	MetricsServer(const std::string &path, const Stats &stats);
+	~MetricsServer();
+};
@@ -110,9 +110,12 @@ struct GenericMMU {
         auto vpn = (vaddr >> PGSHIFT);
         auto idx = vpn % TLB_ENTRIES;
         auto &x = tlb[mode][type][idx];
-        if (x.vpn == vpn)
+        if (x.vpn == vpn) {
+            ++core.stats.tlb_hits;
             return x.ppn | (vaddr & PGMASK);
+        }
 
+        ++core.stats.tlb_misses;
         uint64_t paddr = walk(vaddr, type, mode);
 
         // optimization only, to void page walk
@@ -0,0 +1,70 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+HartProfile::HartProfile(unsigned hart_id, uint64_t interval)
+    : hart_id(hart_id), interval(interval), countdown(interval) {
+	stack.reserve(max_depth);
+	key.reserve(max_depth + 1);
+}
+
+void HartProfile::branch(uint64_t next_pc, Instruction instr, Opcode::Mapping op, uint64_t link) {
+	auto is_link = [](unsigned r) { return r == 1 || r == 5; };
+
+	if (is_link(instr.rd())) {
+		if (stack.size() < max_depth)
+			stack.push_back(link);
+	} else if (op == Opcode::JALR && instr.rd() == 0 && is_link(instr.rs1())) {
+		// unwind to the frame returned to, ignore returns without a matching call
+		auto it = std::find(stack.rbegin(), stack.rend(), next_pc);
+		if (it != stack.rend())
+			stack.erase(std::prev(it.base()), stack.end());
+	}
+}
+
+void HartProfile::sample(uint64_t pc) {
+	countdown = interval;
+
+	key.assign(stack.begin(), stack.end());
+	key.push_back(pc);
+	++samples[key];
+}
+
+Profiler::Profiler(const std::string &path, uint64_t interval, const SymbolIndex &symbols)
+    : path(path), interval(interval), symbols(symbols) {
+	if (interval == 0)
+		throw std::runtime_error("profiling interval must not be zero");
+}
+
+Profiler::~Profiler() {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "[profiler] unable to write " << path << std::endl;
+		return;
+	}
+
+	// merge stacks which only differ in addresses within the same functions
+	std::map<std::string, uint64_t> collapsed;
+	for (auto &h : harts) {
+		for (auto &e : h->samples) {
+			std::string line = "hart" + std::to_string(h->hart_id);
+			auto &addrs = e.first;
+			for (size_t i = 0; i < addrs.size(); ++i) {
+				// return addresses point behind the call
+				line += ";" + symbols.describe(i + 1 < addrs.size() ? addrs[i] - 1 : addrs[i], false);
+			}
+			collapsed[line] += e.second;
+		}
+	}
+
+	for (auto &e : collapsed) out << e.first << " " << e.second << "\n";
+}
+
+HartProfile *Profiler::add_hart(unsigned hart_id) {
+	harts.emplace_back(new HartProfile(hart_id, interval));
+	return harts.back().get();
+}
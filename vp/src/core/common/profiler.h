@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "instr.h"
+#include "symbol_index.h"
+
+/*
+ * Sampling profiler for guest code (--profile-file). Every hart samples its
+ * pc each interval executed instructions together with the call stack. The
+ * call stack is tracked from the executed calls (JAL/JALR linking ra or t0)
+ * and returns (JALR x0 to ra or t0), hence it works without frame pointers.
+ * At exit the samples are symbolized with the SymbolIndex and written
+ * in the collapsed stack format of flamegraph.pl, one line per distinct
+ * stack, e.g. "hart0;main;foo;bar 42".
+ */
+class HartProfile {
+	friend class Profiler;
+
+	static constexpr size_t max_depth = 256;
+
+	const unsigned hart_id;
+	const uint64_t interval;
+	uint64_t countdown;
+
+	std::vector<uint64_t> stack;  // return addresses, innermost last
+	std::vector<uint64_t> key;
+	std::map<std::vector<uint64_t>, uint64_t> samples;
+
+	void branch(uint64_t next_pc, Instruction instr, Opcode::Mapping op, uint64_t link);
+	void sample(uint64_t pc);
+
+   public:
+	HartProfile(unsigned hart_id, uint64_t interval);
+
+	// called after every executed instruction, link is the value of its rd
+	void step(uint64_t pc, uint64_t next_pc, Instruction instr, Opcode::Mapping op, uint64_t link) {
+		if (--countdown == 0)
+			sample(pc);
+		if (op == Opcode::JAL || op == Opcode::JALR)
+			branch(next_pc, instr, op, link);
+	}
+};
+
+class Profiler {
+	const std::string path;
+	const uint64_t interval;
+
+	const SymbolIndex &symbols;
+
+	std::vector<std::unique_ptr<HartProfile>> harts;
+
+   public:
+	Profiler(const std::string &path, uint64_t interval, const SymbolIndex &symbols);
+	// writes the profile
+	~Profiler();
+
+	HartProfile *add_hart(unsigned hart_id);
+};
@@ -0,0 +1,228 @@
+#include "stats.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iostream>
+
+Stats::InstrClass Stats::classify(Opcode::Mapping op) {
+	using namespace Opcode;
+
+	switch (op) {
+		case LB:
+		case LH:
+		case LW:
+		case LBU:
+		case LHU:
+		case LWU:
+		case LD:
+		case FLW:
+		case FLD:
+			return LOAD;
+
+		case SB:
+		case SH:
+		case SW:
+		case SD:
+		case FSW:
+		case FSD:
+			return STORE;
+
+		case BEQ:
+		case BNE:
+		case BLT:
+		case BGE:
+		case BLTU:
+		case BGEU:
+			return BRANCH;
+
+		case JAL:
+		case JALR:
+			return JUMP;
+
+		case CSRRW:
+		case CSRRS:
+		case CSRRC:
+		case CSRRWI:
+		case CSRRSI:
+		case CSRRCI:
+			return CSR;
+
+		case UNDEF:
+		case FENCE:
+		case FENCE_I:
+		case ECALL:
+		case EBREAK:
+		case URET:
+		case SRET:
+		case MRET:
+		case WFI:
+		case SFENCE_VMA:
+			return SYSTEM;
+
+		default:
+			break;
+	}
+
+	if ((op >= MUL && op <= REMU) || (op >= MULW && op <= REMUW))
+		return MULDIV;
+	if ((op >= LR_W && op <= AMOMAXU_W) || (op >= LR_D && op <= AMOMAXU_D))
+		return ATOMIC;
+	if (op >= FMADD_S && op <= FMV_D_X)
+		return FLOAT;
+	return ALU;
+}
+
+const char *Stats::class_name(InstrClass c) {
+	static const char *names[NUM_INSTR_CLASSES] = {"alu",    "muldiv", "load", "store",  "branch",
+	                                               "jump",   "atomic", "csr",  "float",  "system"};
+	return names[c];
+}
+
+Stats::Stats() : start(HartStats::clock::now()) {}
+
+void Stats::add_hart(unsigned hart_id, HartStats &stats) {
+	stats.timing = true;
+	harts.push_back({hart_id, &stats});
+}
+
+namespace {
+
+struct Summary {
+	uint64_t instrs = 0;
+	std::array<uint64_t, Stats::NUM_INSTR_CLASSES> classes{};
+	double host_time = 0;
+	HartStats counters;
+
+	void add(const HartStats &h) {
+		for (unsigned op = 0; op < h.instrs.size(); ++op) {
+			instrs += h.instrs[op];
+			classes[Stats::classify((Opcode::Mapping)op)] += h.instrs[op];
+		}
+		host_time += std::chrono::duration<double>(h.host_time).count();
+		counters.traps += h.traps;
+		counters.interrupts += h.interrupts;
+		counters.quantum_syncs += h.quantum_syncs;
+		counters.tlb_hits += h.tlb_hits;
+		counters.tlb_misses += h.tlb_misses;
+		counters.dmi_accesses += h.dmi_accesses;
+		counters.tlm_accesses += h.tlm_accesses;
+		counters.bus_lock_waits += h.bus_lock_waits;
+	}
+
+	double mips(double seconds) const {
+		return seconds > 0 ? instrs / seconds / 1e6 : 0;
+	}
+
+	double percent(uint64_t n) const {
+		return instrs ? 100.0 * n / instrs : 0;
+	}
+
+	void print(std::ostream &out, const char *time, double seconds) const {
+		char buf[128];
+		snprintf(buf, sizeof(buf), "  instructions %lu, %s %.3f s, %.2f MIPS\n", (unsigned long)instrs, time, seconds,
+		         mips(seconds));
+		out << buf << "  classes:";
+		for (unsigned c = 0; c < classes.size(); ++c) {
+			if (!classes[c])
+				continue;
+			snprintf(buf, sizeof(buf), " %s %lu (%.1f%%)", Stats::class_name((Stats::InstrClass)c),
+			         (unsigned long)classes[c], percent(classes[c]));
+			out << buf;
+		}
+		out << "\n";
+
+		auto &c = counters;
+		uint64_t lookups = c.tlb_hits + c.tlb_misses;
+		snprintf(buf, sizeof(buf), "  traps %lu, interrupts %lu, quantum syncs %lu\n", (unsigned long)c.traps,
+		         (unsigned long)c.interrupts, (unsigned long)c.quantum_syncs);
+		out << buf;
+		snprintf(buf, sizeof(buf), "  tlb hits %lu, misses %lu (%.2f%% hits)\n", (unsigned long)c.tlb_hits,
+		         (unsigned long)c.tlb_misses, lookups ? 100.0 * c.tlb_hits / lookups : 0);
+		out << buf;
+		snprintf(buf, sizeof(buf), "  memory accesses: dmi %lu, tlm %lu, bus lock waits %lu\n",
+		         (unsigned long)c.dmi_accesses, (unsigned long)c.tlm_accesses, (unsigned long)c.bus_lock_waits);
+		out << buf;
+	}
+
+	void write_json(std::ostream &out, double seconds) const {
+		auto &c = counters;
+		out << "\"instructions\": " << instrs << ", \"host_time_s\": " << seconds << ", \"mips\": " << mips(seconds)
+		    << ", \"classes\": {";
+		for (unsigned i = 0; i < classes.size(); ++i)
+			out << (i ? ", " : "") << "\"" << Stats::class_name((Stats::InstrClass)i) << "\": " << classes[i];
+		out << "}, \"traps\": " << c.traps << ", \"interrupts\": " << c.interrupts
+		    << ", \"quantum_syncs\": " << c.quantum_syncs << ", \"tlb_hits\": " << c.tlb_hits
+		    << ", \"tlb_misses\": " << c.tlb_misses << ", \"dmi_accesses\": " << c.dmi_accesses
+		    << ", \"tlm_accesses\": " << c.tlm_accesses << ", \"bus_lock_waits\": " << c.bus_lock_waits;
+	}
+};
+
+}  // namespace
+
+void Stats::print(std::ostream &out) const {
+	double wall = std::chrono::duration<double>(HartStats::clock::now() - start).count();
+
+	Summary total;
+	out << "=[ statistics ]===========================" << std::endl;
+	for (auto &h : harts) {
+		Summary s;
+		s.add(*h.stats);
+		total.add(*h.stats);
+		out << "hart " << h.id << ":\n";
+		s.print(out, "host time", s.host_time);
+	}
+	if (harts.size() != 1) {
+		out << "total:\n";
+		total.print(out, "wall time", wall);
+	}
+
+	if (!targets.empty()) {
+		out << "bus transactions:\n";
+		char buf[128];
+		for (auto &t : targets) {
+			snprintf(buf, sizeof(buf), "  %s[%u] %08lx-%08lx: %lu (%lu bytes)\n", t.bus.c_str(), t.index,
+			         (unsigned long)t.start, (unsigned long)t.end, (unsigned long)*t.transactions,
+			         (unsigned long)*t.bytes);
+			out << buf;
+		}
+	}
+	out << "wall time: " << wall << " s" << std::endl;
+}
+
+void Stats::write_json(std::ostream &out) const {
+	double wall = std::chrono::duration<double>(HartStats::clock::now() - start).count();
+
+	Summary total;
+	out << "{\"wall_time_s\": " << wall << ",\n \"harts\": [";
+	for (size_t i = 0; i < harts.size(); ++i) {
+		Summary s;
+		s.add(*harts[i].stats);
+		total.add(*harts[i].stats);
+		out << (i ? ",\n   " : "\n   ") << "{\"hart\": " << harts[i].id << ", ";
+		s.write_json(out, s.host_time);
+		out << "}";
+	}
+	out << "],\n \"total\": {";
+	total.write_json(out, wall);
+	out << "},\n \"bus\": [";
+	for (size_t i = 0; i < targets.size(); ++i) {
+		auto &t = targets[i];
+		out << (i ? ",\n   " : "\n   ") << "{\"bus\": \"" << t.bus << "\", \"target\": " << t.index
+		    << ", \"start\": " << t.start << ", \"end\": " << t.end << ", \"transactions\": " << *t.transactions
+		    << ", \"bytes\": " << *t.bytes << "}";
+	}
+	out << "]}" << std::endl;
+}
+
+void Stats::report(const std::string &json_path) const {
+	print(std::cout);
+
+	if (!json_path.empty()) {
+		std::ofstream out(json_path);
+		if (!out)
+			std::cerr << "[stats] unable to write " << json_path << std::endl;
+		else
+			write_json(out);
+	}
+}
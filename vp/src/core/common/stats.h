@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "instr.h"
+
+/*
+ * Simulation statistics (--stats). Every hart owns a HartStats block whose
+ * counters are plain increments on the simulation paths and hence always
+ * enabled. Measuring the host time spent in a hart requires reading the
+ * clock at every SystemC context switch, this is only done when timing is
+ * enabled. At exit a Stats report summarizes the registered harts and buses
+ * in a human readable form and optionally as JSON.
+ */
+
+// Counter with a single writer, the simulation thread, which may be read
+// concurrently (see MetricsServer). Relaxed loads and stores compile to plain
+// memory accesses, hence updates are as cheap as for a uint64_t.
+class Counter {
+	std::atomic<uint64_t> value{0};
+
+   public:
+	Counter &operator++() {
+		value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return *this;
+	}
+
+	Counter &operator+=(uint64_t n) {
+		value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		return *this;
+	}
+
+	Counter &operator=(uint64_t n) {
+		value.store(n, std::memory_order_relaxed);
+		return *this;
+	}
+
+	operator uint64_t() const {
+		return value.load(std::memory_order_relaxed);
+	}
+};
+
+struct HartStats {
+	typedef std::chrono::steady_clock clock;
+
+	std::array<Counter, Opcode::NUMBER_OF_INSTRUCTIONS> instrs;
+	Counter traps;
+	Counter interrupts;
+	Counter quantum_syncs;
+	Counter tlb_hits;
+	Counter tlb_misses;
+	Counter dmi_accesses;
+	Counter tlm_accesses;
+	Counter bus_lock_waits;
+	Counter sim_time;  // in units of the SystemC time resolution, updated at quantum syncs
+
+	bool timing = false;
+	bool running = false;
+	clock::time_point resumed;
+	clock::duration host_time{0};
+
+	// bracket every point where the hart yields to SystemC
+	void suspend() {
+		if (timing && running) {
+			host_time += clock::now() - resumed;
+			running = false;
+		}
+	}
+
+	void resume() {
+		if (timing) {
+			resumed = clock::now();
+			running = true;
+		}
+	}
+};
+
+class Stats {
+   public:
+	enum InstrClass { ALU, MULDIV, LOAD, STORE, BRANCH, JUMP, ATOMIC, CSR, FLOAT, SYSTEM, NUM_INSTR_CLASSES };
+
+	static InstrClass classify(Opcode::Mapping op);
+	static const char *class_name(InstrClass c);
+
+	Stats();
+
+	void add_hart(unsigned hart_id, HartStats &stats);
+
+	// SimpleBus and compatible buses, counting transactions per target port
+	template <typename Bus>
+	void add_bus(const Bus &bus) {
+		std::string name = bus.name();
+		for (unsigned i = 0; i < bus.ports.size(); ++i) {
+			if (bus.ports[i])
+				targets.push_back({name, i, bus.ports[i]->start, bus.ports[i]->end, &bus.transactions[i], &bus.bytes[i]});
+		}
+	}
+
+	void print(std::ostream &out) const;
+	void write_json(std::ostream &out) const;
+	// prints the report and writes the JSON file, if any
+	void report(const std::string &json_path) const;
+
+   private:
+	friend class MetricsServer;
+
+	struct Hart {
+		unsigned id;
+		const HartStats *stats;
+	};
+
+	struct Target {
+		std::string bus;
+		unsigned index;
+		uint64_t start;
+		uint64_t end;
+		const Counter *transactions;
+		const Counter *bytes;
+	};
+
+	HartStats::clock::time_point start;
+	std::vector<Hart> harts;
+	std::vector<Target> targets;
+};
@@ -0,0 +1,106 @@
+#include "symbol_index.h"
+
+#include <cxxabi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "core/rv32/elf_loader.h"
+#include "core/rv64/elf_loader.h"
+
+SymbolIndex::File SymbolIndex::File::parse(const std::string &spec) {
+	File f;
+	auto sep = spec.rfind('@');
+	f.path = spec.substr(0, sep);
+	if (sep != std::string::npos) {
+		try {
+			f.offset = std::stoll(spec.substr(sep + 1), nullptr, 0);
+		} catch (std::logic_error &) {
+			throw std::runtime_error("invalid symbol file offset in '" + spec + "'");
+		}
+	}
+	return f;
+}
+
+void SymbolIndex::add_elf(const std::string &path, int64_t offset) {
+	// EI_CLASS: 1 is 32 bit, 2 is 64 bit
+	char ident[5] = {0};
+	std::ifstream in(path, std::ios::binary);
+	if (!in.read(ident, sizeof(ident)) || ident[0] != 0x7f || ident[1] != 'E' || ident[2] != 'L' || ident[3] != 'F')
+		throw std::runtime_error("not an ELF file: " + path);
+
+	if (ident[4] == 1)
+		add(rv32::ELFLoader(path.c_str()).get_symbols(), path, offset);
+	else
+		add(rv64::ELFLoader(path.c_str()).get_symbols(), path, offset);
+}
+
+void SymbolIndex::add(const std::vector<ElfSymbol> &elf_symbols, const std::string &module, int64_t offset) {
+	modules.push_back(module);
+	const std::string *m = &modules.back();
+
+	// strip the directory for qualified names
+	std::string prefix = module.substr(module.rfind('/') + 1) + ":";
+
+	for (auto &e : elf_symbols) {
+		symbols.push_back({e.name, e.addr + offset, e.size, e.code, m});
+		const Symbol *s = &symbols.back();
+
+		by_name.emplace(e.name, s);
+		by_name.emplace(prefix + e.name, s);
+		if (e.code)
+			by_addr.push_back(s);
+	}
+
+	// functions before labels at the same address
+	std::stable_sort(by_addr.begin(), by_addr.end(), [](const Symbol *a, const Symbol *b) {
+		return a->addr < b->addr || (a->addr == b->addr && a->size > b->size);
+	});
+}
+
+const SymbolIndex::Symbol *SymbolIndex::find(const std::string &name) const {
+	auto it = by_name.find(name);
+	return it == by_name.end() ? nullptr : it->second;
+}
+
+const SymbolIndex::Symbol *SymbolIndex::find(uint64_t addr) const {
+	auto it = std::upper_bound(by_addr.begin(), by_addr.end(), addr,
+	                           [](uint64_t a, const Symbol *s) { return a < s->addr; });
+	if (it == by_addr.begin())
+		return nullptr;
+
+	// the first of several symbols at the same address
+	const Symbol *s = *--it;
+	while (it != by_addr.begin() && (*(it - 1))->addr == s->addr) s = *--it;
+
+	if (s->size != 0 && addr >= s->addr + s->size)
+		return nullptr;
+	return s;
+}
+
+std::string SymbolIndex::describe(uint64_t addr, bool offset) const {
+	char buf[24];
+
+	const Symbol *s = find(addr);
+	if (!s) {
+		snprintf(buf, sizeof(buf), "0x%lx", (unsigned long)addr);
+		return buf;
+	}
+
+	std::string name = s->name;
+	int status;
+	char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+	if (status == 0) {
+		name = demangled;
+		free(demangled);
+	}
+
+	if (offset && addr != s->addr) {
+		snprintf(buf, sizeof(buf), "+0x%lx", (unsigned long)(addr - s->addr));
+		name += buf;
+	}
+	return name;
+}
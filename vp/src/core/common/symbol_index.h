@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "elf_loader.h"
+
+/*
+ * Address <-> symbol lookup over one or more ELF files, e.g. OpenSBI, the
+ * kernel and a user program, each with an optional load offset. Names are
+ * found through a hash map, either plain (the first module added wins) or
+ * qualified as "module:name". Addresses are resolved to the enclosing
+ * function through a sorted table. Built once before the simulation and
+ * shared by the profiler, the trace decoder and other tools.
+ */
+class SymbolIndex {
+   public:
+	struct Symbol {
+		std::string name;
+		uint64_t addr;
+		uint64_t size;  // zero if unknown, then it extends to the next function
+		bool code;
+		const std::string *module;
+	};
+
+	// ELF file to load symbols from, given as "path[@offset]"
+	struct File {
+		std::string path;
+		int64_t offset = 0;
+
+		static File parse(const std::string &spec);
+	};
+
+	// adds all symbols of the file, 32 and 64 bit ELFs are supported
+	void add_elf(const std::string &path, int64_t offset = 0);
+	void add_elf(const File &file) {
+		add_elf(file.path, file.offset);
+	}
+	void add(const std::vector<ElfSymbol> &symbols, const std::string &module, int64_t offset = 0);
+
+	const Symbol *find(const std::string &name) const;
+	// function containing the address, nullptr if none
+	const Symbol *find(uint64_t addr) const;
+	// "name+0x10", demangled, or the address in hex if unknown
+	std::string describe(uint64_t addr, bool offset = true) const;
+
+	bool empty() const {
+		return symbols.empty();
+	}
+
+   private:
+	std::deque<std::string> modules;
+	std::deque<Symbol> symbols;
+	std::unordered_map<std::string, const Symbol *> by_name;
+	std::vector<const Symbol *> by_addr;  // code only, sorted by address
+};
@@ -0,0 +1,230 @@
+#include "trace.h"
+
+#include <string.h>
+
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <chrono>
+#include <stdexcept>
+
+constexpr char TraceFormat::magic[8];
+
+static std::array<uint8_t, Opcode::NUMBER_OF_INSTRUCTIONS> compute_effects() {
+	using namespace Opcode;
+
+	std::array<uint8_t, NUMBER_OF_INSTRUCTIONS> fx;
+	for (int i = 0; i < NUMBER_OF_INSTRUCTIONS; ++i) {
+		switch (getType((Mapping)i)) {
+			case Type::R:
+			case Type::I:
+			case Type::U:
+			case Type::J:
+				fx[i] = TraceFormat::WRITES_X;
+				break;
+			case Type::R4:
+				fx[i] = TraceFormat::WRITES_F;
+				break;
+			default:
+				fx[i] = 0;
+		}
+	}
+
+	for (auto op : {LB, LH, LW, LBU, LHU, LWU, LD})
+		fx[op] = TraceFormat::WRITES_X | TraceFormat::MEM_I_IMM;
+	for (auto op : {FLW, FLD})
+		fx[op] = TraceFormat::WRITES_F | TraceFormat::MEM_I_IMM;
+	for (auto op : {SB, SH, SW, SD, FSW, FSD})
+		fx[op] = TraceFormat::MEM_S_IMM;
+
+	for (auto op : {LR_W, SC_W, AMOSWAP_W, AMOADD_W, AMOXOR_W, AMOAND_W, AMOOR_W, AMOMIN_W, AMOMAX_W, AMOMINU_W,
+	                AMOMAXU_W, LR_D, SC_D, AMOSWAP_D, AMOADD_D, AMOXOR_D, AMOAND_D, AMOOR_D, AMOMIN_D, AMOMAX_D,
+	                AMOMINU_D, AMOMAXU_D})
+		fx[op] = TraceFormat::WRITES_X | TraceFormat::MEM_RS1;
+
+	// floating point results, comparisons and conversions to integers keep WRITES_X
+	for (auto op : {FADD_S,    FSUB_S,    FMUL_S,   FDIV_S,    FSQRT_S,   FSGNJ_S,  FSGNJN_S,  FSGNJX_S,  FMIN_S,
+	                FMAX_S,    FCVT_S_W,  FCVT_S_WU, FMV_W_X,  FCVT_S_L,  FCVT_S_LU, FADD_D,   FSUB_D,    FMUL_D,
+	                FDIV_D,    FSQRT_D,   FSGNJ_D,  FSGNJN_D,  FSGNJX_D,  FMIN_D,   FMAX_D,    FCVT_S_D,  FCVT_D_S,
+	                FCVT_D_W,  FCVT_D_WU, FCVT_D_L, FCVT_D_LU, FMV_D_X})
+		fx[op] = TraceFormat::WRITES_F;
+
+	for (auto op : {UNDEF, FENCE, FENCE_I, ECALL, EBREAK, URET, SRET, MRET, WFI, SFENCE_VMA})
+		fx[op] = 0;
+
+	return fx;
+}
+
+const std::array<uint8_t, Opcode::NUMBER_OF_INSTRUCTIONS> TraceFormat::effects = compute_effects();
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v) {
+	while (v >= 0x80) {
+		*p++ = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+static inline uint8_t *put_delta(uint8_t *p, int64_t d) {
+	return put_varint(p, ((uint64_t)d << 1) ^ (uint64_t)(d >> 63));
+}
+
+HartTrace::HartTrace(TraceWriter &writer, unsigned hart_id, const TraceFilter &filter, Architecture arch)
+    : writer(writer), hart_id(hart_id), filter(filter), addr_mask(arch == RV32 ? UINT32_MAX : UINT64_MAX) {}
+
+void HartTrace::next_chunk() {
+	flush();
+
+	// wait for the writer if all chunks are in use, records are never dropped
+	while ((chunk = chunks.reserve()) == nullptr) {
+		writer.notify();
+		std::this_thread::yield();
+	}
+
+	chunk->header.hart = hart_id;
+	chunk->header.size = 0;
+	chunk->header.count = 0;
+	chunk->header.reserved = 0;
+	chunk->header.first_instr = n - skipped;
+	pos = chunk->data;
+
+	next_pc = 0;
+	last_addr = 0;
+	last_prv = 0;
+}
+
+void HartTrace::flush() {
+	if (!chunk)
+		return;
+
+	chunk->header.size = pos - chunk->data;
+	chunks.commit();
+	chunk = nullptr;
+	writer.notify();
+}
+
+void HartTrace::record(bool trapped, uint32_t cause, uint64_t xval, uint64_t fval) {
+	if (!chunk || pos + max_record_size > chunk->data + chunk_size)
+		next_chunk();
+
+	uint8_t *flags = pos;
+	uint8_t *p = pos + 1;
+	uint8_t f = 0;
+
+	if (skipped) {
+		f |= TraceFormat::SKIP;
+		p = put_varint(p, skipped);
+		skipped = 0;
+	}
+	if (pc != next_pc) {
+		f |= TraceFormat::JUMP;
+		p = put_delta(p, pc - next_pc);
+	}
+	if (prv != last_prv) {
+		f |= TraceFormat::PRV;
+		*p++ = prv;
+		last_prv = prv;
+	}
+	if (trapped) {
+		f |= TraceFormat::TRAP;
+		p = put_varint(p, cause);
+	}
+	if (fx & (TraceFormat::MEM_RS1 | TraceFormat::MEM_I_IMM | TraceFormat::MEM_S_IMM)) {
+		f |= TraceFormat::MEM;
+		p = put_delta(p, addr - last_addr);
+		last_addr = addr;
+	}
+	if (!trapped && (fx & TraceFormat::WRITES_X) && rd != 0) {
+		f |= TraceFormat::XREG;
+		*p++ = rd;
+		p = put_varint(p, xval & addr_mask);
+	}
+	if (!trapped && (fx & TraceFormat::WRITES_F)) {
+		f |= TraceFormat::FREG;
+		*p++ = rd;
+		p = put_varint(p, fval);
+	}
+
+	unsigned len = 4;
+	if ((raw & 3) != 3) {
+		f |= TraceFormat::RVC;
+		len = 2;
+	}
+	memcpy(p, &raw, len);
+	p += len;
+
+	*flags = f;
+	pos = p;
+	next_pc = (pc + len) & addr_mask;
+	chunk->header.count++;
+}
+
+TraceWriter::TraceWriter(const std::string &path, Architecture arch, const TraceFilter &filter)
+    : path(path), arch(arch), filter(filter), file(path, std::ios::binary) {
+	if (!file)
+		throw std::runtime_error("unable to open trace file " + path);
+
+	worker = std::thread(&TraceWriter::run, this);
+}
+
+TraceWriter::~TraceWriter() {
+	for (auto &h : harts) h->flush();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_one();
+	worker.join();
+}
+
+HartTrace *TraceWriter::add_hart(unsigned hart_id) {
+	if (filter.hart >= 0 && (unsigned)filter.hart != hart_id)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	harts.emplace_back(new HartTrace(*this, hart_id, filter, arch));
+	return harts.back().get();
+}
+
+void TraceWriter::notify() {
+	cv.notify_one();
+}
+
+void TraceWriter::run() {
+	namespace io = boost::iostreams;
+
+	io::filtering_ostream out;
+	out.push(io::gzip_compressor(io::gzip_params(io::gzip::best_speed)));
+	out.push(file);
+
+	TraceFormat::FileHeader header;
+	memcpy(header.magic, TraceFormat::magic, sizeof(header.magic));
+	header.version = TraceFormat::version;
+	header.xlen = arch == RV32 ? 32 : 64;
+	out.write((const char *)&header, sizeof(header));
+
+	std::vector<HartTrace *> current;
+	bool done = false;
+	while (!done) {
+		{
+			// harts notify for every filled chunk, poll anyway to not depend on it
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait_for(lock, std::chrono::milliseconds(10));
+			done = stopping;
+			current.clear();
+			for (auto &h : harts) current.push_back(h.get());
+		}
+
+		for (auto h : current) {
+			HartTrace::Chunk *c;
+			while ((c = h->chunks.front()) != nullptr) {
+				out.write((const char *)&c->header, sizeof(c->header));
+				out.write((const char *)c->data, c->header.size);
+				h->chunks.release();
+			}
+		}
+	}
+
+	out.reset();
+}
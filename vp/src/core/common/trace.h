@@ -0,0 +1,222 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core_defs.h"
+#include "instr.h"
+#include "util/spsc_queue.h"
+
+/*
+ * Binary instruction trace (--trace-file), the compact alternative to the
+ * printf based --trace-mode for long runs. Every hart encodes its executed
+ * instructions into the chunks of a lock-free ring, a background thread
+ * compresses the filled chunks (gzip) into the trace file. The trace-decoder
+ * tool turns the file back into readable text.
+ *
+ * Stream format after decompression: a FileHeader followed by chunks, each
+ * a ChunkHeader and the encoded records of one hart. Records are delta
+ * encoded against the preceding record of the chunk, every chunk starts
+ * from zero and can be decoded on its own. A record is a flags byte, the
+ * fields of the set flags in the order below (varints are LEB128, deltas
+ * are zigzag encoded) and the 2 or 4 byte instruction:
+ *
+ *   SKIP  varint, instructions filtered out since the previous record
+ *   JUMP  delta of the pc to the one following the previous record
+ *   PRV   byte, privilege level
+ *   TRAP  varint, exception code (the instruction did not complete)
+ *   MEM   delta of the accessed address to the previous access
+ *   XREG  byte register number, varint value written
+ *   FREG  byte register number, varint raw value written
+ *   RVC   no field, the instruction is compressed
+ */
+struct TraceFormat {
+	static constexpr char magic[8] = {'R', 'V', 'T', 'R', 'A', 'C', 'E', 0};
+	static constexpr uint32_t version = 1;
+
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t xlen;
+	};
+
+	struct ChunkHeader {
+		uint32_t hart;
+		uint32_t size;  // bytes of records following
+		uint32_t count;
+		uint32_t reserved;
+		uint64_t first_instr;  // number of instructions executed by the hart before the chunk
+	};
+
+	enum : uint8_t {
+		SKIP = 1 << 0,
+		JUMP = 1 << 1,
+		PRV = 1 << 2,
+		TRAP = 1 << 3,
+		MEM = 1 << 4,
+		XREG = 1 << 5,
+		FREG = 1 << 6,
+		RVC = 1 << 7,
+	};
+
+	// effects of an instruction (used to decide which fields to record)
+	enum : uint8_t {
+		WRITES_X = 1 << 0,
+		WRITES_F = 1 << 1,
+		MEM_RS1 = 1 << 2,   // address rs1 (atomics)
+		MEM_I_IMM = 1 << 3, // address rs1 + I immediate (loads)
+		MEM_S_IMM = 1 << 4, // address rs1 + S immediate (stores)
+	};
+
+	static const std::array<uint8_t, Opcode::NUMBER_OF_INSTRUCTIONS> effects;
+};
+
+struct TraceFilter {
+	uint64_t start_addr = 0;
+	uint64_t end_addr = UINT64_MAX;  // inclusive
+	unsigned prv_mask = 0xf;         // bit per privilege level
+	int hart = -1;                   // all harts
+	uint64_t start_instr = 0;
+	uint64_t end_instr = UINT64_MAX;  // exclusive
+
+	bool matches(uint64_t n, uint64_t pc, unsigned prv) const {
+		return n >= start_instr && n < end_instr && pc >= start_addr && pc <= end_addr && ((prv_mask >> prv) & 1);
+	}
+};
+
+class TraceWriter;
+
+/*
+ * Trace of a single hart, only to be used by the thread simulating it. Each
+ * executed instruction calls begin() once it is decoded and end() after it
+ * completed, or trap() if it raised an exception (possibly without begin()
+ * if the fetch failed).
+ */
+class HartTrace {
+	friend class TraceWriter;
+
+	static constexpr size_t chunk_size = 64 * 1024;
+	static constexpr size_t num_chunks = 16;
+	static constexpr size_t max_record_size = 64;
+
+	struct Chunk {
+		TraceFormat::ChunkHeader header;
+		uint8_t data[chunk_size];
+	};
+
+	TraceWriter &writer;
+	const unsigned hart_id;
+	const TraceFilter filter;
+	const uint64_t addr_mask;
+
+	SPSCQueue<Chunk, num_chunks> chunks;
+	Chunk *chunk = nullptr;
+	uint8_t *pos = nullptr;
+
+	// number of instructions executed so far
+	uint64_t n = 0;
+	uint64_t skipped = 0;
+
+	// state of the previous record in the chunk
+	uint64_t next_pc = 0;
+	uint64_t last_addr = 0;
+	unsigned last_prv = 0;
+
+	// instruction between begin() and end()
+	bool begun = false;
+	bool recording = false;
+	uint64_t pc;
+	uint32_t raw;
+	uint8_t fx;
+	uint8_t rd;
+	unsigned prv;
+	uint64_t addr;
+
+	void record(bool trapped, uint32_t cause, uint64_t xval, uint64_t fval);
+	void next_chunk();
+
+   public:
+	HartTrace(TraceWriter &writer, unsigned hart_id, const TraceFilter &filter, Architecture arch);
+
+	void begin(uint64_t pc, uint32_t mem_word, Instruction instr, Opcode::Mapping op, unsigned prv, uint64_t rs1) {
+		begun = true;
+		recording = filter.matches(n, pc, prv);
+		if (!recording)
+			return;
+
+		this->pc = pc;
+		this->prv = prv;
+		raw = (mem_word & 3) == 3 ? mem_word : (mem_word & 0xffff);
+		fx = TraceFormat::effects[op];
+		rd = instr.rd();
+
+		if (fx & TraceFormat::MEM_I_IMM)
+			addr = (rs1 + instr.I_imm()) & addr_mask;
+		else if (fx & TraceFormat::MEM_S_IMM)
+			addr = (rs1 + instr.S_imm()) & addr_mask;
+		else
+			addr = rs1 & addr_mask;
+	}
+
+	void end(uint64_t xval, uint64_t fval) {
+		if (recording)
+			record(false, 0, xval, fval);
+		else
+			++skipped;
+		begun = false;
+		++n;
+	}
+
+	void trap(uint64_t pc, unsigned prv, uint32_t cause) {
+		if (!begun) {
+			// instruction fetch failed
+			recording = filter.matches(n, pc, prv);
+			this->pc = pc;
+			this->prv = prv;
+			raw = 0;
+			fx = 0;
+		}
+		if (recording)
+			record(true, cause, 0, 0);
+		else
+			++skipped;
+		begun = false;
+		++n;
+	}
+
+	// hand the partially filled chunk to the writer
+	void flush();
+};
+
+class TraceWriter {
+	friend class HartTrace;
+
+	const std::string path;
+	const Architecture arch;
+	const TraceFilter filter;
+	std::ofstream file;
+
+	std::vector<std::unique_ptr<HartTrace>> harts;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping = false;
+	std::thread worker;
+
+	void run();
+	void notify();
+
+   public:
+	TraceWriter(const std::string &path, Architecture arch, const TraceFilter &filter = TraceFilter());
+	~TraceWriter();
+
+	// returns nullptr if the hart is filtered out, call before simulation starts
+	HartTrace *add_hart(unsigned hart_id);
+};
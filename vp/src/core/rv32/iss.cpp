@@ -118,8 +118,9 @@ ISS::ISS(uint32_t hart_id, bool use_E_base_isa) : systemc_name("Core-" + std::to
 void ISS::exec_step() {
 	assert(((pc & ~pc_alignment_mask()) == 0) && "misaligned instruction");
 
+	uint32_t mem_word;
 	try {
-		uint32_t mem_word = instr_mem->load_instr(pc);
+		mem_word = instr_mem->load_instr(pc);
 		instr = Instruction(mem_word);
 	} catch (SimulationTrap &e) {
 		op = Opcode::UNDEF;
@@ -137,6 +138,11 @@ void ISS::exec_step() {
 		pc += 4;
 	}
 
+	if (tracer)
+		tracer->begin(last_pc, mem_word, instr, op, prv, (uint32_t)regs[instr.rs1()]);
+	if (instr_mix)
+		instr_mix->begin(prv, op);
+
 	if (trace) {
 		printf("core %2u: prv %1x: pc %8x: %s ", csrs.mhartid.reg, prv, last_pc, Opcode::mappingStr[op]);
 		switch (Opcode::getType(op)) {
@@ -1089,8 +1095,11 @@ void ISS::exec_step() {
             if (u_mode() && csrs.misa.has_supervisor_mode_extension())
                 raise_trap(EXC_ILLEGAL_INSTR, instr.data());
 
-            if (!ignore_wfi && !has_local_pending_enabled_interrupts())
+            if (!ignore_wfi && !has_local_pending_enabled_interrupts()) {
+                stats.suspend();
                 sc_core::wait(wfi_event);
+                stats.resume();
+            }
             break;
 
         case Opcode::SFENCE_VMA:
@@ -1175,6 +1184,16 @@ uint64_t ISS::_compute_and_get_current_cycles() {
 	return num_cycles;
 }
 
+uint64_t ISS::get_mtime() {
+	// Use the local time of this hart (global time plus quantum keeper offset)
+	// instead of a virtual call into the CLINT. This is more accurate as well,
+	// since the hart usually runs ahead of the global SystemC time.
+	uint64_t now = quantum_keeper.get_current_time().value() / mtime_scaler;
+	if (now > last_mtime)
+		last_mtime = now;  // do not update backward in time
+	return last_mtime;
+}
+
 
 bool ISS::is_invalid_csr_access(uint32_t csr_addr, bool is_write) {
     if (csr_addr == csr::FFLAGS_ADDR || csr_addr == csr::FRM_ADDR || csr_addr == csr::FCSR_ADDR) {
@@ -1211,14 +1230,14 @@ uint32_t ISS::get_csr_value(uint32_t addr) {
 	switch (addr) {
 		case TIME_ADDR:
 		case MTIME_ADDR: {
-			uint64_t mtime = clint->update_and_get_mtime();
+			uint64_t mtime = get_mtime();
 			csrs.time.reg = mtime;
 			return csrs.time.low;
 		}
 
 		case TIMEH_ADDR:
 		case MTIMEH_ADDR: {
-			uint64_t mtime = clint->update_and_get_mtime();
+			uint64_t mtime = get_mtime();
 			csrs.time.reg = mtime;
 			return csrs.time.high;
 		}
@@ -1425,6 +1444,7 @@ void ISS::init(instr_memory_if *instr_mem, data_memory_if *data_mem, clint_if *c
 	this->instr_mem = instr_mem;
 	this->mem = data_mem;
 	this->clint = clint;
+	this->mtime_scaler = clint->get_mtime_scaler();
 	regs[RegFile::sp] = sp;
 	pc = entrypoint;
 }
@@ -1678,6 +1698,10 @@ void ISS::prepare_interrupt(const PendingInterrupts &e) {
 	else
 		throw std::runtime_error("some pending interrupt must be available here");
 
+	if (irq_latency &&
+	    (exc == EXC_M_EXTERNAL_INTERRUPT || exc == EXC_S_EXTERNAL_INTERRUPT || exc == EXC_U_EXTERNAL_INTERRUPT))
+		irq_latency->enter(get_hart_id(), quantum_keeper.get_current_time());
+
 	switch (e.target_mode) {
 		case MachineMode:
 			csrs.mcause.exception_code = exc;
@@ -1787,6 +1811,8 @@ void ISS::switch_to_trap_handler(PrivilegeLevel target_mode) {
 void ISS::performance_and_sync_update(Opcode::Mapping executed_op) {
     ++total_num_instr;
 
+	++stats.instrs[executed_op];
+
 	if (!csrs.mcountinhibit.IR)
 		++csrs.instret.reg;
 
@@ -1804,8 +1830,13 @@ void ISS::performance_and_sync_update(Opcode::Mapping executed_op) {
 
 	quantum_keeper.inc(new_cycles);
 	if (quantum_keeper.need_sync()) {
-	    if (lr_sc_counter == 0) // match SystemC sync with bus unlocking in a tight LR_W/SC_W loop
-		    quantum_keeper.sync();
+		if (lr_sc_counter == 0) {  // match SystemC sync with bus unlocking in a tight LR_W/SC_W loop
+			stats.suspend();
+			quantum_keeper.sync();
+			++stats.quantum_syncs;
+			stats.sim_time = sc_core::sc_time_stamp().value();
+			stats.resume();
+		}
 	}
 }
 
@@ -1823,14 +1854,29 @@ void ISS::run_step() {
 	try {
 		exec_step();
 
+		if (tracer)
+			tracer->end(regs[instr.rd()], fp_regs.f64(instr.rd()).v);
+		if (profiler)
+			profiler->step(last_pc, pc, instr, op, (uint32_t)regs[instr.rd()]);
+		if (coverage)
+			coverage->step(last_pc, pc, instr, op);
+		if (instr_mix)
+			instr_mix->end(last_pc, pc, instr, op);
+
 		auto x = compute_pending_interrupts();
 		if (x.target_mode != NoneMode) {
+			++stats.interrupts;
 			prepare_interrupt(x);
 			switch_to_trap_handler(x.target_mode);
 		}
 	} catch (SimulationTrap &e) {
+		++stats.traps;
 		if (trace)
 			std::cout << "take trap " << e.reason << ", mtval=" << e.mtval << std::endl;
+		if (tracer)
+			tracer->trap(last_pc, prv, e.reason);
+		if (coverage)
+			coverage->reached(last_pc);
 		auto target_mode = prepare_trap(e);
 		switch_to_trap_handler(target_mode);
 	}
@@ -1852,11 +1898,13 @@ void ISS::run_step() {
 void ISS::run() {
 	// run a single step until either a breakpoint is hit or the execution
 	// terminates
+	stats.resume();
 	do {
 		run_step();
 	} while (status == CoreExecStatus::Runnable);
 
 	// force sync to make sure that no action is missed
+	stats.suspend();
 	quantum_keeper.sync();
 }
 
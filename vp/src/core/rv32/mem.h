@@ -10,13 +10,16 @@ namespace rv32 {
 struct InstrMemoryProxy : public instr_memory_if {
 	MemoryDMI dmi;
 
+	HartStats &stats;
 	tlm_utils::tlm_quantumkeeper &quantum_keeper;
 	sc_core::sc_time clock_cycle = sc_core::sc_time(10, sc_core::SC_NS);
 	sc_core::sc_time access_delay = clock_cycle * 2;
 
-	InstrMemoryProxy(const MemoryDMI &dmi, ISS &owner) : dmi(dmi), quantum_keeper(owner.quantum_keeper) {}
+	InstrMemoryProxy(const MemoryDMI &dmi, ISS &owner)
+	    : dmi(dmi), stats(owner.stats), quantum_keeper(owner.quantum_keeper) {}
 
 	virtual uint32_t load_instr(uint64_t pc) override {
+		++stats.dmi_accesses;
 		quantum_keeper.inc(access_delay);
 		return dmi.load<uint32_t>(pc);
 	}
@@ -51,6 +54,8 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
     }
 
 	inline void _do_transaction(tlm::tlm_command cmd, uint64_t addr, uint8_t *data, unsigned num_bytes) {
+		++iss.stats.tlm_accesses;
+
 		tlm::tlm_generic_payload trans;
 		trans.set_command(cmd);
 		trans.set_address(addr);
@@ -77,14 +82,40 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 		}
 	}
 
+	bool locked_by_other_hart() {
+		return bus_lock->is_locked() && !bus_lock->is_locked(iss.get_hart_id());
+	}
+
+	// waiting for the lock of another hart suspends this one in SystemC
+	void lock_bus() {
+		if (locked_by_other_hart()) {
+			++iss.stats.bus_lock_waits;
+			iss.stats.suspend();
+			bus_lock->lock(iss.get_hart_id());
+			iss.stats.resume();
+		} else {
+			bus_lock->lock(iss.get_hart_id());
+		}
+	}
+
+	void wait_for_access_rights() {
+		if (locked_by_other_hart()) {
+			++iss.stats.bus_lock_waits;
+			iss.stats.suspend();
+			bus_lock->wait_until_unlocked();
+			iss.stats.resume();
+		}
+	}
+
 	template <typename T>
 	inline T _raw_load_data(uint64_t addr) {
 		// NOTE: a DMI load will not context switch (SystemC) and not modify the memory, hence should be able to
 		// postpone the lock after the dmi access
-		bus_lock->wait_for_access_rights(iss.get_hart_id());
+		wait_for_access_rights();
 
 		for (auto &e : dmi_ranges) {
 			if (e.contains(addr)) {
+				++iss.stats.dmi_accesses;
 				quantum_keeper.inc(dmi_access_delay);
 				return e.load<T>(addr);
 			}
@@ -97,11 +128,12 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 
 	template <typename T>
 	inline void _raw_store_data(uint64_t addr, T value) {
-		bus_lock->wait_for_access_rights(iss.get_hart_id());
+		wait_for_access_rights();
 
 		bool done = false;
 		for (auto &e : dmi_ranges) {
 			if (e.contains(addr)) {
+				++iss.stats.dmi_accesses;
 				quantum_keeper.inc(dmi_access_delay);
 				e.store(addr, value);
 				done = true;
@@ -175,7 +207,7 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 	}
 
 	virtual int32_t atomic_load_word(uint64_t addr) override {
-		bus_lock->lock(iss.get_hart_id());
+		lock_bus();
 		return load_word(addr);
 	}
 	virtual void atomic_store_word(uint64_t addr, uint32_t value) override {
@@ -183,7 +215,7 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 		store_word(addr, value);
 	}
 	virtual int32_t atomic_load_reserved_word(uint64_t addr) override {
-		bus_lock->lock(iss.get_hart_id());
+		lock_bus();
 		lr_addr = addr;
 		return load_word(addr);
 	}
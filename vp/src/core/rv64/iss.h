@@ -2,9 +2,15 @@
 
 #include "core/common/bus_lock_if.h"
 #include "core/common/clint_if.h"
+#include "core/common/coverage.h"
 #include "core/common/core_defs.h"
 #include "core/common/instr.h"
+#include "core/common/instr_mix.h"
 #include "core/common/irq_if.h"
+#include "core/common/irq_latency.h"
+#include "core/common/profiler.h"
+#include "core/common/stats.h"
+#include "core/common/trace.h"
 #include "core/common/trap.h"
 #include "csr.h"
 #include "fp.h"
@@ -147,6 +153,12 @@ struct ISS : public external_interrupt_target, public clint_interrupt_target, pu
 	uint64_t pc = 0;
 	uint64_t last_pc = 0;
 	bool trace = false;
+	HartTrace *tracer = nullptr;  // optional, binary instruction trace
+	HartProfile *profiler = nullptr;  // optional, sampling profiler
+	Coverage *coverage = nullptr;     // optional, guest code coverage
+	HartInstrMix *instr_mix = nullptr;  // optional, instruction mix
+	IrqLatency *irq_latency = nullptr;  // optional, interrupt latency
+	HartStats stats;
 	bool shall_exit = false;
 	bool ignore_wfi = false;
 	csr_table csrs;
@@ -167,6 +179,8 @@ struct ISS : public external_interrupt_target, public clint_interrupt_target, pu
 	tlm_utils::tlm_quantumkeeper quantum_keeper;
 	sc_core::sc_time cycle_time;
 	sc_core::sc_time cycle_counter;  // use a separate cycle counter, since cycle count can be inhibited
+	uint64_t mtime_scaler = 1;       // cached from the CLINT, see get_mtime()
+	uint64_t last_mtime = 0;
 	std::array<sc_core::sc_time, Opcode::NUMBER_OF_INSTRUCTIONS> instr_cycles;
 
 	static constexpr int64_t REG_MIN = INT64_MIN;
@@ -191,6 +205,7 @@ struct ISS : public external_interrupt_target, public clint_interrupt_target, pu
 	void exec_step();
 
 	uint64_t _compute_and_get_current_cycles();
+	uint64_t get_mtime();
 
 	void init(instr_memory_if *instr_mem, data_memory_if *data_mem, clint_if *clint, uint64_t entrypoint, uint64_t sp);
 
@@ -19,6 +19,7 @@ struct InstrMemoryProxy : public instr_memory_if {
 
 	virtual uint32_t load_instr(uint64_t pc) override {
 		assert((core.csrs.satp.mode == SATP_MODE_BARE) && "InstrMemoryProxy does not support virtual memory");
+		++core.stats.dmi_accesses;
 		quantum_keeper.inc(access_delay);
 		return *(dmi.get_mem_ptr_to_global_addr<uint32_t>(pc));
 	}
@@ -50,6 +51,8 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 	}
 
 	inline void _do_transaction(tlm::tlm_command cmd, uint64_t addr, uint8_t *data, unsigned num_bytes) {
+		++iss.stats.tlm_accesses;
+
 		tlm::tlm_generic_payload trans;
 		trans.set_command(cmd);
 		trans.set_address(addr);
@@ -76,14 +79,40 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 		}
 	}
 
+	bool locked_by_other_hart() {
+		return bus_lock->is_locked() && !bus_lock->is_locked(iss.get_hart_id());
+	}
+
+	// waiting for the lock of another hart suspends this one in SystemC
+	void lock_bus() {
+		if (locked_by_other_hart()) {
+			++iss.stats.bus_lock_waits;
+			iss.stats.suspend();
+			bus_lock->lock(iss.get_hart_id());
+			iss.stats.resume();
+		} else {
+			bus_lock->lock(iss.get_hart_id());
+		}
+	}
+
+	void wait_for_access_rights() {
+		if (locked_by_other_hart()) {
+			++iss.stats.bus_lock_waits;
+			iss.stats.suspend();
+			bus_lock->wait_until_unlocked();
+			iss.stats.resume();
+		}
+	}
+
 	template <typename T>
 	inline T _raw_load_data(uint64_t addr) {
 		// NOTE: a DMI load will not context switch (SystemC) and not modify the memory, hence should be able to
 		// postpone the lock after the dmi access
-		bus_lock->wait_for_access_rights(iss.get_hart_id());
+		wait_for_access_rights();
 
 		for (auto &e : dmi_ranges) {
 			if (e.contains(addr)) {
+				++iss.stats.dmi_accesses;
 				quantum_keeper.inc(dmi_access_delay);
 
 				T ans = *(e.get_mem_ptr_to_global_addr<T>(addr));
@@ -98,11 +127,12 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 
 	template <typename T>
 	inline void _raw_store_data(uint64_t addr, T value) {
-		bus_lock->wait_for_access_rights(iss.get_hart_id());
+		wait_for_access_rights();
 
 		bool done = false;
 		for (auto &e : dmi_ranges) {
 			if (e.contains(addr)) {
+				++iss.stats.dmi_accesses;
 				quantum_keeper.inc(dmi_access_delay);
 
 				*(e.get_mem_ptr_to_global_addr<T>(addr)) = value;
@@ -145,7 +175,7 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 
 	template <typename T>
 	T _atomic_load_data(uint64_t addr) {
-		bus_lock->lock(iss.get_hart_id());
+		lock_bus();
 		return _load_data<T>(addr);
 	}
 	template <typename T>
@@ -155,7 +185,7 @@ struct CombinedMemoryInterface : public sc_core::sc_module,
 	}
 	template <typename T>
 	T _atomic_load_reserved_data(uint64_t addr) {
-		bus_lock->lock(iss.get_hart_id());
+		lock_bus();
 		lr_addr = addr;
 		return _load_data<T>(addr);
 	}
@@ -7,22 +7,46 @@
 
 #include "core/common/irq_if.h"
 
+/*
+ * Raises an interrupt every millisecond. The next tick is only scheduled
+ * while the interrupt is enabled in the PLIC, hence the timer does not wake
+ * up the simulation kernel when nobody is listening. Ticks stay aligned to
+ * multiples of the period, so enabling the interrupt later on does not shift
+ * the phase.
+ */
 struct BasicTimer : public sc_core::sc_module {
 	interrupt_gateway *plic = 0;
 	uint32_t irq_number = 0;
+	sc_core::sc_event tick_event;
+	sc_core::sc_time period = sc_core::sc_time(1, sc_core::SC_MS);
 
 	SC_HAS_PROCESS(BasicTimer);
 
 	BasicTimer(sc_core::sc_module_name, uint32_t irq_number) : irq_number(irq_number) {
-		SC_THREAD(run);
+		SC_METHOD(tick);
+		sensitive << tick_event;
+		dont_initialize();
 	}
 
-	void run() {
-		while (true) {
-			sc_core::wait(sc_core::sc_time(1, sc_core::SC_MS));
+	void start_of_simulation() {
+		plic->gateway_on_enable_change(irq_number, std::bind(&BasicTimer::schedule, this));
+		schedule();
+	}
 
-			plic->gateway_trigger_interrupt(irq_number);
+	void schedule() {
+		if (!plic->gateway_interrupt_enabled(irq_number)) {
+			tick_event.cancel();
+			return;
 		}
+
+		auto now = sc_core::sc_time_stamp();
+		auto next = period * (double)(now.value() / period.value() + 1);
+		tick_event.notify(next - now);
+	}
+
+	void tick() {
+		plic->gateway_trigger_interrupt(irq_number);
+		schedule();
 	}
 };
 
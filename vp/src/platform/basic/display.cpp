@@ -6,17 +6,92 @@
  */
 
 #include "display.hpp"
+#include "display_kernels.h"
 #include <math.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
 using namespace frame;
 
-Display::Display(sc_module_name) {
+Display::Display(sc_module_name, uint32_t irq_number) : irq_number(irq_number), shownBackground(new Frame()) {
 	tsock.register_b_transport(this, &Display::transport);
 	createSM();
 	memset(frame.raw, 0, sizeof(Framebuffer));
+
+	SC_METHOD(engineDone);
+	sensitive << doneEvent;
+	dont_initialize();
+}
+
+MemoryDMI Display::getFramesDMI(uint64_t baseAddr) {
+	static_assert(offsetof(Framebuffer, background) == offsetof(Framebuffer, frames) + sizeof(Framebuffer::frames),
+	              "frames and background must be contiguous");
+	return MemoryDMI::create_start_size_mapping(&frame.raw[offsetof(Framebuffer, frames)],
+	                                            baseAddr + offsetof(Framebuffer, frames),
+	                                            sizeof(Framebuffer::frames) + sizeof(Framebuffer::background));
+}
+
+uint64_t Display::applyFrame() {
+	Frame &next = frame.buf->getInactiveFrame();
+	Frame &shown = frame.buf->getActiveFrame();
+	Frame &background = frame.buf->getBackground();
+
+	// collect bands of rows which changed since the last frame
+	std::vector<std::pair<uint16_t, uint16_t>> bands;
+	for (uint16_t row = 0; row < screenHeight; row++) {
+		bool fg = memcmp(next.raw[row], shown.raw[row], sizeof(next.raw[row])) != 0;
+		bool bg = memcmp(background.raw[row], shownBackground->raw[row], sizeof(background.raw[row])) != 0;
+		if (!fg && !bg)
+			continue;
+
+		if (bg)
+			memcpy(shownBackground->raw[row], background.raw[row], sizeof(background.raw[row]));
+		if (!bands.empty() && bands.back().second == row)
+			bands.back().second = row + 1;
+		else
+			bands.emplace_back(row, row + 1);
+	}
+
+	frame.buf->activeFrame++;
+
+	// the new inactive frame starts as a copy of the active one,
+	// only the changed rows differ
+	for (auto &b : bands)
+		memcpy(shown.raw[b.first], next.raw[b.first], (b.second - b.first) * sizeof(next.raw[0]));
+
+	uint64_t rows = 0;
+	for (auto &b : bands)
+		rows += b.second - b.first;
+
+	if (bands.size() > Framebuffer::dirtyLogSize / 4)
+		publishRegion(bands.front().first, bands.back().second);
+	else
+		for (auto &b : bands)
+			publishRegion(b.first, b.second);
+	publishFrame();
+
+	return rows * screenWidth;
+}
+
+void Display::publishRegion(uint16_t top, uint16_t bottom) {
+	Framebuffer::DirtyLog &log = frame.buf->dirty;
+	uint32_t head = log.head;
+
+	DirtyRegion &r = log.regions[head % Framebuffer::dirtyLogSize];
+	r.sequence = log.sequence + 1;
+	r.top = top;
+	r.bottom = bottom;
+	__atomic_store_n(&log.head, head + 1, __ATOMIC_RELEASE);
+}
+
+void Display::publishFrame() {
+	Framebuffer::DirtyLog &log = frame.buf->dirty;
+	__atomic_store_n(&log.sequence, log.sequence + 1, __ATOMIC_RELEASE);
 }
 
 void Display::createSM() {
@@ -44,27 +119,7 @@ void Display::transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay
 
 	if (cmd == tlm::TLM_WRITE_COMMAND) {
 		if (addr == offsetof(Framebuffer, command) && len == sizeof(Framebuffer::Command)) {  // apply command
-			switch (*reinterpret_cast<Framebuffer::Command *>(ptr)) {
-				case Framebuffer::Command::clearAll:
-					memset(frame.raw, 0, sizeof(Framebuffer));
-					frame.buf->activeFrame++;
-					break;
-				case Framebuffer::Command::fillFrame:
-					fillFrame(frame.buf->parameter.fill.frame, frame.buf->parameter.fill.color);
-					break;
-				case Framebuffer::Command::applyFrame:
-					frame.buf->activeFrame++;
-					memcpy(&frame.buf->getInactiveFrame(), &frame.buf->getActiveFrame(), sizeof(Frame));
-					break;
-				case Framebuffer::Command::drawLine:
-					drawLine(frame.buf->parameter.line.frame, frame.buf->parameter.line.from,
-					         frame.buf->parameter.line.to, frame.buf->parameter.line.color);
-					break;
-				default:
-					cerr << "unknown framebuffer command " << *ptr << endl;
-					sc_assert(false);
-					break;
-			}
+			runCommand(*reinterpret_cast<Framebuffer::Command *>(ptr));
 			// reset parameter
 			memset(reinterpret_cast<void *>(&frame.buf->parameter), 0, sizeof(Framebuffer::Parameter));
 		} else if (addr >= offsetof(Framebuffer, parameter) &&
@@ -83,41 +138,180 @@ void Display::transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay
 	delay += sc_core::sc_time(len * 5, sc_core::SC_NS);
 }
 
-void Display::fillFrame(Framebuffer::Type type, Color color) {
-	assert(sizeof(Frame) % 8 == 0);
-	assert(8 % sizeof(Color) == 0);
-	uint64_t *rawFrame = reinterpret_cast<uint64_t *>(&frame.buf->getFrame(type).raw);
-	uint_fast32_t steps = sizeof(Frame) / 8;
-	uint64_t wideColor = 0;
-	for (uint_fast8_t i = 0; i * sizeof(Color) < 8; i++) {
-		reinterpret_cast<Color *>(&wideColor)[i] = color;
+void Display::runCommand(Framebuffer::Command command) {
+	Framebuffer::Parameter &p = frame.buf->parameter;
+	uint64_t pixels = 0;
+
+	switch (command) {
+		case Framebuffer::Command::clearAll:
+			// keep the dirty log, viewers track it across frames
+			memset(frame.raw, 0, offsetof(Framebuffer, dirty));
+			memset(shownBackground.get(), 0, sizeof(Frame));
+			frame.buf->activeFrame++;
+			publishRegion(0, screenHeight);
+			publishFrame();
+			pixels = 3 * screenWidth * screenHeight;
+			break;
+		case Framebuffer::Command::fillFrame:
+			pixels = fillFrame(p.fill.frame, p.fill.color);
+			break;
+		case Framebuffer::Command::applyFrame:
+			pixels = applyFrame();
+			break;
+		case Framebuffer::Command::drawLine:
+			pixels = drawLine(p.line.frame, p.line.from, p.line.to, p.line.color);
+			break;
+		case Framebuffer::Command::fillRect:
+			pixels = fillRect(p.rect.frame, p.rect.from, p.rect.to, p.rect.color);
+			break;
+		case Framebuffer::Command::blit:
+			pixels = copyRect(false);
+			break;
+		case Framebuffer::Command::blend:
+			pixels = copyRect(true);
+			break;
+		case Framebuffer::Command::drawText:
+			pixels = drawText();
+			break;
+		default:
+			cerr << "unknown framebuffer command " << (unsigned)command << endl;
+			sc_assert(false);
+			break;
+	}
+
+	startEngine(pixels);
+}
+
+void Display::startEngine(uint64_t pixels) {
+	// commands queue up behind the ones still in progress
+	busyUntil = std::max(busyUntil, sc_core::sc_time_stamp()) + pixelDelay * (double)pixels;
+	frame.buf->status |= Framebuffer::statusBusy;
+	doneEvent.notify(busyUntil - sc_core::sc_time_stamp());
+}
+
+void Display::engineDone() {
+	// an earlier notification may still be pending from a previous command
+	if (sc_core::sc_time_stamp() < busyUntil) {
+		doneEvent.notify(busyUntil - sc_core::sc_time_stamp());
+		return;
+	}
+
+	frame.buf->status = Framebuffer::statusDone;
+	if (plic)
+		plic->gateway_trigger_interrupt(irq_number);
+}
+
+uint8_t *Display::memPtr(uint32_t addr, uint32_t len) {
+	for (auto &e : dmi_ranges) {
+		if (e.contains(addr) && (len == 0 || e.contains((uint64_t)addr + len - 1)))
+			return e.get_mem_ptr_to_global_addr<uint8_t>(addr);
 	}
-	for (uint_fast32_t i = 0; i < steps; i++) {
-		rawFrame[i] = wideColor;
+	throw std::runtime_error("display: command accesses memory outside of DMI ranges");
+}
+
+uint64_t Display::fillFrame(Framebuffer::Type type, Color color) {
+	kernels::fill(&frame.buf->getFrame(type).raw[0][0], screenWidth * screenHeight, color);
+	return screenWidth * screenHeight;
+}
+
+uint64_t Display::fillRect(Framebuffer::Type type, Point from, Point to, Color color) {
+	Frame &local = frame.buf->getFrame(type);
+	uint32_t right = std::min<uint32_t>(to.x, screenWidth);
+	uint32_t bottom = std::min<uint32_t>(to.y, screenHeight);
+	if (from.x >= right || from.y >= bottom)
+		return 0;
+
+	for (uint32_t y = from.y; y < bottom; y++) kernels::fill(&local.raw[y][from.x], right - from.x, color);
+	return (uint64_t)(right - from.x) * (bottom - from.y);
+}
+
+uint64_t Display::copyRect(bool blend) {
+	auto &p = frame.buf->parameter.copy;
+	Frame &dst = frame.buf->getFrame(p.dstFrame);
+
+	// clip to the destination frame and, if any, the source frame
+	uint32_t width = p.dst.x < screenWidth ? std::min<uint32_t>(p.size.x, screenWidth - p.dst.x) : 0;
+	uint32_t height = p.dst.y < screenHeight ? std::min<uint32_t>(p.size.y, screenHeight - p.dst.y) : 0;
+	if (!p.srcAddr) {
+		width = p.src.x < screenWidth ? std::min<uint32_t>(width, screenWidth - p.src.x) : 0;
+		height = p.src.y < screenHeight ? std::min<uint32_t>(height, screenHeight - p.src.y) : 0;
 	}
+	if (width == 0 || height == 0)
+		return 0;
+
+	const Color *src;
+	size_t pitch;
+	if (p.srcAddr) {
+		pitch = p.srcPitch;
+		src = reinterpret_cast<const Color *>(
+		    memPtr(p.srcAddr + (p.src.y * pitch + p.src.x) * sizeof(Color), ((height - 1) * pitch + width) * sizeof(Color)));
+	} else {
+		pitch = screenWidth;
+		src = &frame.buf->getFrame(p.srcFrame).raw[p.src.y][p.src.x];
+	}
+
+	// overlapping areas are copied through a temporary buffer
+	std::vector<Color> tmp;
+	const Color *dstEnd = &dst.raw[p.dst.y + height - 1][p.dst.x + width];
+	const Color *srcEnd = src + (height - 1) * pitch + width;
+	if (src < dstEnd && &dst.raw[p.dst.y][p.dst.x] < srcEnd) {
+		tmp.resize(width * height);
+		for (uint32_t y = 0; y < height; y++) memcpy(&tmp[y * width], src + y * pitch, width * sizeof(Color));
+		src = tmp.data();
+		pitch = width;
+	}
+
+	for (uint32_t y = 0; y < height; y++) {
+		Color *d = &dst.raw[p.dst.y + y][p.dst.x];
+		if (blend)
+			kernels::blend(d, src + y * pitch, width, p.alpha, p.transparent);
+		else
+			kernels::copy(d, src + y * pitch, width, p.transparent);
+	}
+	return (uint64_t)width * height;
+}
+
+uint64_t Display::drawText() {
+	auto &p = frame.buf->parameter.text;
+	Frame &local = frame.buf->getFrame(p.frame);
+	const uint8_t *text = memPtr(p.text, p.length);
+	uint64_t pixels = 0;
+
+	uint32_t x = p.pos.x;
+	for (uint32_t i = 0; i < p.length && x < screenWidth; i++, x += 8) {
+		uint8_t c = text[i] - p.firstChar;
+		const uint8_t *glyph = memPtr(p.font + c * p.glyphHeight, p.glyphHeight);
+		size_t n = std::min<uint32_t>(8, screenWidth - x);
+
+		for (uint32_t row = 0; row < p.glyphHeight && p.pos.y + row < screenHeight; row++) {
+			kernels::glyph(&local.raw[p.pos.y + row][x], glyph[row], n, p.color, p.background, p.opaque);
+			pixels += n;
+		}
+	}
+	return pixels;
 }
 
-void Display::drawLine(Framebuffer::Type type, PointF from, PointF to, Color color) {
+uint64_t Display::drawLine(Framebuffer::Type type, PointF from, PointF to, Color color) {
 	Frame &local = frame.buf->getFrame(type);
 	if (from.x == to.x) {  // vertical line
 		if (from.y > to.y)
 			swap(from.y, to.y);
 		uint16_t intFromX = from.x;
+		uint16_t intFromY = from.y;
 		uint16_t intToY = to.y;
-		for (uint16_t y = from.y; y <= intToY; y++) {
+		for (uint16_t y = intFromY; y <= intToY; y++) {
 			local.raw[y][intFromX] = color;
 		}
-		return;
+		return intToY - intFromY + 1;
 	}
 	if (from.y == to.y) {  // horizontal line, the fastest
 		if (from.x > to.x)
 			swap(from.x, to.x);
+		uint16_t intFromX = from.x;
 		uint16_t intFromY = from.y;
 		uint16_t intToX = to.x;
-		for (uint16_t x = from.x; x <= intToX; x++) {
-			local.raw[intFromY][x] = color;
-		}
-		return;
+		kernels::fill(&local.raw[intFromY][intFromX], intToX - intFromX + 1, color);
+		return intToX - intFromX + 1;
 	}
 
 	// Bresenham's line algorithm
@@ -140,8 +334,9 @@ void Display::drawLine(Framebuffer::Type type, PointF from, PointF to, Color col
 	int y = (int)from.y;
 
 	const int maxX = (int)to.x;
+	const int minX = (int)from.x;
 
-	for (int x = (int)from.x; x < maxX; x++) {
+	for (int x = minX; x < maxX; x++) {
 		if (steep) {
 			local.raw[x][y] = color;
 		} else {
@@ -154,4 +349,5 @@ void Display::drawLine(Framebuffer::Type type, PointF from, PointF to, Color col
 			error += dx;
 		}
 	}
+	return maxX > minX ? maxX - minX : 0;
 }
@@ -8,8 +8,12 @@
 #pragma once
 
 #include <tlm_utils/simple_target_socket.h>
+#include <memory>
+#include <vector>
 #include <systemc>
 #include "../../../../env/basic/vp-display/framebuffer.h"
+#include "core/common/dmi.h"
+#include "core/common/irq_if.h"
 
 using namespace std;
 using namespace sc_core;
@@ -20,17 +24,48 @@ struct Display : public sc_core::sc_module {
 
 	simple_target_socket<Display> tsock;
 
+	interrupt_gateway* plic = 0;
+	uint32_t irq_number = 0;
+
+	// memory holding source images, text and fonts of commands
+	std::vector<MemoryDMI> dmi_ranges;
+
+	// time the 2D engine needs per pixel, see Framebuffer::status
+	sc_core::sc_time pixelDelay = sc_core::sc_time(1, sc_core::SC_NS);
+	sc_core::sc_time busyUntil;
+	sc_core::sc_event doneEvent;
+
 	union {
 		uint8_t* raw;
 		Framebuffer* buf;
 	} frame;
 
+	// background as last published, to detect changes done through DMI
+	std::unique_ptr<Frame> shownBackground;
+
 	void createSM();
 
-	Display(sc_module_name);
+	SC_HAS_PROCESS(Display);
+
+	Display(sc_module_name, uint32_t irq_number = 0);
 	void transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay);
+	void runCommand(Framebuffer::Command command);
+	void startEngine(uint64_t pixels);
+	void engineDone();
+
+	// frames and background, accessed directly by the CPU and DMA
+	MemoryDMI getFramesDMI(uint64_t baseAddr);
+
+	uint64_t applyFrame();
+	void publishRegion(uint16_t top, uint16_t bottom);
+	void publishFrame();
+
+	uint8_t* memPtr(uint32_t addr, uint32_t len);
 
-	// graphics acceleration functions
-	void fillFrame(Framebuffer::Type frame, Color color);
-	void drawLine(Framebuffer::Type frame, frame::PointF from, frame::PointF to, Color color);
+	// graphics acceleration functions, return the number of pixels written
+	uint64_t fillFrame(Framebuffer::Type frame, Color color);
+	uint64_t drawLine(Framebuffer::Type frame, frame::PointF from, frame::PointF to, Color color);
+	uint64_t fillRect(Framebuffer::Type frame, frame::Point from, frame::Point to, Color color);
+	uint64_t copyRect(bool blend);
+	uint64_t drawText();
 };
@@ -0,0 +1,182 @@
+/*
+ * display_kernels.cpp
+ */
+
+#include "display_kernels.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+namespace kernels {
+
+static inline Color blendPixel(Color s, Color d, int alpha) {
+	Color r = 0;
+	for (int shift = 0; shift < 12; shift += 4) {
+		int sc = (s >> shift) & 0xf;
+		int dc = (d >> shift) & 0xf;
+		r |= ((dc + (((sc - dc) * alpha) >> 8)) & 0xf) << shift;
+	}
+	return r;
+}
+
+static void fillScalar(Color* dst, size_t n, Color color) {
+	for (size_t i = 0; i < n; i++) dst[i] = color;
+}
+
+static void copyScalar(Color* dst, const Color* src, size_t n, bool transparent) {
+	if (!transparent) {
+		memmove(dst, src, n * sizeof(Color));
+		return;
+	}
+	for (size_t i = 0; i < n; i++)
+		if (src[i])
+			dst[i] = src[i];
+}
+
+// alpha is scaled to 0..256, hence 255 yields the source exactly
+static void blendScalar(Color* dst, const Color* src, size_t n, int alpha, bool transparent) {
+	for (size_t i = 0; i < n; i++) {
+		if (transparent && !src[i])
+			continue;
+		dst[i] = blendPixel(src[i], dst[i], alpha);
+	}
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("avx2"))) static void fillAVX2(Color* dst, size_t n, Color color) {
+	__m256i c = _mm256_set1_epi16(color);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) _mm256_storeu_si256((__m256i*)&dst[i], c);
+	fillScalar(&dst[i], n - i, color);
+}
+
+__attribute__((target("avx2"))) static void copyAVX2(Color* dst, const Color* src, size_t n, bool transparent) {
+	if (!transparent) {
+		memmove(dst, src, n * sizeof(Color));
+		return;
+	}
+
+	__m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256i s = _mm256_loadu_si256((const __m256i*)&src[i]);
+		__m256i d = _mm256_loadu_si256((const __m256i*)&dst[i]);
+		__m256i skip = _mm256_cmpeq_epi16(s, zero);
+		_mm256_storeu_si256((__m256i*)&dst[i], _mm256_blendv_epi8(s, d, skip));
+	}
+	copyScalar(&dst[i], &src[i], n - i, transparent);
+}
+
+__attribute__((target("avx2"))) static void blendAVX2(Color* dst, const Color* src, size_t n, int alpha,
+                                                      bool transparent) {
+	__m256i a = _mm256_set1_epi16(alpha);
+	__m256i mask = _mm256_set1_epi16(0xf);
+	__m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256i s = _mm256_loadu_si256((const __m256i*)&src[i]);
+		__m256i d = _mm256_loadu_si256((const __m256i*)&dst[i]);
+
+		// the three 4 bit channels, processed in 16 bit lanes
+		__m256i sc = _mm256_and_si256(s, mask);
+		__m256i dc = _mm256_and_si256(d, mask);
+		__m256i r = _mm256_and_si256(
+		    _mm256_add_epi16(dc, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(sc, dc), a), 8)), mask);
+
+		sc = _mm256_and_si256(_mm256_srli_epi16(s, 4), mask);
+		dc = _mm256_and_si256(_mm256_srli_epi16(d, 4), mask);
+		__m256i c = _mm256_and_si256(
+		    _mm256_add_epi16(dc, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(sc, dc), a), 8)), mask);
+		r = _mm256_or_si256(r, _mm256_slli_epi16(c, 4));
+
+		sc = _mm256_and_si256(_mm256_srli_epi16(s, 8), mask);
+		dc = _mm256_and_si256(_mm256_srli_epi16(d, 8), mask);
+		c = _mm256_and_si256(
+		    _mm256_add_epi16(dc, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(sc, dc), a), 8)), mask);
+		r = _mm256_or_si256(r, _mm256_slli_epi16(c, 8));
+
+		if (transparent)
+			r = _mm256_blendv_epi8(r, d, _mm256_cmpeq_epi16(s, zero));
+		_mm256_storeu_si256((__m256i*)&dst[i], r);
+	}
+	blendScalar(&dst[i], &src[i], n - i, alpha, transparent);
+}
+
+static bool hasAVX2() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static const bool useAVX2 = hasAVX2();
+
+void fill(Color* dst, size_t n, Color color) {
+	if (useAVX2)
+		fillAVX2(dst, n, color);
+	else
+		fillScalar(dst, n, color);
+}
+
+void copy(Color* dst, const Color* src, size_t n, bool transparent) {
+	if (useAVX2)
+		copyAVX2(dst, src, n, transparent);
+	else
+		copyScalar(dst, src, n, transparent);
+}
+
+void blend(Color* dst, const Color* src, size_t n, uint8_t alpha, bool transparent) {
+	if (useAVX2)
+		blendAVX2(dst, src, n, alpha + (alpha >> 7), transparent);
+	else
+		blendScalar(dst, src, n, alpha + (alpha >> 7), transparent);
+}
+
+// SSE2 is always available on x86-64, a glyph row fits into one register
+void glyph(Color* dst, uint8_t bits, size_t n, Color fg, Color bg, bool opaque) {
+	if (n < 8) {
+		for (size_t i = 0; i < n; i++) {
+			if (bits & (0x80 >> i))
+				dst[i] = fg;
+			else if (opaque)
+				dst[i] = bg;
+		}
+		return;
+	}
+
+	__m128i bitmask = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+	__m128i set = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(bits), bitmask), bitmask);
+	__m128i back = opaque ? _mm_set1_epi16(bg) : _mm_loadu_si128((const __m128i*)dst);
+	__m128i r = _mm_or_si128(_mm_and_si128(set, _mm_set1_epi16(fg)), _mm_andnot_si128(set, back));
+	_mm_storeu_si128((__m128i*)dst, r);
+}
+
+#else
+
+void fill(Color* dst, size_t n, Color color) {
+	fillScalar(dst, n, color);
+}
+
+void copy(Color* dst, const Color* src, size_t n, bool transparent) {
+	copyScalar(dst, src, n, transparent);
+}
+
+void blend(Color* dst, const Color* src, size_t n, uint8_t alpha, bool transparent) {
+	blendScalar(dst, src, n, alpha + (alpha >> 7), transparent);
+}
+
+void glyph(Color* dst, uint8_t bits, size_t n, Color fg, Color bg, bool opaque) {
+	for (size_t i = 0; i < n && i < 8; i++) {
+		if (bits & (0x80 >> i))
+			dst[i] = fg;
+		else if (opaque)
+			dst[i] = bg;
+	}
+}
+
+#endif
+
+}  // namespace kernels
@@ -0,0 +1,30 @@
+/*
+ * display_kernels.h
+ *
+ * Pixel span operations of the display 2D engine. On x86 vectorized
+ * versions are selected at runtime, otherwise scalar loops are used.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../../../env/basic/vp-display/framebuffer.h"
+
+namespace kernels {
+
+// dst[0..n) = color
+void fill(Color* dst, size_t n, Color color);
+
+// dst[0..n) = src[0..n), pixels of color 0 are skipped if transparent
+void copy(Color* dst, const Color* src, size_t n, bool transparent);
+
+// dst[0..n) = src * alpha + dst * (255 - alpha) per RGB444 channel
+void blend(Color* dst, const Color* src, size_t n, uint8_t alpha, bool transparent);
+
+// draws the first n (at most 8) pixels of a glyph row, MSB first,
+// unset pixels are set to bg if opaque and left unchanged otherwise
+void glyph(Color* dst, uint8_t bits, size_t n, Color fg, Color bg, bool opaque);
+
+}  // namespace kernels
@@ -6,8 +6,31 @@
 #include <tlm_utils/simple_initiator_socket.h>
 #include <tlm_utils/simple_target_socket.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <unordered_map>
-
+#include <vector>
+
+#include "core/common/bus_lock_if.h"
+#include "core/common/dmi.h"
+#include "core/common/irq_if.h"
+
+/*
+ * Memory operations on LEN bytes, started by writing OP:
+ *
+ *  - MEMCPY/MEMMOVE copy from SRC to DST (overlapping ranges are allowed)
+ *  - MEMSET fills DST with the lowest byte of SRC
+ *  - MEMCMP compares SRC and DST, STAT is 0, -1 or 1 like memcmp(3)
+ *  - MEMCHR searches SRC for the lowest byte of DST, STAT is the offset of
+ *    the first match or 0xffffffff
+ *  - CHAIN executes the linked list of descriptors at DESC (scatter-gather),
+ *    STAT is the result of the last descriptor
+ *
+ * Ranges within the DMI regions are accessed directly, all others through
+ * the bus. The duration is computed from the number of bytes moved and the
+ * bandwidth; the interrupt is raised once it passed.
+ */
 struct SimpleDMA : public sc_core::sc_module {
 	tlm_utils::simple_initiator_socket<SimpleDMA> isock;
 	tlm_utils::simple_target_socket<SimpleDMA> tsock;
@@ -15,13 +38,23 @@ struct SimpleDMA : public sc_core::sc_module {
 	interrupt_gateway *plic = 0;
 	uint32_t irq_number = 0;
 
+	// optional, regions accessed without bus transactions
+	std::vector<MemoryDMI> dmi_ranges;
+	std::shared_ptr<bus_lock_if> bus_lock;
+
+	// timing model: fixed setup time plus the time to move the data
+	sc_core::sc_time setup_delay = sc_core::sc_time(10, sc_core::SC_NS);
+	sc_core::sc_time byte_delay = sc_core::sc_time(250, sc_core::SC_PS);
+
 	std::array<uint8_t, 64> buffer;
+	std::array<uint8_t, 64> buffer2;
 
 	uint32_t src = 0;
 	uint32_t dst = 0;
 	uint32_t len = 0;
 	uint32_t op = 0;
 	uint32_t stat = 0;
+	uint32_t desc = 0;
 
 	std::unordered_map<uint64_t, uint32_t *> addr_to_reg;
 
@@ -32,6 +65,7 @@ struct SimpleDMA : public sc_core::sc_module {
 		OP_MEMCMP = 3,
 		OP_MEMCHR = 4,
 		OP_MEMMOVE = 5,
+		OP_CHAIN = 6,
 	};
 
 	enum {
@@ -40,10 +74,24 @@ struct SimpleDMA : public sc_core::sc_module {
 		LEN_ADDR = 8,
 		OP_ADDR = 12,
 		STAT_ADDR = 16,
+		DESC_ADDR = 20,
+	};
+
+	// scatter-gather descriptor in memory, next == 0 ends the chain
+	struct Descriptor {
+		uint32_t op;
+		uint32_t src;
+		uint32_t dst;
+		uint32_t len;
+		uint32_t next;
 	};
 
 	sc_core::sc_event run_event;
 
+	// bytes moved and bus delays of the current operation
+	uint64_t bytes = 0;
+	sc_core::sc_time bus_delay;
+
 	SC_HAS_PROCESS(SimpleDMA);
 
 	SimpleDMA(sc_core::sc_module_name, uint32_t irq_number) : irq_number(irq_number) {
@@ -52,62 +100,168 @@ struct SimpleDMA : public sc_core::sc_module {
 		SC_THREAD(run);
 
 		addr_to_reg = {
-		    {SRC_ADDR, &src},
-		    {DST_ADDR, &dst},
-		    {LEN_ADDR, &len},
-		    {OP_ADDR, &op},
+		    {SRC_ADDR, &src}, {DST_ADDR, &dst}, {LEN_ADDR, &len},
+		    {OP_ADDR, &op},   {STAT_ADDR, &stat}, {DESC_ADDR, &desc},
 		};
 	}
 
-	void _copy_block(uint32_t off, uint32_t n) {
-		do_transaction(tlm::TLM_READ_COMMAND, src + off, &buffer[0], n);
-		do_transaction(tlm::TLM_WRITE_COMMAND, dst + off, &buffer[0], n);
+	uint8_t *dmi_ptr(uint32_t addr, uint32_t n) {
+		for (auto &e : dmi_ranges) {
+			if (e.contains(addr) && (n == 0 || e.contains((uint64_t)addr + n - 1)))
+				return e.get_mem_ptr_to_global_addr<uint8_t>(addr);
+		}
+		return nullptr;
+	}
+
+	void read(uint32_t addr, uint8_t *data, uint32_t n) {
+		uint8_t *p = dmi_ptr(addr, n);
+		if (p)
+			memcpy(data, p, n);
+		else
+			do_transaction(tlm::TLM_READ_COMMAND, addr, data, n);
+	}
+
+	void write(uint32_t addr, const uint8_t *data, uint32_t n) {
+		uint8_t *p = dmi_ptr(addr, n);
+		if (p)
+			memcpy(p, data, n);
+		else
+			do_transaction(tlm::TLM_WRITE_COMMAND, addr, const_cast<uint8_t *>(data), n);
 	}
 
-	void _perform_memcpy() {
-		auto n = len;
-		uint32_t off = 0;
+	void _perform_memmove(uint32_t src, uint32_t dst, uint32_t len) {
+		bytes += 2 * (uint64_t)len;
 
-		while (n > buffer.size()) {
-			_copy_block(off, buffer.size());
-			n -= buffer.size();
-			off += buffer.size();
+		uint8_t *s = dmi_ptr(src, len);
+		uint8_t *d = dmi_ptr(dst, len);
+		if (s && d) {
+			memmove(d, s, len);
+			return;
 		}
 
-		_copy_block(off, n);
+		// copy from the end if the destination overlaps the source tail
+		bool backward = dst > src && dst - src < len;
+		for (uint32_t done = 0; done < len;) {
+			uint32_t n = std::min<uint32_t>(len - done, buffer.size());
+			uint32_t off = backward ? len - done - n : done;
+			read(src + off, &buffer[0], n);
+			write(dst + off, &buffer[0], n);
+			done += n;
+		}
 	}
 
-	void run() {
-		while (true) {
-			sc_core::wait(run_event);
+	void _perform_memset(uint32_t dst, uint8_t value, uint32_t len) {
+		bytes += len;
+
+		uint8_t *d = dmi_ptr(dst, len);
+		if (d) {
+			memset(d, value, len);
+			return;
+		}
+
+		buffer.fill(value);
+		for (uint32_t off = 0; off < len; off += buffer.size())
+			write(dst + off, &buffer[0], std::min<uint32_t>(len - off, buffer.size()));
+	}
+
+	uint32_t _perform_memcmp(uint32_t src, uint32_t dst, uint32_t len) {
+		uint8_t *s = dmi_ptr(src, len);
+		uint8_t *d = dmi_ptr(dst, len);
+		if (s && d) {
+			bytes += 2 * (uint64_t)len;
+			int ans = memcmp(s, d, len);
+			return (ans > 0) - (ans < 0);
+		}
+
+		for (uint32_t off = 0; off < len; off += buffer.size()) {
+			uint32_t n = std::min<uint32_t>(len - off, buffer.size());
+			read(src + off, &buffer[0], n);
+			read(dst + off, &buffer2[0], n);
+			bytes += 2 * n;
 
-			switch (op) {
-				case OP_NOP:
-					break;
+			int ans = memcmp(&buffer[0], &buffer2[0], n);
+			if (ans)
+				return (ans > 0) - (ans < 0);
+		}
+		return 0;
+	}
+
+	uint32_t _perform_memchr(uint32_t src, uint8_t value, uint32_t len) {
+		uint8_t *s = dmi_ptr(src, len);
+		if (s) {
+			auto p = (uint8_t *)memchr(s, value, len);
+			bytes += p ? p - s + 1 : len;
+			return p ? p - s : 0xffffffff;
+		}
+
+		for (uint32_t off = 0; off < len; off += buffer.size()) {
+			uint32_t n = std::min<uint32_t>(len - off, buffer.size());
+			read(src + off, &buffer[0], n);
+			bytes += n;
+
+			auto p = (uint8_t *)memchr(&buffer[0], value, n);
+			if (p)
+				return off + (p - &buffer[0]);
+		}
+		return 0xffffffff;
+	}
+
+	uint32_t execute(uint32_t op, uint32_t src, uint32_t dst, uint32_t len) {
+		switch (op) {
+			case OP_NOP:
+				return 0;
+
+			case OP_MEMCPY:
+			case OP_MEMMOVE:
+				_perform_memmove(src, dst, len);
+				return 0;
+
+			case OP_MEMSET:
+				_perform_memset(dst, src, len);
+				return 0;
 
-				case OP_MEMCPY:
-					_perform_memcpy();
-					break;
+			case OP_MEMCMP:
+				return _perform_memcmp(src, dst, len);
 
-				case OP_MEMSET:
-					assert(false && "not implemented");
-					break;
+			case OP_MEMCHR:
+				return _perform_memchr(src, dst, len);
+
+			default:
+				throw std::runtime_error("unknown operation requested by software");
+		}
+	}
+
+	void _perform_chain() {
+		for (uint32_t addr = desc; addr != 0;) {
+			Descriptor d;
+			read(addr, (uint8_t *)&d, sizeof(d));
+			bytes += sizeof(d);
+
+			if (d.op == OP_CHAIN)
+				throw std::runtime_error("nested DMA chain");
+			stat = execute(d.op, d.src, d.dst, d.len);
+			addr = d.next;
+		}
+	}
+
+	void run() {
+		while (true) {
+			sc_core::wait(run_event);
 
-				case OP_MEMCMP:
-					assert(false && "not implemented");
-					break;
+			// DMI accesses bypass the bus, hence respect its lock here
+			if (bus_lock)
+				bus_lock->wait_until_unlocked();
 
-				case OP_MEMCHR:
-					assert(false && "not implemented");
-					break;
+			bytes = 0;
+			bus_delay = sc_core::SC_ZERO_TIME;
 
-				case OP_MEMMOVE:
-					assert(false && "not implemented");
-					break;
+			if (op == OP_CHAIN)
+				_perform_chain();
+			else
+				stat = execute(op, src, dst, len);
 
-				default:
-					assert(false && "unknown operation requested by software");
-			}
+			// a single wait for the whole operation
+			sc_core::wait(setup_delay + byte_delay * (double)bytes + bus_delay);
 
 			plic->gateway_trigger_interrupt(irq_number);
 		}
@@ -135,7 +289,7 @@ struct SimpleDMA : public sc_core::sc_module {
 
 		// post read/write actions
 		if ((cmd == tlm::TLM_WRITE_COMMAND) && (addr == OP_ADDR)) {
-			run_event.notify(sc_core::sc_time(10, sc_core::SC_NS));
+			run_event.notify(sc_core::SC_ZERO_TIME);
 		}
 
 		(void)delay;  // zero delay
@@ -152,8 +306,8 @@ struct SimpleDMA : public sc_core::sc_module {
 
 		isock->b_transport(trans, delay);
 
-		if (delay != sc_core::SC_ZERO_TIME)
-			sc_core::wait(delay);
+		// accumulated, waited for once the operation completed
+		bus_delay += delay;
 	}
 };
 
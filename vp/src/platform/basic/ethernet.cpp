@@ -15,11 +15,16 @@
 //#include <linux/if_ether.h>
 #include <fcntl.h>
 #include <linux/if_tun.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 
 #include <ifaddrs.h>
 #include <netdb.h>
 
+#include <system_error>
+
+#include "platform/common/io_reactor.h"
+
 using namespace std;
 
 static const char IF_NAME[] = "tap0";
@@ -176,10 +181,16 @@ printHex:
 	cout.flags(f);
 }
 
-EthernetDevice::EthernetDevice(sc_core::sc_module_name, uint32_t irq_number, uint8_t *mem, std::string clonedev)
-    : irq_number(irq_number), mem(mem) {
+EthernetDevice::EthernetDevice(sc_core::sc_module_name, uint32_t irq_number, MemoryDMI dmi, std::string clonedev)
+    : irq_number(irq_number), dmi(dmi) {
 	tsock.register_b_transport(this, &EthernetDevice::transport);
-	SC_THREAD(run);
+	SC_METHOD(receive);
+	sensitive << rx_ready_event << rx_retry_event;
+	dont_initialize();
+
+	SC_METHOD(irq_timeout);
+	sensitive << irq_timeout_event;
+	dont_initialize();
 
 	router
 	    .add_register_bank({
@@ -190,6 +201,19 @@ EthernetDevice::EthernetDevice(sc_core::sc_module_name, uint32_t irq_number, uin
 	        {SEND_SIZE_REG_ADDR, &send_size},
 	        {MAC_HIGH_REG_ADDR, &mac[0]},
 	        {MAC_LOW_REG_ADDR, &mac[1]},
+	        {CTRL_REG_ADDR, &ctrl},
+	        {RX_RING_BASE_REG_ADDR, &rx_ring_base},
+	        {RX_RING_SIZE_REG_ADDR, &rx_ring_size},
+	        {RX_HEAD_REG_ADDR, &rx_head, vp::map::read_only},
+	        {RX_TAIL_REG_ADDR, &rx_tail},
+	        {TX_RING_BASE_REG_ADDR, &tx_ring_base},
+	        {TX_RING_SIZE_REG_ADDR, &tx_ring_size},
+	        {TX_HEAD_REG_ADDR, &tx_head, vp::map::read_only},
+	        {TX_TAIL_REG_ADDR, &tx_tail},
+	        {IRQ_STATUS_REG_ADDR, &irq_status},
+	        {IRQ_ENABLE_REG_ADDR, &irq_enable},
+	        {COALESCE_FRAMES_REG_ADDR, &coalesce_frames},
+	        {COALESCE_USECS_REG_ADDR, &coalesce_usecs},
 	    })
 	    .register_handler(this, &EthernetDevice::register_access_callback);
 
@@ -197,6 +221,9 @@ EthernetDevice::EthernetDevice(sc_core::sc_module_name, uint32_t irq_number, uin
 
 	if (!disabled) {
 		init_network(clonedev);
+
+		IOReactor::get().add(sockfd, EPOLLIN,
+		                     std::bind(&EthernetDevice::recv_raw_frames, this, std::placeholders::_1));
 	}
 }
 
@@ -236,9 +263,164 @@ void EthernetDevice::init_network(std::string clonedev) {
 	fcntl(sockfd, F_SETFL, O_NONBLOCK);
 }
 
+uint8_t *EthernetDevice::guest_ptr(uint32_t addr, uint32_t len) {
+	if (!dmi.contains(addr) || (len > 0 && !dmi.contains((uint64_t)addr + len - 1)))
+		throw runtime_error("ethernet: DMA access outside of memory");
+	return dmi.get_mem_ptr_to_global_addr<uint8_t>(addr);
+}
+
+void EthernetDevice::register_access_callback(const vp::map::register_access_t &r) {
+	assert(!disabled && "Tried accessing disabled network device");
+
+	if (r.write && r.vptr == &irq_status) {
+		irq_status &= ~r.nv;
+		return;
+	}
+
+	uint32_t old_ctrl = ctrl;
+	r.fn();
+
+	if (!r.write)
+		return;
+
+	if (r.vptr == &status) {
+		if (r.nv == RECV_OPERATION) {
+			assert(has_frame);
+			memcpy(guest_ptr(receive_dst, receive_size), recv_frame_buf, receive_size);
+			has_frame = false;
+			receive_size = 0;
+			rx_retry_event.notify(sc_core::SC_ZERO_TIME);
+		} else if (r.nv == SEND_OPERATION) {
+			send_raw_frame();
+		} else {
+			throw std::runtime_error("unsupported operation");
+		}
+	} else if (r.vptr == &ctrl) {
+		// enabling a ring starts at its first descriptor
+		if ((ctrl & ~old_ctrl) & CTRL_RX_ENABLE)
+			rx_head = rx_tail = 0;
+		if ((ctrl & ~old_ctrl) & CTRL_TX_ENABLE)
+			tx_head = tx_tail = 0;
+		rx_retry_event.notify(sc_core::SC_ZERO_TIME);
+	} else if (r.vptr == &rx_tail) {
+		rx_retry_event.notify(sc_core::SC_ZERO_TIME);
+	} else if (r.vptr == &tx_tail) {
+		transmit_ring();
+	} else if (r.vptr == &irq_enable) {
+		if (irq_status & irq_enable)
+			plic->gateway_trigger_interrupt(irq_number);
+	}
+}
+
+void EthernetDevice::signal_completion(uint32_t cause, uint32_t frames) {
+	irq_pending |= cause;
+	irq_pending_frames += frames;
+
+	if (irq_pending_frames >= coalesce_frames) {
+		raise_interrupt();
+	} else if (coalesce_usecs && !irq_timer_armed) {
+		irq_timer_armed = true;
+		irq_timeout_event.notify(sc_core::sc_time(coalesce_usecs, sc_core::SC_US));
+	}
+}
+
+void EthernetDevice::raise_interrupt() {
+	irq_status |= irq_pending;
+	irq_pending = 0;
+	irq_pending_frames = 0;
+
+	if (irq_timer_armed) {
+		irq_timeout_event.cancel();
+		irq_timer_armed = false;
+	}
+
+	if (irq_status & irq_enable)
+		plic->gateway_trigger_interrupt(irq_number);
+}
+
+void EthernetDevice::irq_timeout() {
+	irq_timer_armed = false;
+	if (irq_pending)
+		raise_interrupt();
+}
+
+void EthernetDevice::transmit_ring() {
+	if (!(ctrl & CTRL_TX_ENABLE) || tx_ring_size == 0)
+		return;
+
+	uint8_t padded[60];
+	uint32_t frames = 0;
+
+	while (tx_head != tx_tail && tx_head < tx_ring_size) {
+		uint8_t *p = guest_ptr(tx_ring_base + tx_head * sizeof(Descriptor), sizeof(Descriptor));
+		Descriptor desc;
+		memcpy(&desc, p, sizeof(desc));
+
+		desc.flags = DESC_DONE;
+		if (desc.len > FRAME_SIZE) {
+			desc.flags |= DESC_ERROR;
+		} else {
+			// send straight from guest memory, only short frames are copied
+			uint8_t *frame = guest_ptr(desc.addr, desc.len);
+			size_t size = desc.len;
+			if (size < sizeof(padded)) {
+				memcpy(padded, frame, size);
+				memset(&padded[size], 0, sizeof(padded) - size);
+				frame = padded;
+				size = sizeof(padded);
+			}
+
+			ssize_t ans = write(sockfd, frame, size);
+			if (ans == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+				throw system_error(errno, generic_category());
+			if (ans != (ssize_t)size)
+				desc.flags |= DESC_ERROR;
+		}
+
+		memcpy(p, &desc, sizeof(desc));
+		tx_head = (tx_head + 1) % tx_ring_size;
+		frames++;
+	}
+
+	if (frames)
+		signal_completion(IRQ_TX, frames);
+}
+
+void EthernetDevice::receive_ring() {
+	if (rx_ring_size == 0)
+		return;
+
+	uint32_t frames = 0;
+	Frame *frame;
+
+	while (rx_head != rx_tail && rx_head < rx_ring_size && (frame = rx_queue.front())) {
+		uint8_t *p = guest_ptr(rx_ring_base + rx_head * sizeof(Descriptor), sizeof(Descriptor));
+		Descriptor desc;
+		memcpy(&desc, p, sizeof(desc));
+
+		desc.flags = DESC_DONE;
+		if (frame->size > desc.len)
+			desc.flags |= DESC_ERROR;
+		else
+			desc.len = frame->size;
+		memcpy(guest_ptr(desc.addr, desc.len), frame->data, desc.len);
+
+		memcpy(p, &desc, sizeof(desc));
+		rx_head = (rx_head + 1) % rx_ring_size;
+		rx_queue.release();
+		frames++;
+	}
+
+	if (frames) {
+		if (rx_stalled)
+			IOReactor::get().wakeup(sockfd);
+		signal_completion(IRQ_RX, frames);
+	}
+}
+
 void EthernetDevice::send_raw_frame() {
 	uint8_t sendbuf[send_size < 60 ? 60 : send_size];
-	memcpy(sendbuf, &mem[send_src - 0x80000000], send_size);
+	memcpy(sendbuf, guest_ptr(send_src, send_size), send_size);
 	if (send_size < 60) {
 		memset(&sendbuf[send_size], 0, 60 - send_size);
 		send_size = 60;
@@ -308,33 +490,81 @@ bool EthernetDevice::isPacketForUs(uint8_t *packet, ssize_t) {
 	return true;
 }
 
-bool EthernetDevice::try_recv_raw_frame() {
-	ssize_t ans;
-
-	ans = read(sockfd, recv_frame_buf, FRAME_SIZE);
-	assert(ans <= FRAME_SIZE);
-	if (ans == 0) {
-		cerr << "[ethernet] recv socket received zero bytes ... connection "
-		        "closed?"
-		     << endl;
-		throw runtime_error("read failed");
-	} else if (ans == -1) {
-		if (errno == EWOULDBLOCK || errno == EAGAIN) {
-			return true;
-		} else
-			throw runtime_error("recvfrom failed");
+void EthernetDevice::recv_raw_frames(uint32_t) {
+	bool queued = false;
+
+	// called on the reactor thread, read until the socket is drained
+	for (;;) {
+		Frame *frame = rx_queue.reserve();
+		if (!frame) {
+			if (rx_stalled)
+				break;
+
+			// stop polling until the SystemC side consumed a frame, check
+			// the queue once more to not miss a concurrent release
+			rx_stalled = true;
+			IOReactor::get().modify(sockfd, 0);
+			continue;
+		}
+		if (rx_stalled) {
+			rx_stalled = false;
+			IOReactor::get().modify(sockfd, EPOLLIN);
+		}
+
+		ssize_t ans = read(sockfd, frame->data, FRAME_SIZE);
+		assert(ans <= FRAME_SIZE);
+		if (ans == 0) {
+			cerr << "[ethernet] recv socket received zero bytes ... connection "
+			        "closed?"
+			     << endl;
+			throw runtime_error("read failed");
+		} else if (ans == -1) {
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				break;
+			else
+				throw runtime_error("recvfrom failed");
+		}
+		assert(ETH_ALEN == 6);
+
+		if (!isPacketForUs(frame->data, ans))
+			continue;
+
+		frame->size = ans;
+		rx_queue.commit();
+		queued = true;
 	}
-	assert(ETH_ALEN == 6);
 
-	if (!isPacketForUs(recv_frame_buf, ans)) {
-		return false;
+	if (queued)
+		rx_ready_event.notify();
+}
+
+void EthernetDevice::receive() {
+	if (disabled)
+		return;
+
+	if (ctrl & CTRL_RX_ENABLE) {
+		receive_ring();
+		return;
 	}
 
+	if (has_frame)
+		return;  // re-triggered by rx_retry_event once the guest consumed the frame
+
+	Frame *frame = rx_queue.front();
+	if (!frame)
+		return;
+
+	memcpy(recv_frame_buf, frame->data, frame->size);
+	receive_size = frame->size;
+	rx_queue.release();
 	has_frame = true;
-	receive_size = ans;
+
+	if (rx_stalled)
+		IOReactor::get().wakeup(sockfd);
+
 	cout << "RECEIVED FRAME <---<---<---<---<--- ";
-	dump_ethernet_frame(recv_frame_buf, ans);
+	dump_ethernet_frame(recv_frame_buf, receive_size);
 	cout << endl;
 
-	return true;
+	plic->gateway_trigger_interrupt(irq_number);
 }
@@ -2,6 +2,7 @@
 #define RISCV_VP_ETHERNET_H
 
 #include <unistd.h>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
@@ -14,7 +15,10 @@
 
 #include <tlm_utils/simple_target_socket.h>
 
+#include "core/common/dmi.h"
 #include "core/common/irq_if.h"
+#include "platform/common/async_event.h"
+#include "util/spsc_queue.h"
 #include "util/tlm_map.h"
 
 struct arp_eth_header {
@@ -29,12 +33,37 @@ struct arp_eth_header {
 	uint8_t target_ip[4];
 };
 
+/*
+ * Ethernet controller on a tap device. Frames are exchanged either one at a
+ * time through the RECEIVE_* and SEND_* registers, or with descriptor rings
+ * once enabled in the CTRL register:
+ *
+ *  - A ring is an array of RING_SIZE descriptors at RING_BASE in memory.
+ *    Descriptors from HEAD up to (excluding) TAIL are owned by the device,
+ *    the driver hands out descriptors by advancing TAIL. HEAD == TAIL means
+ *    that the device owns no descriptor, hence the driver leaves one unused.
+ *  - RX descriptors provide empty buffers, the device stores the received
+ *    frame and its length and sets DESC_DONE (and DESC_ERROR if the frame was
+ *    truncated). TX descriptors are sent when TX_TAIL is written.
+ *  - Completions set bits in IRQ_STATUS (write one to clear) and raise an
+ *    interrupt if enabled in IRQ_ENABLE. It is delayed until COALESCE_FRAMES
+ *    frames completed or COALESCE_USECS passed since the first completion.
+ *
+ * Received frames are queued by the IOReactor thread and copied to the guest
+ * buffers through DMI in batches.
+ */
 struct EthernetDevice : public sc_core::sc_module {
 	tlm_utils::simple_target_socket<EthernetDevice> tsock;
 
 	interrupt_gateway *plic = 0;
 	uint32_t irq_number = 0;
-	sc_core::sc_event run_event;
+
+	// signalled by the IOReactor once it queued received frames
+	AsyncEvent rx_ready_event;
+	// signalled after the guest consumed a frame, more may be queued
+	sc_core::sc_event rx_retry_event;
+	// raises a delayed interrupt, see COALESCE_USECS
+	sc_core::sc_event irq_timeout_event;
 
 	// memory mapped configuration registers
 	uint32_t status = 0;
@@ -43,11 +72,29 @@ struct EthernetDevice : public sc_core::sc_module {
 	uint32_t send_src = 0;
 	uint32_t send_size = 0;
 	uint32_t mac[2];
+	uint32_t ctrl = 0;
+	uint32_t rx_ring_base = 0;
+	uint32_t rx_ring_size = 0;
+	uint32_t rx_head = 0;
+	uint32_t rx_tail = 0;
+	uint32_t tx_ring_base = 0;
+	uint32_t tx_ring_size = 0;
+	uint32_t tx_head = 0;
+	uint32_t tx_tail = 0;
+	uint32_t irq_status = 0;
+	uint32_t irq_enable = 0;
+	uint32_t coalesce_frames = 0;
+	uint32_t coalesce_usecs = 0;
+
+	// completions not yet signalled because of interrupt coalescing
+	uint32_t irq_pending = 0;
+	uint32_t irq_pending_frames = 0;
+	bool irq_timer_armed = false;
 
 	uint8_t *VIRTUAL_MAC_ADDRESS = reinterpret_cast<uint8_t *>(mac);
 	uint8_t BROADCAST_MAC_ADDRESS[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
 
-	uint8_t *mem = nullptr;
+	MemoryDMI dmi;
 
 	vp::map::LocalRouter router;
 
@@ -57,8 +104,17 @@ struct EthernetDevice : public sc_core::sc_module {
 	static const uint16_t MTU_SIZE = 1500;
 	static const uint16_t FRAME_SIZE = MTU_SIZE + 14;
 
+	struct Frame {
+		uint16_t size;
+		uint8_t data[FRAME_SIZE];
+	};
+
+	// frames read by the IOReactor thread, consumed by the SystemC thread
+	SPSCQueue<Frame, 256> rx_queue;
+	std::atomic<bool> rx_stalled{false};
+
 	uint8_t recv_frame_buf[FRAME_SIZE];
-	bool has_frame;
+	bool has_frame = false;
 	bool disabled;
 
 	static const uint16_t STATUS_REG_ADDR = 0x00;
@@ -68,62 +124,71 @@ struct EthernetDevice : public sc_core::sc_module {
 	static const uint16_t SEND_SIZE_REG_ADDR = SEND_SRC_REG_ADDR + sizeof(uint32_t);
 	static const uint16_t MAC_HIGH_REG_ADDR = SEND_SIZE_REG_ADDR + sizeof(uint32_t);
 	static const uint16_t MAC_LOW_REG_ADDR = MAC_HIGH_REG_ADDR + sizeof(uint32_t);
+	static const uint16_t CTRL_REG_ADDR = 0x20;
+	static const uint16_t RX_RING_BASE_REG_ADDR = 0x24;
+	static const uint16_t RX_RING_SIZE_REG_ADDR = 0x28;
+	static const uint16_t RX_HEAD_REG_ADDR = 0x2c;
+	static const uint16_t RX_TAIL_REG_ADDR = 0x30;
+	static const uint16_t TX_RING_BASE_REG_ADDR = 0x34;
+	static const uint16_t TX_RING_SIZE_REG_ADDR = 0x38;
+	static const uint16_t TX_HEAD_REG_ADDR = 0x3c;
+	static const uint16_t TX_TAIL_REG_ADDR = 0x40;
+	static const uint16_t IRQ_STATUS_REG_ADDR = 0x44;
+	static const uint16_t IRQ_ENABLE_REG_ADDR = 0x48;
+	static const uint16_t COALESCE_FRAMES_REG_ADDR = 0x4c;
+	static const uint16_t COALESCE_USECS_REG_ADDR = 0x50;
 
 	enum : uint16_t {
 		RECV_OPERATION = 1,
 		SEND_OPERATION = 2,
 	};
 
+	enum : uint32_t {
+		CTRL_RX_ENABLE = 1,
+		CTRL_TX_ENABLE = 2,
+	};
+
+	enum : uint32_t {
+		IRQ_RX = 1,
+		IRQ_TX = 2,
+	};
+
+	struct Descriptor {
+		uint32_t addr;
+		uint16_t len;
+		uint16_t flags;
+	};
+
+	enum : uint16_t {
+		DESC_DONE = 1,
+		DESC_ERROR = 2,
+	};
+
 	SC_HAS_PROCESS(EthernetDevice);
 
-	EthernetDevice(sc_core::sc_module_name, uint32_t irq_number, uint8_t *mem, std::string clonedev);
+	EthernetDevice(sc_core::sc_module_name, uint32_t irq_number, MemoryDMI dmi, std::string clonedev);
 
 	void init_network(std::string clonedev);
 	void add_all_if_ips();
 
 	void send_raw_frame();
-	bool try_recv_raw_frame();
+	void recv_raw_frames(uint32_t events);
 	bool isPacketForUs(uint8_t *packet, ssize_t size);
 
-	void register_access_callback(const vp::map::register_access_t &r) {
-		assert(mem);
-		assert(!disabled && "Tried accessing disabled network device");
-
-		r.fn();
-
-		if (r.write && r.vptr == &status) {
-			if (r.nv == RECV_OPERATION) {
-				assert(has_frame);
-				memcpy(&mem[receive_dst - 0x80000000], recv_frame_buf, receive_size);
-				has_frame = false;
-				receive_size = 0;
-			} else if (r.nv == SEND_OPERATION) {
-				send_raw_frame();
-			} else {
-				throw std::runtime_error("unsupported operation");
-			}
-		}
-	}
+	void receive();
+	void receive_ring();
+	void transmit_ring();
+
+	uint8_t *guest_ptr(uint32_t addr, uint32_t len);
+	void signal_completion(uint32_t cause, uint32_t frames);
+	void raise_interrupt();
+	void irq_timeout();
+
+	void register_access_callback(const vp::map::register_access_t &r);
 
 	void transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay) {
 		router.transport(trans, delay);
 	}
-
-	void run() {
-		while (!disabled) {
-			run_event.notify(sc_core::sc_time(10000, sc_core::SC_US));
-			sc_core::wait(run_event);  // 10000 times per second by default
-
-			// check if data is available on the socket, if yes store it in an
-			// internal buffer
-			if (!has_frame) {
-				while (!try_recv_raw_frame())
-					;
-				if (has_frame)
-					plic->gateway_trigger_interrupt(irq_number);
-			}
-		}
-	}
 };
 
 #endif  // RISCV_VP_ETHERNET_H
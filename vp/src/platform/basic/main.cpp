@@ -19,6 +19,7 @@
 #include "syscall.h"
 #include "terminal.h"
 #include "util/options.h"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -123,11 +124,11 @@ int sc_main(int argc, char **argv) {
 	SimpleMRAM mram("SimpleMRAM", opt.mram_image, opt.mram_size);
 	SimpleDMA dma("SimpleDMA", 4);
 	Flashcontroller flashController("Flashcontroller", opt.flash_device);
-	EthernetDevice ethernet("EthernetDevice", 7, mem.data, opt.network_device);
-	Display display("Display");
+	Display display("Display", 8);
 	DebugMemoryInterface dbg_if("DebugMemoryInterface");
 
 	MemoryDMI dmi = MemoryDMI::create_start_size_mapping(mem.data, opt.mem_start_addr, mem.size);
+	EthernetDevice ethernet("EthernetDevice", 7, dmi, opt.network_device);
 	InstrMemoryProxy instr_mem(dmi, core);
 
 	std::shared_ptr<BusLock> bus_lock = std::make_shared<BusLock>();
@@ -175,6 +176,16 @@ int sc_main(int argc, char **argv) {
 	dma_connector.isock.bind(bus.tsocks[1]);
 	dma.isock.bind(dma_connector.tsock);
 	dma_connector.bus_lock = bus_lock;
+	dma.bus_lock = bus_lock;
+	dma.dmi_ranges.emplace_back(dmi);
+
+	// the frame buffers of the display are plain memory as well
+	MemoryDMI display_dmi = display.getFramesDMI(opt.display_start_addr);
+	dma.dmi_ranges.emplace_back(display_dmi);
+	display.dmi_ranges.emplace_back(dmi);
+	display.dmi_ranges.emplace_back(display_dmi);
+	if (opt.use_data_dmi)
+		iss_mem_if.dmi_ranges.emplace_back(display_dmi);
 
 	bus.isocks[0].bind(mem.tsock);
 	bus.isocks[1].bind(clint.tsock);
@@ -197,11 +208,18 @@ int sc_main(int argc, char **argv) {
 	timer.plic = &plic;
 	sensor2.plic = &plic;
 	ethernet.plic = &plic;
+	display.plic = &plic;
 
 	std::vector<debug_target_if *> threads;
 	threads.push_back(&core);
 
 	core.trace = opt.trace_mode;  // switch for printing instructions
+
+	Instrumentation instrumentation(opt, RV32);
+	instrumentation.add_plic(plic, 64, 1, core.cycle_time);
+	instrumentation.add_hart(core);
+	instrumentation.add_bus(bus);
+
 	if (opt.use_debug_runner) {
 		auto server = new GDBServer("GDBServer", threads, &dbg_if, opt.debug_port);
 		new GDBServerRunner("GDBRunner", server, &core);
@@ -209,10 +227,14 @@ int sc_main(int argc, char **argv) {
 		new DirectCoreRunner(core);
 	}
 
+	instrumentation.start();
+
 	sc_core::sc_start();
 
 	core.show();
 
+	instrumentation.report();
+
 	if (opt.test_signature != "") {
 		auto begin_sig = loader.get_begin_signature_address();
 		auto end_sig = loader.get_end_signature_address();
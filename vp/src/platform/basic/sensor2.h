@@ -19,8 +19,10 @@ struct SimpleSensor2 : public sc_core::sc_module {
 	uint32_t irq_number = 0;
 	sc_core::sc_event run_event;
 
-	// memory mapped data frame
-	std::array<uint8_t, 64> data_frame;
+	// memory mapped data frame, regenerated lazily once per period on read
+	std::array<uint8_t, 64> data_frame{};
+	sc_core::sc_time period_start = sc_core::SC_ZERO_TIME;
+	uint64_t generated_period = 0;
 
 	// memory mapped configuration registers
 	uint32_t scaler = 25;
@@ -37,7 +39,9 @@ struct SimpleSensor2 : public sc_core::sc_module {
 
 	SimpleSensor2(sc_core::sc_module_name, uint32_t irq_number) : irq_number(irq_number) {
 		tsock.register_b_transport(this, &SimpleSensor2::transport);
-		SC_THREAD(run);
+		SC_METHOD(run);
+		sensitive << run_event;
+		dont_initialize();
 
 		router
 		    .add_register_bank({
@@ -52,6 +56,7 @@ struct SimpleSensor2 : public sc_core::sc_module {
 
 	void data_frame_access_callback(tlm::tlm_generic_payload &trans, sc_core::sc_time) {
 		// return last generated random data at requested address
+		update_data_frame();
 		vp::map::execute_memory_access(trans, data_frame.data());
 	}
 
@@ -67,8 +72,10 @@ struct SimpleSensor2 : public sc_core::sc_module {
 
 		// trigger post read/write actions
 		if (r.write && (r.vptr == &scaler)) {
+			period_start = sc_core::sc_time_stamp();
+			generated_period = 0;
 			run_event.cancel();
-			run_event.notify(sc_core::sc_time(scaler, sc_core::SC_MS));
+			schedule();
 		}
 	}
 
@@ -76,25 +83,50 @@ struct SimpleSensor2 : public sc_core::sc_module {
 		router.transport(trans, delay);
 	}
 
-	void run() {
-		while (true) {
-			run_event.notify(sc_core::sc_time(scaler, sc_core::SC_MS));
-			sc_core::wait(run_event);  // 40 times per second by default
-
-			// fill with random data
-			for (auto &n : data_frame) {
-				if (filter == 1) {
-					n = rand() % 10 + 48;
-				} else if (filter == 2) {
-					n = rand() % 26 + 65;
-				} else {
-					// fallback for all other filter values
-					n = rand();  // random char
-				}
+	void start_of_simulation() {
+		plic->gateway_on_enable_change(irq_number, std::bind(&SimpleSensor2::schedule, this));
+		schedule();
+	}
+
+	uint64_t elapsed_periods() {
+		auto period = sc_core::sc_time(scaler, sc_core::SC_MS);
+		return (sc_core::sc_time_stamp() - period_start).value() / period.value();
+	}
+
+	void update_data_frame() {
+		auto current = elapsed_periods();
+		if (current == generated_period)
+			return;
+		generated_period = current;
+
+		// fill with random data
+		for (auto &n : data_frame) {
+			if (filter == 1) {
+				n = rand() % 10 + 48;
+			} else if (filter == 2) {
+				n = rand() % 26 + 65;
+			} else {
+				// fallback for all other filter values
+				n = rand();  // random char
 			}
+		}
+	}
 
-			plic->gateway_trigger_interrupt(irq_number);
+	void schedule() {
+		// only wake up the simulation while somebody listens for the interrupt
+		if (!plic->gateway_interrupt_enabled(irq_number)) {
+			run_event.cancel();
+			return;
 		}
+
+		auto period = sc_core::sc_time(scaler, sc_core::SC_MS);
+		auto next = period_start + period * (double)(elapsed_periods() + 1);
+		run_event.notify(next - sc_core::sc_time_stamp());  // 40 times per second by default
+	}
+
+	void run() {
+		plic->gateway_trigger_interrupt(irq_number);
+		schedule();
 	}
 };
 
@@ -1,20 +1,17 @@
 #include "abstract_uart.h"
+#include "io_reactor.h"
 
 #include <fcntl.h>
-#include <semaphore.h>
 #include <stdint.h>
 #include <stdlib.h>
-#include <mutex>
-#include <queue>
-#include <thread>
+#include <sys/epoll.h>
+
+#include <algorithm>
 
 #define UART_TXWM (1 << 0)
 #define UART_RXWM (1 << 1)
 #define UART_FULL (1 << 31)
 
-/* 8-entry transmit and receive FIFO buffers */
-#define UART_FIFO_DEPTH 8
-
 /* Extracts the interrupt trigger threshold from a control register */
 #define UART_CTRL_CNT(REG) ((REG) >> 16)
 
@@ -43,71 +40,48 @@ AbstractUART::AbstractUART(sc_core::sc_module_name, uint32_t irqsrc) {
 		{DIV_REG_ADDR, &div},
 	    })
 	    .register_handler(this, &AbstractUART::register_access_callback);
-
-	if (sem_init(&txfull, 0, 0))
-		throw std::system_error(errno, std::generic_category());
-	if (sem_init(&rxempty, 0, UART_FIFO_DEPTH))
-		throw std::system_error(errno, std::generic_category());
-
-	SC_METHOD(interrupt);
-	sensitive << asyncEvent;
-	dont_initialize();
 }
 
 AbstractUART::~AbstractUART(void) {
-	// TODO: kill threads
-	// TODO: destroy semaphore
+	if (iofd >= 0)
+		IOReactor::get().remove(iofd);
 }
 
-void AbstractUART::start_threads(void) {
-	rcvthr = std::thread(&AbstractUART::receive, this);
-	rcvthr.detach();
-
-	txthr = std::thread(&AbstractUART::transmit, this);
-	txthr.detach();
+void AbstractUART::start_io(int fd, bool input) {
+	iofd = fd;
+	rx_enabled = input;
+	IOReactor::get().add(fd, input ? EPOLLIN : 0, std::bind(&AbstractUART::handle_io, this, std::placeholders::_1));
 }
 
 void AbstractUART::rxpush(uint8_t data) {
-	swait(&rxempty);
-	rcvmtx.lock();
-	rx_fifo.push(data);
-	rcvmtx.unlock();
-	asyncEvent.notify();
+	rx_backlog.push_back(data);
 }
 
 void AbstractUART::register_access_callback(const vp::map::register_access_t &r) {
 	if (r.read) {
 		if (r.vptr == &txdata) {
-			txmtx.lock();
-			txdata = (tx_fifo.size() >= UART_FIFO_DEPTH) ? UART_FULL : 0;
-			txmtx.unlock();
+			txdata = tx_fifo.full() ? UART_FULL : 0;
 		} else if (r.vptr == &rxdata) {
-			rcvmtx.lock();
-			if (rx_fifo.empty()) {
-				rxdata = 1 << 31;
+			uint8_t data;
+			if (rx_fifo.pop(data)) {
+				rxdata = data;
+				if (rx_stalled)
+					IOReactor::get().wakeup(iofd);
 			} else {
-				rxdata = rx_fifo.front();
-				rx_fifo.pop();
-				spost(&rxempty);
+				rxdata = 1 << 31;
 			}
-
-			rcvmtx.unlock();
 		} else if (r.vptr == &txctrl) {
 			// std::cout << "TXctl";
 		} else if (r.vptr == &rxctrl) {
 			// std::cout << "RXctrl";
 		} else if (r.vptr == &ip) {
 			uint32_t ret = 0;
-			txmtx.lock();
-			if (tx_fifo.size() < UART_CTRL_CNT(txctrl)) {
+			if (tx_level() < UART_CTRL_CNT(txctrl)) {
 				ret |= UART_TXWM;
 			}
-			txmtx.unlock();
-			rcvmtx.lock();
 			if (rx_fifo.size() > UART_CTRL_CNT(rxctrl)) {
 				ret |= UART_RXWM;
 			}
-			rcvmtx.unlock();
 			ip = ret;
 		} else if (r.vptr == &ie) {
 			// do nothing
@@ -128,19 +102,25 @@ void AbstractUART::register_access_callback(const vp::map::register_access_t &r)
 
 	r.fn();
 
+	if (r.write) {
+		if (r.vptr == &ie)
+			ie_copy = ie;
+		else if (r.vptr == &txctrl)
+			txctrl_copy = txctrl;
+		else if (r.vptr == &rxctrl)
+			rxctrl_copy = rxctrl;
+	}
+
 	if (notify || (r.write && r.vptr == &ie))
-		asyncEvent.notify();
+		interrupt();
 
 	if (r.write && r.vptr == &txdata) {
-		txmtx.lock();
-		if (tx_fifo.size() >= UART_FIFO_DEPTH) {
-			txmtx.unlock();
+		if (!tx_fifo.push(txdata))
 			return; /* write is ignored */
-		}
 
-		tx_fifo.push(txdata);
-		txmtx.unlock();
-		spost(&txfull);
+		/* only wake up the reactor if it is not already draining the FIFO */
+		if (!tx_pending.exchange(true))
+			IOReactor::get().wakeup(iofd);
 	}
 }
 
@@ -148,58 +128,90 @@ void AbstractUART::transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &
 	router.transport(trans, delay);
 }
 
+void AbstractUART::handle_io(uint32_t events) {
+	transmit();
+	if (rx_enabled)
+		receive(events);
+}
+
+size_t AbstractUART::tx_level(void) {
+	return std::min(tx_fifo.size(), (size_t)UART_FIFO_DEPTH);
+}
+
 void AbstractUART::transmit(void) {
-	uint8_t data;
+	size_t n;
+	bool popped = false;
+
+	/* clear before draining, a concurrent push triggers another wake-up */
+	tx_pending.store(false);
+	while ((n = tx_fifo.pop(txbuf, sizeof(txbuf))) > 0) {
+		write_data(txbuf, n);
+		popped = true;
+	}
+
+	if (popped)
+		interrupt();
+}
 
-	for (;;) {
-		swait(&txfull);
-		txmtx.lock();
-		data = tx_fifo.front();
-		tx_fifo.pop();
-		txmtx.unlock();
+bool AbstractUART::drain_backlog(void) {
+	bool pushed = false;
 
-		asyncEvent.notify();
-		write_data(data);
+	while (!rx_backlog.empty() && rx_fifo.push(rx_backlog.front())) {
+		rx_backlog.pop_front();
+		pushed = true;
 	}
+
+	return pushed;
 }
 
-void AbstractUART::receive(void) {
-	for (;;) {
-		read_data();
+void AbstractUART::receive(uint32_t events) {
+	bool pushed = drain_backlog();
+
+	if (rx_backlog.empty() && !rx_eof && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+		if (!read_data())
+			rx_eof = true;
+		pushed |= drain_backlog();
 	}
+
+	/* Stop polling the input while the FIFO is full, the SystemC
+	 * side wakes us up again once it popped an element. Drain once
+	 * more after setting the flag to not miss a concurrent pop. */
+	bool want_input = rx_backlog.empty() && !rx_eof;
+	if (!want_input && !rx_stalled) {
+		rx_stalled = true;
+		IOReactor::get().modify(iofd, 0);
+
+		pushed |= drain_backlog();
+		want_input = rx_backlog.empty() && !rx_eof;
+	}
+	if (want_input && rx_stalled) {
+		rx_stalled = false;
+		IOReactor::get().modify(iofd, EPOLLIN);
+	}
+
+	if (pushed)
+		interrupt();
 }
 
 void AbstractUART::interrupt(void) {
 	bool trigger = false;
 
-	/* XXX: Possible optimization would be to trigger the
-	 * interrupt from the background thread. However,
-	 * the PLIC methods are very likely not thread safe. */
+	/* Called from both the SystemC and the reactor thread, the
+	 * interrupt gateway of the PLIC is thread-safe. The registers
+	 * are written by the SystemC thread, hence only their atomic
+	 * copies are read here. */
+	uint32_t enabled = ie_copy;
 
-	if (ie & UART_RXWM) {
-		rcvmtx.lock();
-		if (rx_fifo.size() > UART_CTRL_CNT(rxctrl))
+	if (enabled & UART_RXWM) {
+		if (rx_fifo.size() > UART_CTRL_CNT(rxctrl_copy.load()))
 			trigger = true;
-		rcvmtx.unlock();
 	}
 
-	if (ie & UART_TXWM) {
-		txmtx.lock();
-		if (tx_fifo.size() < UART_CTRL_CNT(txctrl))
+	if (enabled & UART_TXWM) {
+		if (tx_level() < UART_CTRL_CNT(txctrl_copy.load()))
 			trigger = true;
-		txmtx.unlock();
 	}
 
 	if (trigger)
 		plic->gateway_trigger_interrupt(irq);
 }
-
-void AbstractUART::swait(sem_t *sem) {
-	if (sem_wait(sem))
-		throw std::system_error(errno, std::generic_category());
-}
-
-void AbstractUART::spost(sem_t *sem) {
-	if (sem_post(sem))
-		throw std::system_error(errno, std::generic_category());
-}
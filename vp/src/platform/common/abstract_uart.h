@@ -2,18 +2,22 @@
 #define RISCV_VP_ABSTRACT_UART_H
 
 #include <stdint.h>
-#include <semaphore.h>
 
 #include <systemc>
 #include <tlm_utils/simple_target_socket.h>
 
-#include <thread>
-#include <mutex>
-#include <queue>
+#include <atomic>
+#include <deque>
 
 #include "core/common/irq_if.h"
 #include "util/tlm_map.h"
-#include "platform/common/async_event.h"
+#include "util/spsc_queue.h"
+
+/* 8-entry transmit and receive FIFO buffers */
+#define UART_FIFO_DEPTH 8
+/* Transmitted bytes are buffered on the host side and handed to
+ * write_data() in batches of up to one page. */
+#define UART_TX_BUFSIZE 4096
 
 class AbstractUART : public sc_core::sc_module {
 public:
@@ -26,21 +30,29 @@ public:
 	SC_HAS_PROCESS(AbstractUART);
 
 protected:
-	void start_threads(void);
+	/* Registers the host file descriptor used for input with the
+	 * IOReactor. read_data() is invoked on the reactor thread
+	 * whenever it becomes readable, write_data() is invoked on the
+	 * reactor thread with all bytes transmitted in the meantime.
+	 * Without input, the file descriptor is only registered for the
+	 * transmit wake-ups and read_data() is never invoked. Either way
+	 * it must be called, otherwise transmitted bytes are lost. */
+	void start_io(int, bool input = true);
 	void rxpush(uint8_t);
 
 private:
-	virtual void write_data(uint8_t) = 0;
-	virtual void read_data(void) = 0;
+	virtual void write_data(const uint8_t *, size_t) = 0;
+	/* must not block, returns false once no further input is available */
+	virtual bool read_data(void) = 0;
 
 	void register_access_callback(const vp::map::register_access_t &);
 	void transport(tlm::tlm_generic_payload &, sc_core::sc_time &);
+	void handle_io(uint32_t);
 	void transmit(void);
-	void receive(void);
+	void receive(uint32_t);
+	bool drain_backlog(void);
 	void interrupt(void);
-
-	void swait(sem_t *);
-	void spost(sem_t *);
+	size_t tx_level(void);
 
 	uint32_t irq;
 
@@ -53,14 +65,28 @@ private:
 	uint32_t ip = 0;
 	uint32_t div = 0;
 
-	std::thread rcvthr, txthr;
-	std::mutex rcvmtx, txmtx;
-	AsyncEvent asyncEvent;
-
-	std::queue<uint8_t> tx_fifo;
-	sem_t txfull;
-	std::queue<uint8_t> rx_fifo;
-	sem_t rxempty;
+	/* copies of the registers read by interrupt() on the reactor thread,
+	 * updated by the SystemC thread after every write */
+	std::atomic<uint32_t> ie_copy{0};
+	std::atomic<uint32_t> txctrl_copy{0};
+	std::atomic<uint32_t> rxctrl_copy{0};
+
+	int iofd = -1;
+	bool rx_enabled = false;
+
+	/* producer: SystemC thread, consumer: reactor thread. Extends the
+	 * transmit FIFO, the FIFO level seen by software is capped at
+	 * UART_FIFO_DEPTH but it is only full if the host lags behind. */
+	SPSCQueue<uint8_t, UART_TX_BUFSIZE> tx_fifo;
+	std::atomic<bool> tx_pending{false};
+	uint8_t txbuf[UART_TX_BUFSIZE];
+
+	/* producer: reactor thread, consumer: SystemC thread */
+	SPSCQueue<uint8_t, UART_FIFO_DEPTH> rx_fifo;
+	/* input which did not fit into rx_fifo, only accessed by the reactor */
+	std::deque<uint8_t> rx_backlog;
+	std::atomic<bool> rx_stalled{false};
+	bool rx_eof = false;
 
 	vp::map::LocalRouter router = {"UART"};
 };
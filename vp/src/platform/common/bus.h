@@ -8,6 +8,8 @@
 #include <tlm_utils/simple_target_socket.h>
 #include <systemc>
 
+#include "core/common/stats.h"
+
 struct PortMapping {
 	uint64_t start;
 	uint64_t end;
@@ -31,6 +33,9 @@ struct SimpleBus : sc_core::sc_module {
 
 	std::array<tlm_utils::simple_initiator_socket<SimpleBus>, NR_OF_TARGETS> isocks;
 	std::array<PortMapping *, NR_OF_TARGETS> ports;
+	// per target, see Stats::add_bus
+	std::array<Counter, NR_OF_TARGETS> transactions;
+	std::array<Counter, NR_OF_TARGETS> bytes;
 
 	SimpleBus(sc_core::sc_module_name) {
 		for (auto &s : tsocks) {
@@ -56,6 +61,8 @@ struct SimpleBus : sc_core::sc_module {
 			return;
 		}
 
+		++transactions[id];
+		bytes[id] += trans.get_data_length();
 		trans.set_address(ports[id]->global_to_local(addr));
 		isocks[id]->b_transport(trans, delay);
 	}
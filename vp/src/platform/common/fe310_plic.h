@@ -3,7 +3,11 @@
 #include <tlm_utils/simple_target_socket.h>
 #include <systemc>
 
+#include <atomic>
+
 #include "core/common/irq_if.h"
+#include "core/common/irq_latency.h"
+#include "platform/common/async_event.h"
 #include "util/memory_map.h"
 #include "util/tlm_map.h"
 
@@ -17,6 +21,10 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 	static_assert(NumberInterrupts <= 4096, "out of bound");
 	static_assert(NumberCores <= 15360, "out of bound");
 
+	// number of 32 bit words covering all interrupt sources
+	static constexpr unsigned NumberInterruptWords = (NumberInterrupts + 31) / 32;
+	static_assert(NumberInterruptWords <= NumberInterruptEntries, "out of bound");
+
 	tlm_utils::simple_target_socket<FE310_PLIC> tsock;
 
 	std::array<external_interrupt_target *, NumberCores> target_harts{};
@@ -27,8 +35,10 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 	RegisterRange regs_interrupt_priorities{0x0, 4 * (NumberInterrupts + 1)};
 	ArrayView<uint32_t> interrupt_priorities{regs_interrupt_priorities};
 
+	// the register only mirrors the atomic pending bitmap, which may be updated from any host thread
 	RegisterRange regs_pending_interrupts{0x1000, 4 * NumberInterruptEntries};
-	ArrayView<uint32_t> pending_interrupts{regs_pending_interrupts};
+	ArrayView<uint32_t> pending_interrupts_view{regs_pending_interrupts};
+	std::array<std::atomic<uint32_t>, NumberInterruptEntries> pending_interrupts{};
 
 	struct HartConfig {
 		uint32_t priority_threshold;
@@ -47,7 +57,13 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 	PrivilegeLevel irq_level;
 	std::array<bool, NumberCores> hart_eip{};
 
-	sc_core::sc_event e_run;
+	IrqLatency *latency = nullptr;  // optional, interrupt latency
+
+	std::vector<std::pair<uint32_t, std::function<void()>>> enable_listeners;
+
+	// coalesces all interrupts triggered within one delta cycle into a single wake-up
+	AsyncEvent e_run;
+	std::atomic<bool> run_pending{false};
 	sc_core::sc_time clock_cycle;
 
 	SC_HAS_PROCESS(FE310_PLIC);
@@ -57,10 +73,14 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 		tsock.register_b_transport(this, &FE310_PLIC::transport);
 
 		regs_pending_interrupts.readonly = true;
+		regs_pending_interrupts.pre_read_callback =
+		    std::bind(&FE310_PLIC::pre_read_pending_interrupts, this, std::placeholders::_1);
 		regs_hart_config.alignment = 4;
 
 		regs_interrupt_priorities.post_write_callback =
 		    std::bind(&FE310_PLIC::post_write_interrupt_priorities, this, std::placeholders::_1);
+		regs_hart_enabled_interrupts.post_write_callback =
+		    std::bind(&FE310_PLIC::post_write_hart_enabled_interrupts, this, std::placeholders::_1);
 		regs_hart_config.post_write_callback = std::bind(&FE310_PLIC::post_write_hart_config, this, std::placeholders::_1);
 		regs_hart_config.pre_read_callback = std::bind(&FE310_PLIC::pre_read_hart_config, this, std::placeholders::_1);
 
@@ -80,6 +100,8 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 		SC_THREAD(run);
 	}
 
+	/* Thread-safe, may be called from the SystemC thread as well as from
+	 * host I/O threads. */
 	void gateway_trigger_interrupt(uint32_t irq_id) {
 		// NOTE: can use different techniques for each gateway, in this case a
 		// simple non queued edge trigger
@@ -89,9 +111,32 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 		unsigned idx = irq_id / 32;
 		unsigned off = irq_id % 32;
 
-		pending_interrupts[idx] |= 1 << off;
+		// from host threads the kernel time is read without synchronization, hence only approximate
+		if (latency)
+			latency->trigger(irq_id, sc_core::sc_time_stamp());
+
+		pending_interrupts[idx].fetch_or(1 << off);
+
+		if (!run_pending.exchange(true))
+			e_run.notify(clock_cycle);
+	}
+
+	bool gateway_interrupt_enabled(uint32_t irq_id) {
+		assert(irq_id > 0 && irq_id < NumberInterrupts);
+
+		unsigned idx = irq_id / 32;
+		unsigned off = irq_id % 32;
 
-		e_run.notify(clock_cycle);
+		for (unsigned n = 0; n < NumberCores; ++n) {
+			if (hart_enabled_interrupts(n, idx) & (1 << off))
+				return true;
+		}
+		return false;
+	}
+
+	void gateway_on_enable_change(uint32_t irq_id, std::function<void()> callback) {
+		assert(irq_id > 0 && irq_id < NumberInterrupts);
+		enable_listeners.push_back({irq_id, callback});
 	}
 
 	void clear_pending_interrupt(unsigned irq_id) {
@@ -102,26 +147,34 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 		unsigned idx = irq_id / 32;
 		unsigned off = irq_id % 32;
 
-		pending_interrupts[idx] &= ~(1 << off);
+		pending_interrupts[idx].fetch_and(~(1 << off));
+	}
+
+	// mask of the valid interrupt sources within the given word, interrupt 0 is reserved
+	static constexpr uint32_t interrupt_word_mask(unsigned idx) {
+		return (idx == 0 ? ~1u : ~0u) &
+		       ((idx == NumberInterruptWords - 1 && NumberInterrupts % 32) ? ((1u << (NumberInterrupts % 32)) - 1) : ~0u);
 	}
 
 	unsigned hart_get_next_pending_interrupt(unsigned hart_id, bool consider_threshold) {
 		unsigned min_id = 0;
-		unsigned max_priority = 0;
-
-		for (unsigned i = 1; i < NumberInterrupts; ++i) {
-			unsigned idx = i / 32;
-			unsigned off = i % 32;
-
-			if (hart_enabled_interrupts(hart_id, idx) & (1 << off)) {
-				if (pending_interrupts[idx] & (1 << off)) {
-					auto prio = interrupt_priorities[i];
-					if (prio > 0 && (!consider_threshold || (prio > hart_config[hart_id].priority_threshold))) {
-						if (prio > max_priority) {
-							max_priority = prio;
-							min_id = i;
-						}
-					}
+		// a candidate must exceed the threshold, zero means do not interrupt
+		unsigned max_priority = consider_threshold ? hart_config[hart_id].priority_threshold : 0;
+
+		// only visit sources which are both pending and enabled, usually none or very few
+		for (unsigned idx = 0; idx < NumberInterruptWords; ++idx) {
+			uint32_t candidates =
+			    pending_interrupts[idx].load() & hart_enabled_interrupts(hart_id, idx) & interrupt_word_mask(idx);
+
+			while (candidates) {
+				unsigned i = idx * 32 + __builtin_ctz(candidates);
+				candidates &= candidates - 1;
+
+				// ascending order, hence ties are resolved in favor of the lowest id
+				auto prio = interrupt_priorities[i];
+				if (prio > max_priority) {
+					max_priority = prio;
+					min_id = i;
 				}
 			}
 		}
@@ -141,6 +194,24 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 		for (auto &x : interrupt_priorities) x = std::min(x, MaxPriority);
 	}
 
+	void post_write_hart_enabled_interrupts(RegisterRange::WriteInfo t) {
+		// the enable words of all harts are laid out consecutively
+		for (uint64_t a = t.addr / 4; a <= (t.addr + t.size - 1) / 4; ++a) {
+			unsigned idx = a % NumberInterruptEntries;
+			for (auto &e : enable_listeners) {
+				if (e.first / 32 == idx)
+					e.second();
+			}
+		}
+	}
+
+	bool pre_read_pending_interrupts(RegisterRange::ReadInfo t) {
+		(void)t;
+
+		for (unsigned i = 0; i < NumberInterruptEntries; ++i) pending_interrupts_view[i] = pending_interrupts[i];
+		return true;
+	}
+
 	bool pre_read_hart_config(RegisterRange::ReadInfo t) {
 		assert(t.addr % 4 == 0);
 		unsigned idx = t.addr / 4;
@@ -153,6 +224,9 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 			unsigned min_id = hart_get_next_pending_interrupt(0, false);
 			hart_config[idx].claim_response = min_id;
 			clear_pending_interrupt(min_id);
+
+			if (latency)
+				latency->claim(idx, min_id, sc_core::sc_time_stamp() + t.delay);
 		}
 
 		return true;
@@ -167,8 +241,13 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 			assert(t.size == 4);
 			--idx;
 
+			if (latency)
+				latency->complete(idx, hart_config[idx].claim_response, sc_core::sc_time_stamp() + t.delay);
+
 			if (hart_has_pending_enabled_interrupts(idx)) {
 				assert(hart_eip[idx]);
+				if (latency)
+					latency->raise(idx, sc_core::sc_time_stamp() + t.delay);
 				// trigger again to make this work even if the SW clears the harts interrupt pending bit
 				target_harts[idx]->trigger_external_interrupt(irq_level);
 			} else {
@@ -186,12 +265,16 @@ struct FE310_PLIC : public sc_core::sc_module, public interrupt_gateway {
 	void run() {
 		while (true) {
 			sc_core::wait(e_run);
+			// clear before scanning, interrupts triggered meanwhile cause another wake-up
+			run_pending = false;
 
 			for (unsigned i = 0; i < NumberCores; ++i) {
 				if (!hart_eip[i]) {
 					if (hart_has_pending_enabled_interrupts(i)) {
 						// std::cout << "[vp::plic] trigger interrupt" << std::endl;
 						hart_eip[i] = true;
+						if (latency)
+							latency->raise(i, sc_core::sc_time_stamp());
 						target_harts[i]->trigger_external_interrupt(irq_level);
 					}
 				}
@@ -51,6 +51,8 @@ void FU540_PLIC::create_registers(void) {
 	/* make pending interrupts read-only */
 	regs_pending_interrupts.pre_write_callback =
 		[] (RegisterRange::WriteInfo) { return false; };
+	regs_pending_interrupts.pre_read_callback =
+		std::bind(&FU540_PLIC::read_pending, this, std::placeholders::_1);
 
 	/* The priorities end address, as documented in the FU540-C000
 	 * manual, is incorrect <https://github.com/riscv/opensbi/pull/138> */
@@ -102,14 +104,29 @@ void FU540_PLIC::transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &de
 	vp::mm::route("FU540_PLIC", register_ranges, trans, delay);
 };
 
+/* Thread-safe, may also be called from host I/O threads */
 void FU540_PLIC::gateway_trigger_interrupt(uint32_t irq) {
 	if (irq == 0 || irq > FU540_PLIC_NUMIRQ)
 		throw std::invalid_argument("IRQ value is invalid");
 
-	pending_interrupts[GET_IDX(irq)] |= GET_OFF(irq);
-	e_run.notify(clock_cycle);
+	/* from host threads the kernel time is read without
+	 * synchronization, hence only approximate */
+	if (latency)
+		latency->trigger(irq, sc_core::sc_time_stamp());
+
+	pending_interrupts[GET_IDX(irq)].fetch_or(GET_OFF(irq));
+	if (!run_pending.exchange(true))
+		e_run.notify(clock_cycle);
 };
 
+bool FU540_PLIC::read_pending(RegisterRange::ReadInfo t) {
+	(void)t;
+
+	for (size_t i = 0; i < pending_interrupts.size(); i++)
+		pending_interrupts_view[i] = pending_interrupts[i];
+	return true;
+}
+
 bool FU540_PLIC::read_hartctx(RegisterRange::ReadInfo t, unsigned int hart, PrivilegeLevel level) {
 	assert(t.addr % sizeof(uint32_t) == 0);
 	assert(t.size == sizeof(uint32_t));
@@ -136,6 +153,9 @@ bool FU540_PLIC::read_hartctx(RegisterRange::ReadInfo t, unsigned int hart, Priv
 		/* successful claim also clears the pending bit */
 		if (irq != 0)
 			clear_pending(irq);
+
+		if (latency)
+			latency->claim(hart, irq, sc_core::sc_time_stamp() + t.delay);
 	}
 
 	return true;
@@ -146,6 +166,10 @@ void FU540_PLIC::write_hartctx(RegisterRange::WriteInfo t, unsigned int hart, Pr
 	assert(t.size == sizeof(uint32_t));
 
 	if (is_claim_access(t.addr)) {
+		if (latency) {
+			uint32_t irq = level == MachineMode ? hart_context[hart]->m_mode[1] : hart_context[hart]->s_mode[1];
+			latency->complete(hart, irq, sc_core::sc_time_stamp() + t.delay);
+		}
 		target_harts[hart]->clear_external_interrupt(level);
 	} else { /* access to priority threshold */
 		uint32_t *thr;
@@ -177,10 +201,14 @@ void FU540_PLIC::write_irq_prios(RegisterRange::WriteInfo t) {
 void FU540_PLIC::run(void) {
 	for (;;) {
 		sc_core::wait(e_run);
+		/* interrupts triggered while scanning cause another wake-up */
+		run_pending = false;
 
 		for (size_t i = 0; i < target_harts.size(); i++) {
 			PrivilegeLevel lvl;
 			if (has_pending_irq(i, &lvl)) {
+				if (latency)
+					latency->raise(i, sc_core::sc_time_stamp());
 				target_harts[i]->trigger_external_interrupt(lvl);
 			}
 		}
@@ -193,18 +221,22 @@ unsigned int FU540_PLIC::next_pending_irq(unsigned int hart, PrivilegeLevel lvl,
 
 	HartConfig *conf = enabled_irqs[hart];
 	unsigned int selirq = 0, maxpri = 0;
+	uint32_t thr = ignth ? 0 : get_threshold(hart, lvl);
 
-	for (unsigned irq = 1; irq <= FU540_PLIC_NUMIRQ; irq++) {
-		if (!conf->is_enabled(irq, lvl) || !is_pending(irq))
-			continue;
+	/* only visit interrupts which are both pending and enabled */
+	for (unsigned idx = 0; idx < pending_interrupts.size(); idx++) {
+		uint32_t irqs = pending_interrupts[idx].load() & conf->enabled_word(idx, lvl) & valid_irqs(idx);
 
-		uint32_t prio = interrupt_priorities[irq];
-		if (!ignth && prio < get_threshold(hart, lvl))
-			continue;
+		while (irqs) {
+			unsigned int irq = idx * 32 + __builtin_ctz(irqs);
+			irqs &= irqs - 1;
 
-		if (prio > maxpri) {
-			maxpri = prio;
-			selirq = irq;
+			/* ascending order, ties are resolved in favor of the lowest id */
+			uint32_t prio = interrupt_priorities[irq];
+			if (prio >= thr && prio > maxpri) {
+				maxpri = prio;
+				selirq = irq;
+			}
 		}
 	}
 
@@ -242,7 +274,7 @@ uint32_t FU540_PLIC::get_threshold(unsigned int hart, PrivilegeLevel level) {
 
 void FU540_PLIC::clear_pending(unsigned int irq) {
 	assert(irq > 0 && irq <= FU540_PLIC_NUMIRQ);
-	pending_interrupts[GET_IDX(irq)] &= ~(GET_OFF(irq));
+	pending_interrupts[GET_IDX(irq)].fetch_and(~(GET_OFF(irq)));
 }
 
 bool FU540_PLIC::is_pending(unsigned int irq) {
@@ -255,6 +287,27 @@ bool FU540_PLIC::is_claim_access(uint64_t addr) {
 	return (idx % 2) == 1;
 }
 
+uint32_t FU540_PLIC::valid_irqs(unsigned int idx) {
+	/* IRQ 0 is reserved, valid IRQs range from 1 to FU540_PLIC_NUMIRQ */
+	uint32_t mask = (idx == 0) ? ~1u : ~0u;
+	if (idx == GET_IDX(FU540_PLIC_NUMIRQ))
+		mask &= (GET_OFF(FU540_PLIC_NUMIRQ) << 1) - 1;
+	return mask;
+}
+
+uint32_t FU540_PLIC::HartConfig::enabled_word(unsigned int idx, PrivilegeLevel level) {
+	switch (level) {
+	case MachineMode:
+		return m_mode[idx];
+	case SupervisorMode:
+		return s_mode[idx];
+	default:
+		assert(0);
+	}
+
+	return 0;
+}
+
 bool FU540_PLIC::HartConfig::is_enabled(unsigned int irq, PrivilegeLevel level) {
 	assert(irq > 0 && irq <= FU540_PLIC_NUMIRQ);
 
@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
+#include "core/common/irq_latency.h"
+#include "platform/common/async_event.h"
+
 enum {
 	FU540_PLIC_NUMIRQ   = 53,
 	FU540_PLIC_MAX_THR  = 7,
@@ -17,6 +22,7 @@ struct FU540_PLIC : public sc_core::sc_module, public interrupt_gateway {
 public:
 	tlm_utils::simple_target_socket<FU540_PLIC> tsock;
 	std::vector<external_interrupt_target *> target_harts{};
+	IrqLatency *latency = nullptr; /* optional, interrupt latency */
 
 	FU540_PLIC(sc_core::sc_module_name, unsigned harts = 5);
 	void gateway_trigger_interrupt(uint32_t);
@@ -34,9 +40,12 @@ private:
 		}
 
 		bool is_enabled(unsigned int, PrivilegeLevel);
+		uint32_t enabled_word(unsigned int, PrivilegeLevel);
 	};
 
-	sc_core::sc_event e_run;
+	/* coalesces all interrupts triggered within one delta cycle */
+	AsyncEvent e_run;
+	std::atomic<bool> run_pending{false};
 	sc_core::sc_time clock_cycle;
 
 	std::vector<RegisterRange*> register_ranges;
@@ -52,11 +61,16 @@ private:
 
 	/* See Section 10.4 */
 	RegisterRange regs_pending_interrupts{0x1000, sizeof(uint32_t) * 2};
-	ArrayView<uint32_t> pending_interrupts{regs_pending_interrupts};
-	
+	ArrayView<uint32_t> pending_interrupts_view{regs_pending_interrupts};
+
+	/* Updated from arbitrary host threads, mirrored into the
+	 * register on read */
+	std::array<std::atomic<uint32_t>, 2> pending_interrupts{};
+
 	void create_registers(void);
 	void create_hart_regs(uint64_t, uint64_t, hartmap&);
 	void transport(tlm::tlm_generic_payload&, sc_core::sc_time&);
+	bool read_pending(RegisterRange::ReadInfo);
 	bool read_hartctx(RegisterRange::ReadInfo, unsigned int, PrivilegeLevel);
 	void write_hartctx(RegisterRange::WriteInfo, unsigned int, PrivilegeLevel);
 	void write_irq_prios(RegisterRange::WriteInfo);
@@ -66,6 +80,7 @@ private:
 	uint32_t get_threshold(unsigned int, PrivilegeLevel);
 	void clear_pending(unsigned int);
 	bool is_pending(unsigned int);
+	static uint32_t valid_irqs(unsigned int);
 	bool is_claim_access(uint64_t addr);
 };
 
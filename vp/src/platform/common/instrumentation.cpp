@@ -0,0 +1,32 @@
+#include "instrumentation.h"
+
+Instrumentation::Instrumentation(const Options &opt, Architecture arch) : opt(opt) {
+	if (!opt.trace_file.empty())
+		tracer.reset(new TraceWriter(opt.trace_file, arch, opt.trace_filter));
+
+	if (!opt.profile_file.empty()) {
+		opt.load_symbols(symbols);
+		profiler.reset(new Profiler(opt.profile_file, opt.profile_interval, symbols));
+	}
+
+	if (!opt.coverage_file.empty())
+		coverage.reset(new Coverage(opt.coverage_file, opt.guest_elfs()));
+
+	if (!opt.instr_mix_file.empty())
+		instr_mix.reset(new InstrMix(opt.instr_mix_file));
+
+	if (opt.stats || !opt.metrics_socket.empty())
+		stats.reset(new Stats());
+}
+
+void Instrumentation::start(void) {
+	if (!opt.metrics_socket.empty())
+		metrics.reset(new MetricsServer(opt.metrics_socket, *stats));
+}
+
+void Instrumentation::report(void) {
+	if (opt.stats)
+		stats->report(opt.stats_file);
+	if (irq_latency)
+		irq_latency->report(opt.irq_latency_file);
+}
@@ -0,0 +1,78 @@
+#ifndef RISCV_VP_INSTRUMENTATION_H
+#define RISCV_VP_INSTRUMENTATION_H
+
+#include <memory>
+
+#include <systemc>
+
+#include "core/common/core_defs.h"
+#include "core/common/coverage.h"
+#include "core/common/instr_mix.h"
+#include "core/common/irq_latency.h"
+#include "core/common/metrics.h"
+#include "core/common/profiler.h"
+#include "core/common/stats.h"
+#include "core/common/symbol_index.h"
+#include "core/common/trace.h"
+#include "options.h"
+
+/*
+ * The optional observers selected by the shared Options: the trace writer,
+ * profiler, coverage, instruction mix, interrupt latency, statistics and
+ * metrics server. A platform creates one after parsing the options, adds
+ * the PLIC (if any) before its harts, then the harts and buses, calls
+ * start() before and report() after the simulation. Files written at exit
+ * are written when it is destroyed.
+ */
+class Instrumentation {
+	const Options &opt;
+
+	SymbolIndex symbols;
+	std::unique_ptr<TraceWriter> tracer;
+	std::unique_ptr<Profiler> profiler;
+	std::unique_ptr<Coverage> coverage;
+	std::unique_ptr<InstrMix> instr_mix;
+	std::unique_ptr<IrqLatency> irq_latency;
+	std::unique_ptr<Stats> stats;
+	std::unique_ptr<MetricsServer> metrics;
+
+public:
+	Instrumentation(const Options &opt, Architecture arch);
+
+	template <typename PLIC>
+	void add_plic(PLIC &plic, unsigned num_irqs, unsigned num_harts, sc_core::sc_time cycle_time) {
+		if (!opt.irq_latency)
+			return;
+		irq_latency.reset(new IrqLatency(num_irqs, num_harts, cycle_time));
+		plic.latency = irq_latency.get();
+	}
+
+	template <typename ISS>
+	void add_hart(ISS &iss) {
+		unsigned id = iss.get_hart_id();
+
+		if (tracer)
+			iss.tracer = tracer->add_hart(id);
+		if (profiler)
+			iss.profiler = profiler->add_hart(id);
+		iss.coverage = coverage.get();
+		if (instr_mix)
+			iss.instr_mix = instr_mix->add_hart(id, iss.stats);
+		iss.irq_latency = irq_latency.get();
+		if (stats)
+			stats->add_hart(id, iss.stats);
+	}
+
+	template <typename Bus>
+	void add_bus(const Bus &bus) {
+		if (stats)
+			stats->add_bus(bus);
+	}
+
+	// starts the metrics server, all harts and buses must have been added
+	void start(void);
+	// prints the statistics and interrupt latencies
+	void report(void);
+};
+
+#endif  // RISCV_VP_INSTRUMENTATION_H
@@ -0,0 +1,212 @@
+#include "io_reactor.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+/* maximum number of events processed per epoll_wait(2) call */
+#define REACTOR_MAX_EVENTS 32
+
+IOReactor &IOReactor::get(void) {
+	static IOReactor reactor;
+	return reactor;
+}
+
+IOReactor::IOReactor(void) {
+	struct epoll_event ev = {};
+
+	if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+		throw std::system_error(errno, std::generic_category());
+	if ((evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	ev.events = EPOLLIN;
+	ev.data.fd = evfd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev) == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	thr = std::thread(&IOReactor::run, this);
+	thr.detach();
+}
+
+void IOReactor::add(int fd, uint32_t events, handler fn) {
+	std::shared_ptr<Source> src = std::make_shared<Source>();
+	src->fd = fd;
+	src->events = 0;
+	src->pollable = true;
+	src->fn = fn;
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (sources.count(fd))
+			throw std::invalid_argument("file descriptor already registered");
+
+		/* probe whether the file descriptor supports epoll at all */
+		struct epoll_event ev = {};
+		ev.data.fd = fd;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+			if (errno != EPERM)
+				throw std::system_error(errno, std::generic_category());
+			src->pollable = false;
+		} else if (epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL) == -1) {
+			throw std::system_error(errno, std::generic_category());
+		}
+
+		sources[fd] = src;
+	}
+
+	modify(fd, events);
+}
+
+void IOReactor::modify(int fd, uint32_t events) {
+	std::lock_guard<std::mutex> lock(mtx);
+	std::shared_ptr<Source> src = sources.at(fd);
+	if (src->failed)
+		return;
+
+	if (!src->pollable) {
+		if (!src->events && events)
+			num_always_ready++;
+		else if (src->events && !events)
+			num_always_ready--;
+		src->events = events;
+		kick();
+		return;
+	}
+
+	/* EPOLLHUP and EPOLLERR are always reported. Remove the file
+	 * descriptor from the interest list entirely while it is
+	 * disabled to not spin on a closed connection. */
+	int op;
+	if (!events)
+		op = EPOLL_CTL_DEL;
+	else if (!src->events)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	if (events != src->events) {
+		struct epoll_event ev = {};
+		ev.events = events;
+		ev.data.fd = fd;
+		if (epoll_ctl(epfd, op, fd, &ev) == -1)
+			throw std::system_error(errno, std::generic_category());
+	}
+	src->events = events;
+}
+
+void IOReactor::remove(int fd) {
+	modify(fd, 0);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	sources.erase(fd);
+}
+
+void IOReactor::wakeup(int fd) {
+	std::shared_ptr<Source> src = lookup(fd);
+	if (!src)
+		return;
+
+	if (!src->woken.exchange(true))
+		kick();
+}
+
+std::shared_ptr<IOReactor::Source> IOReactor::lookup(int fd) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	auto it = sources.find(fd);
+	if (it == sources.end())
+		return nullptr;
+	return it->second;
+}
+
+void IOReactor::kick(void) {
+	uint64_t val = 1;
+
+	/* The only error of a valid eventfd is EAGAIN, which means the
+	 * counter is saturated, the reactor wakes up anyway. */
+	if (write(evfd, &val, sizeof(val)) == -1 && errno != EAGAIN)
+		std::cerr << "io-reactor: wake-up failed: " << strerror(errno) << std::endl;
+}
+
+void IOReactor::dispatch(Source &src, uint32_t events) {
+	if (src.failed)
+		return;
+
+	try {
+		src.fn(events);
+	} catch (std::exception &e) {
+		std::cerr << "io-reactor: disabling file descriptor " << src.fd << ": " << e.what() << std::endl;
+
+		std::lock_guard<std::mutex> lock(mtx);
+		src.failed = true;
+		/* errors are irrelevant, the file descriptor is not polled again */
+		if (!src.pollable && src.events)
+			num_always_ready--;
+		else if (src.pollable && src.events)
+			epoll_ctl(epfd, EPOLL_CTL_DEL, src.fd, NULL);
+		src.events = 0;
+	}
+}
+
+void IOReactor::run(void) {
+	struct epoll_event evs[REACTOR_MAX_EVENTS];
+	std::vector<std::pair<std::shared_ptr<Source>, uint32_t>> ready;
+
+	for (;;) {
+		int timeout;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			timeout = (num_always_ready > 0) ? 0 : -1;
+		}
+
+		int n = epoll_wait(epfd, evs, REACTOR_MAX_EVENTS, timeout);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			/* only possible for an invalid epoll instance, stop host I/O
+			 * but keep the simulation running */
+			std::cerr << "io-reactor: epoll_wait failed: " << strerror(errno) << std::endl;
+			return;
+		}
+
+		for (int i = 0; i < n; i++) {
+			int fd = evs[i].data.fd;
+			if (fd == evfd) {
+				uint64_t val;
+				if (read(evfd, &val, sizeof(val)) == -1 && errno != EAGAIN)
+					std::cerr << "io-reactor: wake-up failed: " << strerror(errno) << std::endl;
+				continue;
+			}
+
+			std::shared_ptr<Source> src = lookup(fd);
+			if (src)
+				dispatch(*src, evs[i].events);
+		}
+
+		/* explicit wake-ups and file descriptors without epoll support */
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			for (auto &e : sources) {
+				const std::shared_ptr<Source> &src = e.second;
+				uint32_t events = src->pollable ? 0 : src->events;
+				if (src->woken.load() || events)
+					ready.push_back(std::make_pair(src, events));
+			}
+		}
+
+		for (auto &r : ready) {
+			r.first->woken.store(false);
+			dispatch(*r.first, r.second);
+		}
+		ready.clear();
+	}
+}
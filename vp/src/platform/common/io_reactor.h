@@ -0,0 +1,70 @@
+#ifndef RISCV_VP_IO_REACTOR_H
+#define RISCV_VP_IO_REACTOR_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * Single host thread which multiplexes all host file descriptors used by
+ * the peripherals (stdin, tun/tap devices, sockets, ...) using epoll(7).
+ *
+ * Handlers are invoked on the reactor thread and must never block. They
+ * usually move completed buffers into a lock-free queue and wake up the
+ * SystemC side through an AsyncEvent. The SystemC side can in turn request
+ * a handler invocation via wakeup(), e.g. after it freed space in a queue
+ * or queued data for transmission. In this case the handler is called with
+ * an empty event mask.
+ *
+ * File descriptors which do not support epoll (e.g. regular files used as
+ * stdin) are treated as always ready.
+ *
+ * If a handler throws, e.g. on a host error of its file descriptor, the
+ * error is logged and the source is disabled for good, modify() has no
+ * effect on it anymore. The other sources continue to be served.
+ */
+class IOReactor {
+public:
+	typedef std::function<void(uint32_t)> handler;
+
+	static IOReactor &get(void);
+
+	void add(int fd, uint32_t events, handler fn);
+	void modify(int fd, uint32_t events);
+	void remove(int fd);
+
+	/* thread-safe, multiple wake-ups before the handler runs are coalesced */
+	void wakeup(int fd);
+
+private:
+	struct Source {
+		int fd;
+		uint32_t events;
+		bool pollable;
+		std::atomic<bool> woken{false};
+		std::atomic<bool> failed{false};
+		handler fn;
+	};
+
+	int epfd;
+	int evfd;
+	std::thread thr;
+
+	std::mutex mtx;
+	std::map<int, std::shared_ptr<Source>> sources;
+	unsigned num_always_ready = 0;
+
+	IOReactor(void);
+	std::shared_ptr<Source> lookup(int fd);
+	void kick(void);
+	void dispatch(Source &, uint32_t);
+	void run(void);
+};
+
+#endif  // RISCV_VP_IO_REACTOR_H
@@ -4,6 +4,8 @@
 #include <unistd.h>
 #include <boost/program_options.hpp>
 
+#include "core/common/irq_if.h"
+
 namespace po = boost::program_options;
 
 Options::Options(void) {
@@ -14,6 +16,21 @@ Options::Options(void) {
 		("debug-mode", po::bool_switch(&use_debug_runner), "start execution in debugger (using gdb rsp interface)")
 		("debug-port", po::value<unsigned int>(&debug_port), "select port number to connect with GDB")
 		("trace-mode", po::bool_switch(&trace_mode), "enable instruction tracing")
+		("trace-file", po::value<std::string>(&trace_file), "write a compressed binary instruction trace (see trace-decoder)")
+		("trace-pc-range", po::value<std::string>(&trace_pc_range), "only trace instructions at START:END (inclusive)")
+		("trace-prv", po::value<std::string>(&trace_prv), "only trace the given privilege levels, e.g. \"su\"")
+		("trace-hart", po::value<int>(&trace_filter.hart), "only trace the given hart")
+		("trace-instr-range", po::value<std::string>(&trace_instr_range), "only trace instructions START:END (executed instructions, END exclusive)")
+		("profile-file", po::value<std::string>(&profile_file), "sample the guest call stacks into a collapsed stack file (for flamegraphs)")
+		("profile-interval", po::value<uint64_t>(&profile_interval), "instructions between profile samples (default: 9973, prime to not alias with loops)")
+		("coverage-file", po::value<std::string>(&coverage_file), "write line and branch coverage of the input program and --symbols files (built with -g) at exit, as lcov tracefile or Cobertura XML if the name ends in .xml")
+		("instr-mix-file", po::value<std::string>(&instr_mix_file), "write executed instructions per opcode and privilege level, access sizes and branch taken ratios as JSON at exit")
+		("stats", po::bool_switch(&stats), "print simulation statistics at exit (instruction classes, MIPS, TLB, bus, ...)")
+		("stats-file", po::value<std::string>(&stats_file), "additionally write the statistics as JSON (implies --stats)")
+		("metrics-socket", po::value<std::string>(&metrics_socket), "serve live statistics in the Prometheus text format on the given Unix socket")
+		("irq-latency", po::bool_switch(&irq_latency), "print the latencies of PLIC interrupts (trigger, raise, trap entry, claim, complete) in cycles at exit")
+		("irq-latency-file", po::value<std::string>(&irq_latency_file), "additionally write the interrupt latencies as JSON (implies --irq-latency)")
+		("symbols", po::value<std::vector<std::string>>(&symbol_specs)->composing(), "additional ELF FILE[@OFFSET] to take symbols from, e.g. a kernel or firmware (repeatable)")
 		("tlm-global-quantum", po::value<unsigned int>(&tlm_global_quantum), "set global tlm quantum (in NS)")
 		("use-instr-dmi", po::bool_switch(&use_instr_dmi), "use dmi to fetch instructions")
 		("use-data-dmi", po::bool_switch(&use_data_dmi), "use dmi to execute load/store operations")
@@ -24,6 +41,42 @@ Options::Options(void) {
 	pos.add("input-file", 1);
 }
 
+static void parse_range(const std::string &name, const std::string &s, uint64_t &start, uint64_t &end) {
+	auto sep = s.find(':');
+	if (sep == std::string::npos)
+		throw po::error("invalid " + name + " '" + s + "', expected START:END");
+
+	try {
+		if (sep > 0)
+			start = std::stoull(s.substr(0, sep), nullptr, 0);
+		if (sep + 1 < s.size())
+			end = std::stoull(s.substr(sep + 1), nullptr, 0);
+	} catch (std::logic_error &) {
+		throw po::error("invalid " + name + " '" + s + "'");
+	}
+}
+
+void Options::parse_trace_filter(void) {
+	if (!trace_pc_range.empty())
+		parse_range("trace-pc-range", trace_pc_range, trace_filter.start_addr, trace_filter.end_addr);
+	if (!trace_instr_range.empty())
+		parse_range("trace-instr-range", trace_instr_range, trace_filter.start_instr, trace_filter.end_instr);
+
+	if (!trace_prv.empty()) {
+		trace_filter.prv_mask = 0;
+		for (char c : trace_prv) {
+			if (c == 'u')
+				trace_filter.prv_mask |= 1 << UserMode;
+			else if (c == 's')
+				trace_filter.prv_mask |= 1 << SupervisorMode;
+			else if (c == 'm')
+				trace_filter.prv_mask |= 1 << MachineMode;
+			else
+				throw po::error("invalid trace-prv '" + trace_prv + "', expected any of 'msu'");
+		}
+	}
+}
+
 void Options::parse(int argc, char **argv) {
 	try {
 		auto parser = po::command_line_parser(argc, argv);
@@ -41,6 +94,18 @@ void Options::parse(int argc, char **argv) {
 			use_data_dmi = true;
 			use_instr_dmi = true;
 		}
+		parse_trace_filter();
+		if (!stats_file.empty())
+			stats = true;
+		if (!irq_latency_file.empty())
+			irq_latency = true;
+		for (auto &spec : symbol_specs) {
+			try {
+				symbol_files.push_back(SymbolIndex::File::parse(spec));
+			} catch (std::runtime_error &e) {
+				throw po::error(e.what());
+			}
+		}
 	} catch (po::error &e) {
 		std::cerr
 			<< "Error parsing command line options: "
@@ -49,3 +114,13 @@ void Options::parse(int argc, char **argv) {
 		exit(1);
 	}
 }
+
+void Options::load_symbols(SymbolIndex &symbols) const {
+	for (auto &f : guest_elfs()) symbols.add_elf(f);
+}
+
+std::vector<SymbolIndex::File> Options::guest_elfs() const {
+	std::vector<SymbolIndex::File> elfs{{input_program, 0}};
+	elfs.insert(elfs.end(), symbol_files.begin(), symbol_files.end());
+	return elfs;
+}
@@ -3,10 +3,17 @@
 
 #include <boost/program_options.hpp>
 
+#include "core/common/symbol_index.h"
+#include "core/common/trace.h"
+
 class Options : public boost::program_options::options_description {
 public:
 	Options(void);
 	virtual void parse(int argc, char **argv);
+	// index the symbols of the input program and all --symbols files
+	void load_symbols(SymbolIndex &symbols) const;
+	// the input program followed by all --symbols files
+	std::vector<SymbolIndex::File> guest_elfs() const;
 
 	std::string input_program;
 
@@ -14,11 +21,29 @@ public:
 	bool use_debug_runner = false;
 	unsigned int debug_port = 5005;
 	bool trace_mode = false;
+	std::string trace_file;
+	TraceFilter trace_filter;
+	std::string profile_file;
+	uint64_t profile_interval = 9973;
+	std::vector<SymbolIndex::File> symbol_files;
+	std::string coverage_file;
+	std::string instr_mix_file;
+	bool stats = false;
+	std::string stats_file;
+	std::string metrics_socket;
+	bool irq_latency = false;
+	std::string irq_latency_file;
 	unsigned int tlm_global_quantum = 10;
 	bool use_instr_dmi = false;
 	bool use_data_dmi = false;
 
 private:
+	std::string trace_pc_range;
+	std::string trace_instr_range;
+	std::string trace_prv;
+	std::vector<std::string> symbol_specs;
+
+	void parse_trace_filter(void);
 
 	boost::program_options::positional_options_description pos;
 	boost::program_options::variables_map vm;
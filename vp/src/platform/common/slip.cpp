@@ -44,7 +44,7 @@ SLIP::SLIP(const sc_core::sc_module_name &name, uint32_t irqsrc, std::string net
 	if (!(rcvbuf = (uint8_t *)malloc(rcvsiz * sizeof(uint8_t))))
 		goto err2;
 
-	start_threads();
+	start_io(tunfd);
 	return;
 err2:
 	free(sndbuf);
@@ -86,7 +86,12 @@ void SLIP::send_packet(void) {
 	sndsiz = 0;
 }
 
-void SLIP::write_data(uint8_t data) {
+void SLIP::write_data(const uint8_t *data, size_t len) {
+	for (size_t i = 0; i < len; i++)
+		write_byte(data[i]);
+}
+
+void SLIP::write_byte(uint8_t data) {
 	if (data == SLIP_END) {
 		if (sndsiz > 0)
 			send_packet();
@@ -112,10 +117,13 @@ void SLIP::write_data(uint8_t data) {
 	sndbuf[sndsiz++] = data;
 }
 
-void SLIP::read_data(void) {
+bool SLIP::read_data(void) {
 	ssize_t ret = read(tunfd, rcvbuf, rcvsiz);
-	if (ret == -1)
+	if (ret == -1) {
+		if (errno == EAGAIN || errno == EINTR)
+			return true;
 		throw std::system_error(errno, std::generic_category());
+	}
 
 	for (size_t i = 0; i < (size_t)ret; i++) {
 		switch (rcvbuf[i]) {
@@ -133,4 +141,5 @@ void SLIP::read_data(void) {
 		}
 	}
 	rxpush(SLIP_END);
+	return true;
 }
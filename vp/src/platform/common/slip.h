@@ -11,8 +11,9 @@ public:
 private:
 	int get_mtu(const char *);
 	void send_packet(void);
-	void write_data(uint8_t);
-	void read_data(void);
+	void write_byte(uint8_t);
+	void write_data(const uint8_t *, size_t);
+	bool read_data(void);
 
 	int tunfd;
 
@@ -8,35 +8,56 @@
 
 #include <sys/types.h>
 
-UART::UART(const sc_core::sc_module_name& name, uint32_t irqsrc)
-		: AbstractUART(name, irqsrc) {
+/* maximum amount of bytes read from stdin at once */
+#define UART_READ_SIZE 256
+
+UART::UART(const sc_core::sc_module_name& name, uint32_t irqsrc, bool input)
+		: AbstractUART(name, irqsrc), input(input) {
+	/* stdout is only registered for the transmit wake-ups then */
+	if (!input) {
+		start_io(STDOUT_FILENO, false);
+		return;
+	}
+
 	enableRawMode(STDIN_FILENO);
-	start_threads();
+	start_io(STDIN_FILENO);
 }
 
 UART::~UART(void) {
-	disableRawMode(STDIN_FILENO);
+	if (input)
+		disableRawMode(STDIN_FILENO);
 }
 
-void UART::write_data(uint8_t data) {
+void UART::write_data(const uint8_t *data, size_t len) {
 	ssize_t nwritten;
 
-	nwritten = write(STDOUT_FILENO, &data, sizeof(data));
-	if (nwritten == -1)
-		throw std::system_error(errno, std::generic_category());
-	else if (nwritten != sizeof(data))
-		throw std::runtime_error("short write");
+	while (len > 0) {
+		nwritten = write(STDOUT_FILENO, data, len);
+		if (nwritten == -1) {
+			if (errno == EINTR)
+				continue;
+			throw std::system_error(errno, std::generic_category());
+		}
+
+		data += nwritten;
+		len -= nwritten;
+	}
 }
 
-void UART::read_data(void) {
-	uint8_t buf;
+bool UART::read_data(void) {
+	uint8_t buf[UART_READ_SIZE];
 	ssize_t nread;
 
-	nread = read(STDIN_FILENO, &buf, sizeof(buf));
-	if (nread == -1)
+	nread = read(STDIN_FILENO, buf, sizeof(buf));
+	if (nread == -1) {
+		if (errno == EAGAIN || errno == EINTR)
+			return true;
 		throw std::system_error(errno, std::generic_category());
-	else if (nread != sizeof(buf))
-		throw std::runtime_error("short read");
+	} else if (nread == 0) {
+		return false; /* EOF */
+	}
 
-	rxpush(buf);
+	for (ssize_t i = 0; i < nread; i++)
+		rxpush(buf[i]);
+	return true;
 }
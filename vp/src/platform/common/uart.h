@@ -7,12 +7,15 @@
 
 class UART : public AbstractUART {
 public:
-	UART(const sc_core::sc_module_name&, uint32_t);
+	/* input from stdin is optional, e.g. if another device uses it */
+	UART(const sc_core::sc_module_name&, uint32_t, bool input = true);
 	~UART(void);
 
 private:
-	void write_data(uint8_t);
-	void read_data(void);
+	bool input;
+
+	void write_data(const uint8_t *, size_t);
+	bool read_data(void);
 };
 
 #endif  // RISCV_VP_UART_H
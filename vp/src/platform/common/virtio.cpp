@@ -0,0 +1,471 @@
+#include "virtio.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+
+/* device status bits, see section 2.1 */
+#define VIRTIO_STATUS_ACKNOWLEDGE 1
+#define VIRTIO_STATUS_DRIVER 2
+#define VIRTIO_STATUS_DRIVER_OK 4
+#define VIRTIO_STATUS_FEATURES_OK 8
+#define VIRTIO_STATUS_DEVICE_NEEDS_RESET 64
+#define VIRTIO_STATUS_FAILED 128
+
+/* interrupt status bits, see section 4.2.2 */
+#define VIRTIO_MMIO_INT_VRING (1 << 0)
+#define VIRTIO_MMIO_INT_CONFIG (1 << 1)
+
+/* descriptor flags, see section 2.6.5 */
+#define VIRTQ_DESC_F_NEXT 1
+#define VIRTQ_DESC_F_WRITE 2
+#define VIRTQ_DESC_F_INDIRECT 4
+
+/* available ring flags, see section 2.6.6 */
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 1
+
+enum {
+	MAGIC_VALUE_REG_ADDR = 0x000,
+	VERSION_REG_ADDR = 0x004,
+	DEVICE_ID_REG_ADDR = 0x008,
+	VENDOR_ID_REG_ADDR = 0x00C,
+	DEVICE_FEATURES_REG_ADDR = 0x010,
+	DEVICE_FEATURES_SEL_REG_ADDR = 0x014,
+	DRIVER_FEATURES_REG_ADDR = 0x020,
+	DRIVER_FEATURES_SEL_REG_ADDR = 0x024,
+	QUEUE_SEL_REG_ADDR = 0x030,
+	QUEUE_NUM_MAX_REG_ADDR = 0x034,
+	QUEUE_NUM_REG_ADDR = 0x038,
+	QUEUE_READY_REG_ADDR = 0x044,
+	QUEUE_NOTIFY_REG_ADDR = 0x050,
+	INTERRUPT_STATUS_REG_ADDR = 0x060,
+	INTERRUPT_ACK_REG_ADDR = 0x064,
+	STATUS_REG_ADDR = 0x070,
+	QUEUE_DESC_LOW_REG_ADDR = 0x080,
+	QUEUE_DESC_HIGH_REG_ADDR = 0x084,
+	QUEUE_DRIVER_LOW_REG_ADDR = 0x090,
+	QUEUE_DRIVER_HIGH_REG_ADDR = 0x094,
+	QUEUE_DEVICE_LOW_REG_ADDR = 0x0A0,
+	QUEUE_DEVICE_HIGH_REG_ADDR = 0x0A4,
+	CONFIG_GENERATION_REG_ADDR = 0x0FC,
+	CONFIG_SPACE_ADDR = 0x100,
+};
+
+/* Layout of a descriptor table entry in guest memory */
+struct virtq_desc {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t flags;
+	uint16_t next;
+};
+
+/* Same as vring_need_event() in the specification */
+static bool need_event(uint16_t event_idx, uint16_t new_idx, uint16_t old_idx) {
+	return (uint16_t)(new_idx - event_idx - 1) < (uint16_t)(new_idx - old_idx);
+}
+
+size_t VirtioQueue::Chain::read(size_t offset, void *buf, size_t len) const {
+	size_t done = 0;
+
+	for (auto &v : VirtioQueue::slice(out, offset, len)) {
+		memcpy((uint8_t *)buf + done, v.iov_base, v.iov_len);
+		done += v.iov_len;
+	}
+
+	return done;
+}
+
+size_t VirtioQueue::Chain::write(size_t offset, const void *buf, size_t len) const {
+	size_t done = 0;
+
+	for (auto &v : VirtioQueue::slice(in, offset, len)) {
+		memcpy(v.iov_base, (const uint8_t *)buf + done, v.iov_len);
+		done += v.iov_len;
+	}
+
+	return done;
+}
+
+std::vector<struct iovec> VirtioQueue::slice(const std::vector<struct iovec> &iov, size_t offset, size_t len) {
+	std::vector<struct iovec> r;
+
+	for (auto &v : iov) {
+		if (len == 0)
+			break;
+		if (offset >= v.iov_len) {
+			offset -= v.iov_len;
+			continue;
+		}
+
+		struct iovec part;
+		part.iov_base = (uint8_t *)v.iov_base + offset;
+		part.iov_len = std::min(v.iov_len - offset, len);
+		r.push_back(part);
+
+		len -= part.iov_len;
+		offset = 0;
+	}
+
+	return r;
+}
+
+void VirtioQueue::reset(void) {
+	num = VIRTIO_QUEUE_MAX;
+	ready = false;
+	desc_addr = driver_addr = device_addr = 0;
+	last_avail = used_idx = signalled_used = 0;
+	mem = nullptr;
+	failed = false;
+}
+
+void VirtioQueue::start(MemoryDMI *dmi, bool use_event_idx) {
+	mem = dmi;
+	event_idx = use_event_idx;
+	last_avail = used_idx = signalled_used = 0;
+
+	if (num == 0 || num > VIRTIO_QUEUE_MAX || (num & (num - 1))) {
+		fail("virtio: invalid queue size");
+		return;
+	}
+
+	/* validate the ring addresses once, the rings are accessed without
+	 * further checks afterwards */
+	if (!guest_ptr(desc_addr, sizeof(virtq_desc) * num) || !guest_ptr(driver_addr, sizeof(uint16_t) * (3 + num)) ||
+	    !guest_ptr(device_addr, sizeof(uint16_t) * 3 + sizeof(uint32_t) * 2 * num))
+		fail("virtio: ring outside of guest memory");
+}
+
+void VirtioQueue::fail(const char *reason) {
+	if (failed)
+		return;
+
+	std::cerr << reason << ", device needs reset" << std::endl;
+	failed = true;
+	device->set_needs_reset();
+}
+
+/* nullptr if the buffer is not entirely in guest memory */
+void *VirtioQueue::guest_ptr(uint64_t addr, uint64_t len) {
+	if (!mem->contains(addr) || len > mem->get_end() - addr)
+		return nullptr;
+	return mem->get_raw_mem_ptr() + (addr - mem->get_start());
+}
+
+/* Index 0 is the flags field, 1 the index, followed by the ring
+ * entries and used_event. Same for the used ring with 32 bit entries. */
+uint16_t *VirtioQueue::avail_ring(unsigned idx) {
+	return (uint16_t *)guest_ptr(driver_addr, 0) + idx;
+}
+
+bool VirtioQueue::available(void) {
+	if (!ready || !mem || failed)
+		return false;
+	return __atomic_load_n(avail_ring(1), __ATOMIC_ACQUIRE) != last_avail;
+}
+
+bool VirtioQueue::add_buffer(Chain &chain, uint64_t addr, uint32_t len, uint16_t flags) {
+	struct iovec iov;
+	iov.iov_base = guest_ptr(addr, len);
+	iov.iov_len = len;
+	if (!iov.iov_base) {
+		fail("virtio: buffer outside of guest memory");
+		return false;
+	}
+
+	if (flags & VIRTQ_DESC_F_WRITE) {
+		chain.in.push_back(iov);
+		chain.in_len += len;
+	} else {
+		if (!chain.in.empty()) {
+			fail("virtio: device-readable buffer after writable buffer");
+			return false;
+		}
+		chain.out.push_back(iov);
+		chain.out_len += len;
+	}
+	return true;
+}
+
+bool VirtioQueue::add_indirect(Chain &chain, uint64_t addr, uint32_t len) {
+	virtq_desc *table = (virtq_desc *)guest_ptr(addr, len);
+	if (len % sizeof(virtq_desc) || len == 0 || !table) {
+		fail("virtio: invalid indirect descriptor table");
+		return false;
+	}
+	unsigned count = len / sizeof(virtq_desc);
+
+	for (unsigned i = 0, n = 0;; n++) {
+		if (i >= count || n >= count) {
+			fail("virtio: invalid indirect descriptor chain");
+			return false;
+		}
+
+		virtq_desc desc;
+		memcpy(&desc, &table[i], sizeof(desc));
+		if (desc.flags & VIRTQ_DESC_F_INDIRECT) {
+			fail("virtio: nested indirect descriptor");
+			return false;
+		}
+		if (!add_buffer(chain, desc.addr, desc.len, desc.flags))
+			return false;
+
+		if (!(desc.flags & VIRTQ_DESC_F_NEXT))
+			return true;
+		i = desc.next;
+	}
+}
+
+bool VirtioQueue::pop(Chain &chain) {
+	if (!available())
+		return false;
+
+	uint16_t avail_idx = __atomic_load_n(avail_ring(1), __ATOMIC_ACQUIRE);
+	if ((uint16_t)(avail_idx - last_avail) > num) {
+		fail("virtio: invalid available ring index");
+		return false;
+	}
+
+	chain.head = *avail_ring(2 + last_avail % num);
+	chain.out.clear();
+	chain.in.clear();
+	chain.out_len = chain.in_len = 0;
+	last_avail++;
+
+	/* request a notification for the next buffer made available */
+	if (event_idx) {
+		uint16_t *avail_event = (uint16_t *)guest_ptr(device_addr, 0) + 2 + 4 * num;
+		__atomic_store_n(avail_event, last_avail, __ATOMIC_RELEASE);
+	}
+
+	virtq_desc *table = (virtq_desc *)guest_ptr(desc_addr, 0);
+	for (unsigned i = chain.head, n = 0;; n++) {
+		if (i >= num || n >= num) {
+			fail("virtio: invalid descriptor chain");
+			return false;
+		}
+
+		virtq_desc desc;
+		memcpy(&desc, &table[i], sizeof(desc));
+		bool ok = (desc.flags & VIRTQ_DESC_F_INDIRECT) ? add_indirect(chain, desc.addr, desc.len)
+		                                               : add_buffer(chain, desc.addr, desc.len, desc.flags);
+		if (!ok)
+			return false;
+
+		if (!(desc.flags & VIRTQ_DESC_F_NEXT))
+			return true;
+		i = desc.next;
+	}
+}
+
+void VirtioQueue::unpop(void) {
+	last_avail--;
+}
+
+void VirtioQueue::push(const Chain &chain, uint32_t len) {
+	uint16_t *used = (uint16_t *)guest_ptr(device_addr, 0);
+	uint32_t *elem = (uint32_t *)(used + 2) + 2 * (used_idx % num);
+
+	elem[0] = chain.head;
+	elem[1] = len;
+	__atomic_store_n(used + 1, ++used_idx, __ATOMIC_RELEASE);
+}
+
+bool VirtioQueue::need_interrupt(void) {
+	if (used_idx == signalled_used)
+		return false;
+
+	/* the new used index must be visible before used_event is read */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	uint16_t old_idx = signalled_used;
+	signalled_used = used_idx;
+
+	if (event_idx)
+		return need_event(__atomic_load_n(avail_ring(2 + num), __ATOMIC_ACQUIRE), used_idx, old_idx);
+	return !(__atomic_load_n(avail_ring(0), __ATOMIC_ACQUIRE) & VIRTQ_AVAIL_F_NO_INTERRUPT);
+}
+
+VirtioMMIO::VirtioMMIO(sc_core::sc_module_name, uint32_t irqsrc, MemoryDMI dmi, uint32_t id, unsigned num_queues,
+                       size_t config_size)
+    : mem(dmi), queues(num_queues), config(config_size), irq(irqsrc), device_id(id) {
+	tsock.register_b_transport(this, &VirtioMMIO::transport);
+
+	for (auto &q : queues)
+		q.device = this;
+
+	router
+	    .add_register_bank({
+		{MAGIC_VALUE_REG_ADDR, &magic_value, vp::map::read_only},
+		{VERSION_REG_ADDR, &version, vp::map::read_only},
+		{DEVICE_ID_REG_ADDR, &device_id, vp::map::read_only},
+		{VENDOR_ID_REG_ADDR, &vendor_id, vp::map::read_only},
+		{DEVICE_FEATURES_REG_ADDR, &device_features_reg, vp::map::read_only},
+		{DEVICE_FEATURES_SEL_REG_ADDR, &device_features_sel, vp::map::write_only},
+		{DRIVER_FEATURES_REG_ADDR, &driver_features, vp::map::write_only},
+		{DRIVER_FEATURES_SEL_REG_ADDR, &driver_features_sel, vp::map::write_only},
+		{QUEUE_SEL_REG_ADDR, &queue_sel, vp::map::write_only},
+		{QUEUE_NUM_MAX_REG_ADDR, &queue_num_max, vp::map::read_only},
+		{QUEUE_NUM_REG_ADDR, &queue_num, vp::map::write_only},
+		{QUEUE_READY_REG_ADDR, &queue_ready},
+		{QUEUE_NOTIFY_REG_ADDR, &queue_notify_reg, vp::map::write_only},
+		{INTERRUPT_STATUS_REG_ADDR, &interrupt_status, vp::map::read_only},
+		{INTERRUPT_ACK_REG_ADDR, &interrupt_ack, vp::map::write_only},
+		{STATUS_REG_ADDR, &status},
+		{QUEUE_DESC_LOW_REG_ADDR, &queue_desc_low, vp::map::write_only},
+		{QUEUE_DESC_HIGH_REG_ADDR, &queue_desc_high, vp::map::write_only},
+		{QUEUE_DRIVER_LOW_REG_ADDR, &queue_driver_low, vp::map::write_only},
+		{QUEUE_DRIVER_HIGH_REG_ADDR, &queue_driver_high, vp::map::write_only},
+		{QUEUE_DEVICE_LOW_REG_ADDR, &queue_device_low, vp::map::write_only},
+		{QUEUE_DEVICE_HIGH_REG_ADDR, &queue_device_high, vp::map::write_only},
+		{CONFIG_GENERATION_REG_ADDR, &config_generation, vp::map::read_only},
+	    })
+	    .register_handler(this, &VirtioMMIO::register_access_callback);
+
+	if (config_size > 0)
+		router.add_start_size_mapping(CONFIG_SPACE_ADDR, config_size, vp::map::read_write)
+		    .register_handler(this, &VirtioMMIO::config_access);
+}
+
+VirtioMMIO::~VirtioMMIO(void) {
+	return;
+}
+
+bool VirtioMMIO::has_feature(unsigned bit) {
+	return driver_features_bits & (1ULL << bit);
+}
+
+void VirtioMMIO::signal_used(VirtioQueue &queue) {
+	if (!queue.need_interrupt())
+		return;
+
+	isr.fetch_or(VIRTIO_MMIO_INT_VRING);
+	plic->gateway_trigger_interrupt(irq);
+}
+
+void VirtioMMIO::signal_config(void) {
+	isr.fetch_or(VIRTIO_MMIO_INT_CONFIG);
+	plic->gateway_trigger_interrupt(irq);
+}
+
+void VirtioMMIO::set_needs_reset(void) {
+	if (!needs_reset.exchange(true))
+		signal_config();
+}
+
+void VirtioMMIO::reset(void) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	for (auto &q : queues)
+		q.reset();
+	driver_features_bits = 0;
+	isr = 0;
+	needs_reset = false;
+	status = 0;
+
+	device_reset();
+}
+
+void VirtioMMIO::write_queue_reg(uint32_t *vptr, uint32_t value) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	if (queue_sel >= queues.size())
+		return; /* write is ignored */
+	VirtioQueue &q = queues[queue_sel];
+
+	/* the rings were validated for the configuration of a ready queue */
+	if (q.ready && vptr != &queue_ready)
+		return;
+
+	if (vptr == &queue_num) {
+		q.num = value;
+	} else if (vptr == &queue_ready) {
+		if (value && !q.ready)
+			q.start(&mem, has_feature(VIRTIO_F_RING_EVENT_IDX));
+		q.ready = value;
+	} else if (vptr == &queue_desc_low) {
+		q.desc_addr = (q.desc_addr & ~0xffffffffULL) | value;
+	} else if (vptr == &queue_desc_high) {
+		q.desc_addr = (q.desc_addr & 0xffffffffULL) | ((uint64_t)value << 32);
+	} else if (vptr == &queue_driver_low) {
+		q.driver_addr = (q.driver_addr & ~0xffffffffULL) | value;
+	} else if (vptr == &queue_driver_high) {
+		q.driver_addr = (q.driver_addr & 0xffffffffULL) | ((uint64_t)value << 32);
+	} else if (vptr == &queue_device_low) {
+		q.device_addr = (q.device_addr & ~0xffffffffULL) | value;
+	} else if (vptr == &queue_device_high) {
+		q.device_addr = (q.device_addr & 0xffffffffULL) | ((uint64_t)value << 32);
+	}
+}
+
+void VirtioMMIO::register_access_callback(const vp::map::register_access_t &r) {
+	uint32_t old_status = status;
+
+	if (r.read) {
+		if (r.vptr == &device_features_reg) {
+			uint64_t features = device_features() | (1ULL << VIRTIO_F_VERSION_1);
+			if (device_features_sel < 2)
+				device_features_reg = features >> (32 * device_features_sel);
+			else
+				device_features_reg = 0;
+		} else if (r.vptr == &queue_num_max) {
+			queue_num_max = (queue_sel < queues.size()) ? VIRTIO_QUEUE_MAX : 0;
+		} else if (r.vptr == &queue_ready) {
+			queue_ready = (queue_sel < queues.size()) ? queues[queue_sel].ready : 0;
+		} else if (r.vptr == &interrupt_status) {
+			interrupt_status = isr.load();
+		} else if (r.vptr == &status && needs_reset) {
+			status |= VIRTIO_STATUS_DEVICE_NEEDS_RESET;
+		}
+	}
+
+	r.fn();
+
+	if (!r.write)
+		return;
+
+	if (r.vptr == &driver_features) {
+		if (driver_features_sel < 2) {
+			uint64_t mask = 0xffffffffULL << (32 * driver_features_sel);
+			uint64_t bits = (uint64_t)driver_features << (32 * driver_features_sel);
+			driver_features_bits = (driver_features_bits & ~mask) | bits;
+		}
+	} else if (r.vptr == &queue_notify_reg) {
+		if (queue_notify_reg < queues.size())
+			queue_notify(queue_notify_reg);
+	} else if (r.vptr == &interrupt_ack) {
+		isr.fetch_and(~interrupt_ack);
+	} else if (r.vptr == &status) {
+		if (status == 0) {
+			reset();
+			return;
+		}
+
+		if (status & VIRTIO_STATUS_FEATURES_OK) {
+			uint64_t offered = device_features() | (1ULL << VIRTIO_F_VERSION_1);
+			if ((driver_features_bits & ~offered) || !has_feature(VIRTIO_F_VERSION_1))
+				status &= ~VIRTIO_STATUS_FEATURES_OK;
+		}
+
+		if ((status & VIRTIO_STATUS_DRIVER_OK) && !(old_status & VIRTIO_STATUS_DRIVER_OK)) {
+			std::lock_guard<std::mutex> lock(mtx);
+			driver_ok();
+		}
+	} else if (r.vptr == &queue_num || r.vptr == &queue_ready || r.vptr == &queue_desc_low ||
+	           r.vptr == &queue_desc_high || r.vptr == &queue_driver_low || r.vptr == &queue_driver_high ||
+	           r.vptr == &queue_device_low || r.vptr == &queue_device_high) {
+		write_queue_reg(r.vptr, r.nv);
+	}
+}
+
+void VirtioMMIO::config_access(tlm::tlm_generic_payload &trans, sc_core::sc_time &) {
+	vp::map::execute_memory_access(trans, config.data());
+
+	if (trans.get_command() == tlm::TLM_WRITE_COMMAND)
+		config_write(trans.get_address(), trans.get_data_length());
+}
+
+void VirtioMMIO::transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay) {
+	router.transport(trans, delay);
+}
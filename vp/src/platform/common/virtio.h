@@ -0,0 +1,198 @@
+#ifndef RISCV_VP_VIRTIO_H
+#define RISCV_VP_VIRTIO_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <systemc>
+#include <tlm_utils/simple_target_socket.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "core/common/dmi.h"
+#include "core/common/irq_if.h"
+#include "util/tlm_map.h"
+
+/* Feature bits independent of the device type, see section 6 of the
+ * virtio 1.1 specification. Device specific bits are below 24. */
+#define VIRTIO_F_RING_EVENT_IDX 29
+#define VIRTIO_F_VERSION_1 32
+
+/* maximum number of descriptors per virtqueue offered to the driver */
+#define VIRTIO_QUEUE_MAX 256
+
+class VirtioMMIO;
+
+/**
+ * Device side of a split virtqueue (virtio 1.1, section 2.6) located in
+ * guest memory. All rings are accessed directly through the DMI pointer,
+ * payload buffers are returned as iovecs pointing into guest memory, hence
+ * device implementations can hand them to readv(2)/writev(2) as is.
+ *
+ * A queue may be processed on an arbitrary host thread, but only on one
+ * at a time (see VirtioMMIO::mtx).
+ *
+ * Rings and requests written by the driver are not trusted. If they are
+ * malformed the queue is marked as failed, it is not processed any further
+ * and the device requests a reset from the driver.
+ */
+class VirtioQueue {
+	friend class VirtioMMIO;
+
+public:
+	/* One descriptor chain taken from the available ring */
+	struct Chain {
+		uint16_t head;
+		std::vector<struct iovec> out; /* device-readable buffers */
+		std::vector<struct iovec> in;  /* device-writable buffers */
+		size_t out_len;
+		size_t in_len;
+
+		/* copy from the readable and to the writable buffers,
+		 * respectively, the offset is relative to the first buffer */
+		size_t read(size_t, void *, size_t) const;
+		size_t write(size_t, const void *, size_t) const;
+	};
+
+	/* the part [offset, offset + length) of the given buffers */
+	static std::vector<struct iovec> slice(const std::vector<struct iovec> &, size_t, size_t);
+
+	/* configuration written by the driver through the transport */
+	uint32_t num = VIRTIO_QUEUE_MAX;
+	bool ready = false;
+	uint64_t desc_addr = 0;
+	uint64_t driver_addr = 0;
+	uint64_t device_addr = 0;
+
+	void reset(void);
+	void start(MemoryDMI *, bool);
+
+	/* true if the driver made buffers available which were not popped yet */
+	bool available(void);
+	/* false if no buffers are available or the chain is malformed */
+	bool pop(Chain &);
+	/* returns the chain popped last to the available ring */
+	void unpop(void);
+	void push(const Chain &, uint32_t);
+
+	/* Decides whether the driver wants to be interrupted for the
+	 * buffers pushed since the last call (honors event-idx). */
+	bool need_interrupt(void);
+
+	/* Marks the queue as failed due to the driver, the reason is logged */
+	void fail(const char *);
+
+private:
+	VirtioMMIO *device = nullptr;
+	MemoryDMI *mem = nullptr;
+	bool event_idx = false;
+	bool failed = false;
+
+	uint16_t last_avail = 0;
+	uint16_t used_idx = 0;
+	uint16_t signalled_used = 0;
+
+	void *guest_ptr(uint64_t, uint64_t);
+	uint16_t *avail_ring(unsigned);
+	bool add_buffer(Chain &, uint64_t, uint32_t, uint16_t);
+	bool add_indirect(Chain &, uint64_t, uint32_t);
+};
+
+/**
+ * Register interface of a virtio-mmio device (virtio 1.1, section 4.2.2,
+ * "modern" version 2 layout). Device types derive from this class, provide
+ * their feature bits and configuration space and process their queues.
+ * A device ID of zero denotes a placeholder without backend, which the
+ * driver skips.
+ *
+ * A stock Linux kernel finds the device through a device tree node like:
+ *
+ *	virtio@10020000 {
+ *		compatible = "virtio,mmio";
+ *		reg = <0x0 0x10020000 0x0 0x1000>;
+ *		interrupt-parent = <&plic>;
+ *		interrupts = <5>;
+ *	};
+ */
+class VirtioMMIO : public sc_core::sc_module {
+	friend class VirtioQueue;
+
+public:
+	interrupt_gateway *plic = nullptr;
+	tlm_utils::simple_target_socket<VirtioMMIO> tsock;
+
+	VirtioMMIO(sc_core::sc_module_name, uint32_t irq, MemoryDMI mem, uint32_t device_id, unsigned num_queues,
+	           size_t config_size);
+	virtual ~VirtioMMIO(void);
+
+	SC_HAS_PROCESS(VirtioMMIO);
+
+protected:
+	/* Serializes queue processing on host threads with queue
+	 * configuration and device resets issued by the driver. */
+	std::mutex mtx;
+
+	MemoryDMI mem;
+	std::vector<VirtioQueue> queues;
+	/* device specific configuration space, little endian */
+	std::vector<uint8_t> config;
+
+	bool has_feature(unsigned);
+	/* Thread-safe, raise an interrupt for used buffers or a
+	 * configuration change, respectively. */
+	void signal_used(VirtioQueue &);
+	void signal_config(void);
+
+private:
+	/* Called on the SystemC thread with mtx unlocked */
+	virtual uint64_t device_features(void) = 0;
+	virtual void queue_notify(unsigned) = 0;
+	/* Called on the SystemC thread with mtx locked */
+	virtual void device_reset(void) {}
+	virtual void driver_ok(void) {}
+	virtual void config_write(uint32_t, uint32_t) {}
+
+	void register_access_callback(const vp::map::register_access_t &);
+	void config_access(tlm::tlm_generic_payload &, sc_core::sc_time &);
+	void transport(tlm::tlm_generic_payload &, sc_core::sc_time &);
+	void write_queue_reg(uint32_t *, uint32_t);
+	void reset(void);
+	/* Thread-safe, called by a failed queue */
+	void set_needs_reset(void);
+
+	uint32_t irq;
+	uint64_t driver_features_bits = 0;
+	std::atomic<uint32_t> isr{0};
+	std::atomic<bool> needs_reset{false};
+
+	// memory mapped configuration registers
+	uint32_t magic_value = 0x74726976; /* "virt" */
+	uint32_t version = 2;
+	uint32_t device_id;
+	uint32_t vendor_id = 0;
+	uint32_t device_features_reg = 0;
+	uint32_t device_features_sel = 0;
+	uint32_t driver_features = 0;
+	uint32_t driver_features_sel = 0;
+	uint32_t queue_sel = 0;
+	uint32_t queue_num_max = 0;
+	uint32_t queue_num = 0;
+	uint32_t queue_ready = 0;
+	uint32_t queue_notify_reg = 0;
+	uint32_t interrupt_status = 0;
+	uint32_t interrupt_ack = 0;
+	uint32_t status = 0;
+	uint32_t queue_desc_low = 0;
+	uint32_t queue_desc_high = 0;
+	uint32_t queue_driver_low = 0;
+	uint32_t queue_driver_high = 0;
+	uint32_t queue_device_low = 0;
+	uint32_t queue_device_high = 0;
+	uint32_t config_generation = 0;
+
+	vp::map::LocalRouter router = {"VIRTIO"};
+};
+
+#endif  // RISCV_VP_VIRTIO_H
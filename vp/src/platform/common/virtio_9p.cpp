@@ -0,0 +1,998 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "virtio_9p.h"
+
+#define VIRTIO_ID_9P 9
+
+/* feature bits */
+#define VIRTIO_9P_MOUNT_TAG 0
+
+/* message types of 9P2000.L, replies are the request type plus one */
+enum {
+	P9_RLERROR = 7,
+	P9_TSTATFS = 8,
+	P9_TLOPEN = 12,
+	P9_TLCREATE = 14,
+	P9_TSYMLINK = 16,
+	P9_TMKNOD = 18,
+	P9_TRENAME = 20,
+	P9_TREADLINK = 22,
+	P9_TGETATTR = 24,
+	P9_TSETATTR = 26,
+	P9_TXATTRWALK = 30,
+	P9_TXATTRCREATE = 32,
+	P9_TREADDIR = 40,
+	P9_TFSYNC = 50,
+	P9_TLOCK = 52,
+	P9_TGETLOCK = 54,
+	P9_TLINK = 70,
+	P9_TMKDIR = 72,
+	P9_TRENAMEAT = 74,
+	P9_TUNLINKAT = 76,
+	P9_TVERSION = 100,
+	P9_TAUTH = 102,
+	P9_TATTACH = 104,
+	P9_TFLUSH = 108,
+	P9_TWALK = 110,
+	P9_TREAD = 116,
+	P9_TWRITE = 118,
+	P9_TCLUNK = 120,
+	P9_TREMOVE = 122,
+};
+
+/* size[4] type[1] tag[2] */
+#define P9_HDR_SIZE 7
+/* header of Twrite up to the payload: fid[4] offset[8] count[4] */
+#define P9_TWRITE_HDR_SIZE (P9_HDR_SIZE + 16)
+/* header of Rread up to the payload: count[4] */
+#define P9_RREAD_HDR_SIZE (P9_HDR_SIZE + 4)
+
+#define P9_MAX_MSIZE (512 * 1024)
+#define P9_MAX_WALK 16
+
+#define P9_QID_DIR 0x80
+#define P9_QID_SYMLINK 0x02
+
+#define P9_GETATTR_BASIC 0x000007ffULL
+
+#define P9_SETATTR_MODE 0x001
+#define P9_SETATTR_UID 0x002
+#define P9_SETATTR_GID 0x004
+#define P9_SETATTR_SIZE 0x008
+#define P9_SETATTR_ATIME 0x010
+#define P9_SETATTR_MTIME 0x020
+#define P9_SETATTR_ATIME_SET 0x080
+#define P9_SETATTR_MTIME_SET 0x100
+
+#define P9_LOCK_SUCCESS 0
+#define P9_LOCK_TYPE_UNLCK 2
+
+/* open flags of 9P2000.L match the generic Linux values, only pass
+ * those on which make sense for the host */
+#define P9_OPEN_FLAGS (O_ACCMODE | O_TRUNC | O_APPEND | O_DIRECTORY | O_NOFOLLOW | O_DSYNC | O_SYNC)
+
+/* Closes a descriptor when going out of scope */
+class DirFd {
+	int fd;
+
+public:
+	explicit DirFd(int fd) : fd(fd) {}
+	DirFd(const DirFd &) = delete;
+	DirFd &operator=(const DirFd &) = delete;
+
+	~DirFd(void) {
+		if (fd >= 0)
+			close(fd);
+	}
+
+	int get(void) const {
+		return fd;
+	}
+};
+
+/* Decodes the little endian fields of a request */
+class P9Reader {
+	std::vector<uint8_t> buf;
+	size_t pos = 0;
+
+	const uint8_t *take(size_t n) {
+		if (pos + n > buf.size())
+			throw std::system_error(EPROTO, std::generic_category());
+		pos += n;
+		return &buf[pos - n];
+	}
+
+public:
+	P9Reader(std::vector<uint8_t> &&buf) : buf(std::move(buf)) {}
+
+	uint8_t u8(void) {
+		return *take(1);
+	}
+
+	uint16_t u16(void) {
+		uint16_t v;
+		memcpy(&v, take(sizeof(v)), sizeof(v));
+		return v;
+	}
+
+	uint32_t u32(void) {
+		uint32_t v;
+		memcpy(&v, take(sizeof(v)), sizeof(v));
+		return v;
+	}
+
+	uint64_t u64(void) {
+		uint64_t v;
+		memcpy(&v, take(sizeof(v)), sizeof(v));
+		return v;
+	}
+
+	std::string str(void) {
+		uint16_t len = u16();
+		return std::string((const char *)take(len), len);
+	}
+};
+
+/* Encodes the little endian fields of a reply */
+class P9Writer {
+public:
+	std::vector<uint8_t> buf = std::vector<uint8_t>(P9_HDR_SIZE);
+
+	void put(const void *p, size_t n) {
+		buf.insert(buf.end(), (const uint8_t *)p, (const uint8_t *)p + n);
+	}
+
+	void u8(uint8_t v) {
+		put(&v, sizeof(v));
+	}
+
+	void u16(uint16_t v) {
+		put(&v, sizeof(v));
+	}
+
+	void u32(uint32_t v) {
+		put(&v, sizeof(v));
+	}
+
+	void u64(uint64_t v) {
+		put(&v, sizeof(v));
+	}
+
+	void str(const std::string &s) {
+		u16(s.size());
+		put(s.data(), s.size());
+	}
+
+	void qid(const struct stat &st) {
+		uint8_t type = 0;
+		if (S_ISDIR(st.st_mode))
+			type = P9_QID_DIR;
+		else if (S_ISLNK(st.st_mode))
+			type = P9_QID_SYMLINK;
+
+		u8(type);
+		u32(st.st_mtime ^ st.st_size);
+		u64(st.st_ino);
+	}
+
+	void finish(uint8_t type, uint16_t tag, uint32_t size) {
+		memcpy(&buf[0], &size, sizeof(size));
+		buf[4] = type;
+		memcpy(&buf[5], &tag, sizeof(tag));
+	}
+};
+
+Virtio9P::Virtio9P(sc_core::sc_module_name name, uint32_t irqsrc, MemoryDMI mem, std::string dir, std::string tag)
+    : VirtioMMIO(name, irqsrc, mem, dir.empty() ? 0 : VIRTIO_ID_9P, 1, 2 + tag.size()) {
+	uint16_t len = tag.size();
+	memcpy(&config[0], &len, sizeof(len));
+	memcpy(&config[2], tag.data(), tag.size());
+
+	if (dir.empty())
+		return;
+
+	if ((root = open(dir.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC)) == -1) {
+		if (errno == ENOTDIR)
+			throw std::runtime_error(dir + " is not a directory");
+		throw std::system_error(errno, std::generic_category());
+	}
+}
+
+Virtio9P::~Virtio9P(void) {
+	clunk_all();
+	if (root >= 0)
+		close(root);
+}
+
+uint64_t Virtio9P::device_features(void) {
+	return (1ULL << VIRTIO_9P_MOUNT_TAG) | (1ULL << VIRTIO_F_RING_EVENT_IDX);
+}
+
+void Virtio9P::device_reset(void) {
+	clunk_all();
+}
+
+void Virtio9P::queue_notify(unsigned idx) {
+	std::lock_guard<std::mutex> lock(mtx);
+	VirtioQueue &q = queues[idx];
+	VirtioQueue::Chain chain;
+
+	while (q.pop(chain)) {
+		uint32_t len = 0;
+		if (!handle(chain, len)) {
+			q.fail("virtio-9p: malformed request");
+			break;
+		}
+		q.push(chain, len);
+	}
+
+	signal_used(q);
+}
+
+/* false if the request has no complete header */
+bool Virtio9P::handle(const VirtioQueue::Chain &chain, uint32_t &len) {
+	uint8_t hdr[P9_HDR_SIZE];
+	if (chain.read(0, hdr, sizeof(hdr)) != sizeof(hdr))
+		return false;
+
+	uint32_t size;
+	uint16_t tag;
+	uint8_t type = hdr[4];
+	memcpy(&size, &hdr[0], sizeof(size));
+	memcpy(&tag, &hdr[5], sizeof(tag));
+
+	/* the payload of Twrite is not copied */
+	size_t n = std::min((size_t)size, chain.out_len);
+	if (type == P9_TWRITE)
+		n = std::min(n, (size_t)P9_TWRITE_HDR_SIZE);
+
+	std::vector<uint8_t> req(n);
+	chain.read(0, req.data(), n);
+
+	P9Reader r(std::move(req));
+	P9Writer w;
+	int err;
+	try {
+		r.u32();
+		r.u8();
+		r.u16();
+		err = dispatch(type, r, w, chain);
+	} catch (std::system_error &e) {
+		err = e.code().value();
+	}
+
+	if (err) {
+		w.buf.resize(P9_HDR_SIZE);
+		w.u32(err);
+		type = P9_RLERROR - 1;
+	}
+
+	/* Rread carries the payload written in place behind the header */
+	size_t total = w.buf.size();
+	if (type == P9_TREAD && !err) {
+		uint32_t count;
+		memcpy(&count, &w.buf[P9_HDR_SIZE], sizeof(count));
+		total += count;
+	}
+
+	w.finish(type + 1, tag, total);
+	chain.write(0, w.buf.data(), w.buf.size());
+	len = std::min(total, chain.in_len);
+	return true;
+}
+
+int Virtio9P::dispatch(uint8_t type, P9Reader &r, P9Writer &w, const VirtioQueue::Chain &chain) {
+	switch (type) {
+		case P9_TVERSION:
+			return version(r, w);
+		case P9_TATTACH:
+			return attach(r, w);
+		case P9_TWALK:
+			return walk(r, w);
+		case P9_TLOPEN:
+			return lopen(r, w);
+		case P9_TLCREATE:
+			return lcreate(r, w);
+		case P9_TREAD:
+			return read(r, w, chain);
+		case P9_TWRITE:
+			return write(r, w, chain);
+		case P9_TCLUNK:
+			return clunk(r, w, false);
+		case P9_TREMOVE:
+			return clunk(r, w, true);
+		case P9_TGETATTR:
+			return getattr(r, w);
+		case P9_TSETATTR:
+			return setattr(r, w);
+		case P9_TREADDIR:
+			return readdir(r, w);
+		case P9_TSTATFS:
+			return statfs(r, w);
+		case P9_TMKDIR:
+			return mkdir(r, w);
+		case P9_TSYMLINK:
+			return symlink(r, w);
+		case P9_TMKNOD:
+			return mknod(r, w);
+		case P9_TREADLINK:
+			return readlink(r, w);
+		case P9_TLINK:
+			return link(r, w);
+		case P9_TRENAME:
+			return rename(r, w);
+		case P9_TRENAMEAT:
+			return renameat(r, w);
+		case P9_TUNLINKAT:
+			return unlinkat(r, w);
+		case P9_TFSYNC:
+			return fsync(r, w);
+		case P9_TLOCK:
+			return lock(r, w);
+		case P9_TGETLOCK:
+			return getlock(r, w);
+		case P9_TFLUSH:
+			/* requests are completed synchronously, nothing to abort */
+			return 0;
+		case P9_TAUTH:
+		case P9_TXATTRWALK:
+		case P9_TXATTRCREATE:
+		default:
+			return EOPNOTSUPP;
+	}
+}
+
+/* Opens the directory containing path, which walk_name keeps free of "."
+ * and "..", relative to the exported directory. No component is followed
+ * if it is a symbolic link, hence the directory never leaves the exported
+ * one. Returns the directory, or -1 with errno set, and the last component
+ * to be passed to the *at() calls, "." for the exported directory itself. */
+int Virtio9P::open_parent(const std::string &path, std::string &name) {
+	if (path.empty()) {
+		name = ".";
+		return fcntl(root, F_DUPFD_CLOEXEC, 0);
+	}
+
+	int dir = root;
+	size_t begin = 0, end;
+	while ((end = path.find('/', begin)) != std::string::npos) {
+		int next = openat(dir, path.substr(begin, end - begin).c_str(),
+		                  O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		int err = errno;
+		if (dir != root)
+			close(dir);
+		if (next == -1) {
+			errno = err;
+			return -1;
+		}
+		dir = next;
+		begin = end + 1;
+	}
+
+	name = path.substr(begin);
+	return dir == root ? fcntl(root, F_DUPFD_CLOEXEC, 0) : dir;
+}
+
+int Virtio9P::stat_path(const std::string &path, struct stat &st) {
+	std::string name;
+	DirFd dir(open_parent(path, name));
+	if (dir.get() == -1 || fstatat(dir.get(), name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == -1)
+		return errno;
+	return 0;
+}
+
+Virtio9P::Fid *Virtio9P::get_fid(uint32_t fid) {
+	auto it = fids.find(fid);
+	if (it == fids.end())
+		throw std::system_error(EBADF, std::generic_category());
+	return &it->second;
+}
+
+void Virtio9P::close_fid(Fid &f) {
+	if (f.dir)
+		closedir(f.dir); /* also closes f.fd */
+	else if (f.fd >= 0)
+		close(f.fd);
+	f.dir = nullptr;
+	f.fd = -1;
+}
+
+void Virtio9P::clunk_all(void) {
+	for (auto &e : fids)
+		close_fid(e.second);
+	fids.clear();
+}
+
+/* Resolves one path component lexically, the resulting path has no "." or
+ * ".." components and never names anything above the exported directory */
+int Virtio9P::walk_name(const std::string &dir, const std::string &name, std::string &result) {
+	if (name.empty() || name.find('/') != std::string::npos)
+		return EINVAL;
+
+	if (name == ".") {
+		result = dir;
+	} else if (name == "..") {
+		size_t pos = dir.rfind('/');
+		result = (pos == std::string::npos) ? "" : dir.substr(0, pos);
+	} else {
+		result = dir.empty() ? name : dir + "/" + name;
+	}
+
+	return 0;
+}
+
+int Virtio9P::put_qid(P9Writer &w, const std::string &path) {
+	struct stat st;
+	int err = stat_path(path, st);
+	if (!err)
+		w.qid(st);
+	return err;
+}
+
+int Virtio9P::version(P9Reader &r, P9Writer &w) {
+	uint32_t size = r.u32();
+	std::string v = r.str();
+
+	/* a version request aborts all outstanding I/O */
+	clunk_all();
+
+	msize = std::min(size, (uint32_t)P9_MAX_MSIZE);
+	w.u32(msize);
+	w.str(v == "9P2000.L" ? v : "unknown");
+	return 0;
+}
+
+int Virtio9P::attach(P9Reader &r, P9Writer &w) {
+	uint32_t fid = r.u32();
+	if (fids.count(fid))
+		return EBADF;
+
+	int err = put_qid(w, "");
+	if (!err)
+		fids[fid] = Fid();
+	return err;
+}
+
+int Virtio9P::walk(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	uint32_t newfid = r.u32();
+	uint16_t nwname = r.u16();
+	if (nwname > P9_MAX_WALK)
+		return EINVAL;
+
+	std::string path = f->path;
+	std::vector<struct stat> qids;
+	for (uint16_t i = 0; i < nwname; i++) {
+		std::string next;
+		int err = walk_name(path, r.str(), next);
+		if (err)
+			return err;
+
+		struct stat st;
+		if ((err = stat_path(next, st))) {
+			if (i == 0)
+				return err;
+			break; /* partial walk, newfid is not created */
+		}
+
+		qids.push_back(st);
+		path = next;
+	}
+
+	if (qids.size() == nwname) {
+		/* newfid may only be in use if it equals fid */
+		auto it = fids.find(newfid);
+		if (it != fids.end()) {
+			if (&it->second != f)
+				return EBADF;
+			close_fid(*f);
+		}
+
+		Fid nf;
+		nf.path = path;
+		fids[newfid] = nf;
+	}
+
+	w.u16(qids.size());
+	for (auto &st : qids)
+		w.qid(st);
+	return 0;
+}
+
+int Virtio9P::lopen(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	uint32_t flags = r.u32() & P9_OPEN_FLAGS;
+	if (f->fd >= 0)
+		return EBADF;
+
+	std::string name;
+	DirFd dir(open_parent(f->path, name));
+	struct stat st;
+	if (dir.get() == -1 || fstatat(dir.get(), name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == -1)
+		return errno;
+
+	if (S_ISDIR(st.st_mode)) {
+		if ((f->fd = openat(dir.get(), name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) == -1)
+			return errno;
+		if (!(f->dir = fdopendir(f->fd))) {
+			int err = errno;
+			close(f->fd);
+			f->fd = -1;
+			return err;
+		}
+	} else if ((f->fd = openat(dir.get(), name.c_str(), flags | O_NOFOLLOW | O_CLOEXEC)) == -1) {
+		return errno;
+	}
+
+	w.qid(st);
+	w.u32(0); /* iounit, the client falls back to msize */
+	return 0;
+}
+
+int Virtio9P::lcreate(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	std::string name = r.str();
+	uint32_t flags = r.u32() & P9_OPEN_FLAGS;
+	uint32_t mode = r.u32();
+	if (f->fd >= 0)
+		return EBADF;
+
+	std::string path;
+	int err = walk_name(f->path, name, path);
+	if (err)
+		return err;
+
+	std::string last;
+	DirFd dir(open_parent(path, last));
+	if (dir.get() == -1)
+		return errno;
+	int fd = openat(dir.get(), last.c_str(), flags | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, mode & 07777);
+	if (fd == -1)
+		return errno;
+
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+
+	/* fid now represents the new, opened file */
+	f->path = path;
+	f->fd = fd;
+	w.qid(st);
+	w.u32(0);
+	return 0;
+}
+
+int Virtio9P::read(P9Reader &r, P9Writer &w, const VirtioQueue::Chain &chain) {
+	Fid *f = get_fid(r.u32());
+	uint64_t offset = r.u64();
+	uint32_t count = r.u32();
+	if (f->fd < 0 || f->dir)
+		return EBADF;
+
+	size_t room = chain.in_len > P9_RREAD_HDR_SIZE ? chain.in_len - P9_RREAD_HDR_SIZE : 0;
+	count = std::min({(size_t)count, room, (size_t)(msize - P9_RREAD_HDR_SIZE)});
+
+	/* directly into the guest buffers behind the reply header */
+	std::vector<struct iovec> iov = VirtioQueue::slice(chain.in, P9_RREAD_HDR_SIZE, count);
+	ssize_t n = preadv(f->fd, iov.data(), iov.size(), offset);
+	if (n == -1)
+		return errno;
+
+	w.u32(n);
+	return 0;
+}
+
+int Virtio9P::write(P9Reader &r, P9Writer &w, const VirtioQueue::Chain &chain) {
+	Fid *f = get_fid(r.u32());
+	uint64_t offset = r.u64();
+	uint32_t count = r.u32();
+	if (f->fd < 0 || f->dir)
+		return EBADF;
+	if (count > chain.out_len - P9_TWRITE_HDR_SIZE)
+		return EPROTO;
+
+	/* directly from the guest buffers behind the request header */
+	std::vector<struct iovec> iov = VirtioQueue::slice(chain.out, P9_TWRITE_HDR_SIZE, count);
+	ssize_t n = pwritev(f->fd, iov.data(), iov.size(), offset);
+	if (n == -1)
+		return errno;
+
+	w.u32(n);
+	return 0;
+}
+
+int Virtio9P::clunk(P9Reader &r, P9Writer &, bool remove) {
+	uint32_t fid = r.u32();
+	Fid *f = get_fid(fid);
+	int err = 0;
+
+	if (remove && f->path.empty()) {
+		err = EBUSY;
+	} else if (remove) {
+		std::string name;
+		DirFd dir(open_parent(f->path, name));
+		struct stat st;
+		if (dir.get() == -1 || fstatat(dir.get(), name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == -1 ||
+		    ::unlinkat(dir.get(), name.c_str(), S_ISDIR(st.st_mode) ? AT_REMOVEDIR : 0) == -1)
+			err = errno;
+	}
+
+	/* the fid is clunked even if the remove failed */
+	close_fid(*f);
+	fids.erase(fid);
+	return err;
+}
+
+int Virtio9P::getattr(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	r.u64(); /* request mask, all basic fields are always returned */
+
+	struct stat st;
+	int err = stat_path(f->path, st);
+	if (err)
+		return err;
+
+	w.u64(P9_GETATTR_BASIC);
+	w.qid(st);
+	w.u32(st.st_mode);
+	w.u32(st.st_uid);
+	w.u32(st.st_gid);
+	w.u64(st.st_nlink);
+	w.u64(st.st_rdev);
+	w.u64(st.st_size);
+	w.u64(st.st_blksize);
+	w.u64(st.st_blocks);
+	w.u64(st.st_atim.tv_sec);
+	w.u64(st.st_atim.tv_nsec);
+	w.u64(st.st_mtim.tv_sec);
+	w.u64(st.st_mtim.tv_nsec);
+	w.u64(st.st_ctim.tv_sec);
+	w.u64(st.st_ctim.tv_nsec);
+	for (int i = 0; i < 4; i++)
+		w.u64(0); /* btime, gen and data_version are not available */
+	return 0;
+}
+
+int Virtio9P::setattr(P9Reader &r, P9Writer &) {
+	Fid *f = get_fid(r.u32());
+	uint32_t valid = r.u32();
+	uint32_t mode = r.u32();
+	r.u32(); /* uid and gid, ownership is not emulated */
+	r.u32();
+	uint64_t size = r.u64();
+	struct timespec times[2];
+	times[0].tv_sec = r.u64();
+	times[0].tv_nsec = r.u64();
+	times[1].tv_sec = r.u64();
+	times[1].tv_nsec = r.u64();
+
+	std::string name;
+	DirFd dir(open_parent(f->path, name));
+	if (dir.get() == -1)
+		return errno;
+
+	/* fchmodat(2) follows symbolic links, as requests are served one at a
+	 * time the guest cannot replace the checked entry in between */
+	if (valid & P9_SETATTR_MODE) {
+		struct stat st;
+		if (fstatat(dir.get(), name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == -1)
+			return errno;
+		if (S_ISLNK(st.st_mode))
+			return EOPNOTSUPP;
+		if (fchmodat(dir.get(), name.c_str(), mode & 07777, 0) == -1)
+			return errno;
+	}
+
+	if (valid & P9_SETATTR_SIZE) {
+		int fd = openat(dir.get(), name.c_str(), O_WRONLY | O_NOFOLLOW | O_CLOEXEC);
+		if (fd == -1)
+			return errno;
+		int ret = ftruncate(fd, size);
+		int err = errno;
+		close(fd);
+		if (ret == -1)
+			return err;
+	}
+
+	if (valid & (P9_SETATTR_ATIME | P9_SETATTR_MTIME)) {
+		if (!(valid & P9_SETATTR_ATIME))
+			times[0].tv_nsec = UTIME_OMIT;
+		else if (!(valid & P9_SETATTR_ATIME_SET))
+			times[0].tv_nsec = UTIME_NOW;
+		if (!(valid & P9_SETATTR_MTIME))
+			times[1].tv_nsec = UTIME_OMIT;
+		else if (!(valid & P9_SETATTR_MTIME_SET))
+			times[1].tv_nsec = UTIME_NOW;
+
+		if (utimensat(dir.get(), name.c_str(), times, AT_SYMLINK_NOFOLLOW) == -1)
+			return errno;
+	}
+
+	return 0;
+}
+
+int Virtio9P::readdir(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	uint64_t offset = r.u64();
+	uint32_t count = std::min(r.u32(), msize - P9_RREAD_HDR_SIZE);
+	if (!f->dir)
+		return EBADF;
+
+	/* offsets are the telldir(3) cookies returned with each entry */
+	if (offset == 0)
+		rewinddir(f->dir);
+	else
+		seekdir(f->dir, offset);
+
+	P9Writer entries;
+	entries.buf.clear();
+	for (;;) {
+		long pos = telldir(f->dir);
+		errno = 0;
+		struct dirent *d = ::readdir(f->dir);
+		if (!d) {
+			if (errno)
+				return errno;
+			break;
+		}
+
+		std::string name = d->d_name;
+		size_t len = 13 + 8 + 1 + 2 + name.size();
+		if (entries.buf.size() + len > count) {
+			seekdir(f->dir, pos); /* returned with the next request */
+			break;
+		}
+
+		struct stat st;
+		memset(&st, 0, sizeof(st));
+		st.st_ino = d->d_ino;
+		st.st_mode = (d->d_type == DT_DIR) ? S_IFDIR : (d->d_type == DT_LNK) ? S_IFLNK : S_IFREG;
+
+		entries.qid(st);
+		entries.u64(telldir(f->dir));
+		entries.u8(d->d_type);
+		entries.str(name);
+	}
+
+	w.u32(entries.buf.size());
+	w.put(entries.buf.data(), entries.buf.size());
+	return 0;
+}
+
+int Virtio9P::statfs(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+
+	std::string name;
+	DirFd dir(open_parent(f->path, name));
+	if (dir.get() == -1)
+		return errno;
+	DirFd file(openat(dir.get(), name.c_str(), O_PATH | O_NOFOLLOW | O_CLOEXEC));
+	struct statfs st;
+	if (file.get() == -1 || fstatfs(file.get(), &st) == -1)
+		return errno;
+
+	uint64_t fsid;
+	memcpy(&fsid, &st.f_fsid, sizeof(fsid));
+
+	w.u32(st.f_type);
+	w.u32(st.f_bsize);
+	w.u64(st.f_blocks);
+	w.u64(st.f_bfree);
+	w.u64(st.f_bavail);
+	w.u64(st.f_files);
+	w.u64(st.f_ffree);
+	w.u64(fsid);
+	w.u32(st.f_namelen);
+	return 0;
+}
+
+int Virtio9P::mkdir(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	std::string name = r.str();
+	uint32_t mode = r.u32();
+
+	std::string path;
+	int err = walk_name(f->path, name, path);
+	if (err)
+		return err;
+
+	std::string last;
+	DirFd dir(open_parent(path, last));
+	if (dir.get() == -1 || mkdirat(dir.get(), last.c_str(), mode & 07777) == -1)
+		return errno;
+	return put_qid(w, path);
+}
+
+int Virtio9P::symlink(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	std::string name = r.str();
+	std::string target = r.str();
+
+	std::string path;
+	int err = walk_name(f->path, name, path);
+	if (err)
+		return err;
+
+	/* the target is stored as is, it is never resolved on the host */
+	std::string last;
+	DirFd dir(open_parent(path, last));
+	if (dir.get() == -1 || symlinkat(target.c_str(), dir.get(), last.c_str()) == -1)
+		return errno;
+	return put_qid(w, path);
+}
+
+int Virtio9P::mknod(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+	std::string name = r.str();
+	uint32_t mode = r.u32();
+	r.u32(); /* major and minor, only FIFOs and sockets are created */
+	r.u32();
+
+	/* device nodes would give the guest access to host devices */
+	if (!S_ISFIFO(mode) && !S_ISSOCK(mode))
+		return EPERM;
+
+	std::string path;
+	int err = walk_name(f->path, name, path);
+	if (err)
+		return err;
+
+	std::string last;
+	DirFd dir(open_parent(path, last));
+	if (dir.get() == -1 || mknodat(dir.get(), last.c_str(), mode & (S_IFMT | 07777), 0) == -1)
+		return errno;
+	return put_qid(w, path);
+}
+
+int Virtio9P::readlink(P9Reader &r, P9Writer &w) {
+	Fid *f = get_fid(r.u32());
+
+	std::string name;
+	DirFd dir(open_parent(f->path, name));
+	if (dir.get() == -1)
+		return errno;
+
+	char buf[PATH_MAX];
+	ssize_t n = readlinkat(dir.get(), name.c_str(), buf, sizeof(buf));
+	if (n == -1)
+		return errno;
+
+	w.str(std::string(buf, n));
+	return 0;
+}
+
+int Virtio9P::link(P9Reader &r, P9Writer &) {
+	Fid *dir = get_fid(r.u32());
+	Fid *f = get_fid(r.u32());
+	std::string name = r.str();
+
+	std::string path;
+	int err = walk_name(dir->path, name, path);
+	if (err)
+		return err;
+
+	/* linkat(2) does not follow a symbolic link without AT_SYMLINK_FOLLOW */
+	std::string oldname, newname;
+	DirFd olddir(open_parent(f->path, oldname));
+	if (olddir.get() == -1)
+		return errno;
+	DirFd newdir(open_parent(path, newname));
+	if (newdir.get() == -1 || linkat(olddir.get(), oldname.c_str(), newdir.get(), newname.c_str(), 0) == -1)
+		return errno;
+	return 0;
+}
+
+int Virtio9P::rename(P9Reader &r, P9Writer &) {
+	Fid *f = get_fid(r.u32());
+	Fid *dir = get_fid(r.u32());
+	std::string name = r.str();
+
+	std::string path;
+	int err = walk_name(dir->path, name, path);
+	if (err)
+		return err;
+
+	std::string oldname, newname;
+	DirFd olddir(open_parent(f->path, oldname));
+	if (olddir.get() == -1)
+		return errno;
+	DirFd newdir(open_parent(path, newname));
+	if (newdir.get() == -1 || ::renameat(olddir.get(), oldname.c_str(), newdir.get(), newname.c_str()) == -1)
+		return errno;
+	f->path = path;
+	return 0;
+}
+
+int Virtio9P::renameat(P9Reader &r, P9Writer &) {
+	Fid *olddir = get_fid(r.u32());
+	std::string oldname = r.str();
+	Fid *newdir = get_fid(r.u32());
+	std::string newname = r.str();
+
+	std::string oldpath, newpath;
+	int err = walk_name(olddir->path, oldname, oldpath);
+	if (!err)
+		err = walk_name(newdir->path, newname, newpath);
+	if (err)
+		return err;
+
+	std::string oldlast, newlast;
+	DirFd old(open_parent(oldpath, oldlast));
+	if (old.get() == -1)
+		return errno;
+	DirFd dir(open_parent(newpath, newlast));
+	if (dir.get() == -1 || ::renameat(old.get(), oldlast.c_str(), dir.get(), newlast.c_str()) == -1)
+		return errno;
+	return 0;
+}
+
+int Virtio9P::unlinkat(P9Reader &r, P9Writer &) {
+	Fid *dir = get_fid(r.u32());
+	std::string name = r.str();
+	uint32_t flags = r.u32();
+
+	std::string path;
+	int err = walk_name(dir->path, name, path);
+	if (err)
+		return err;
+
+	std::string last;
+	DirFd parent(open_parent(path, last));
+	if (parent.get() == -1 || ::unlinkat(parent.get(), last.c_str(), flags & AT_REMOVEDIR) == -1)
+		return errno;
+	return 0;
+}
+
+int Virtio9P::fsync(P9Reader &r, P9Writer &) {
+	Fid *f = get_fid(r.u32());
+	uint32_t datasync = r.u32();
+	if (f->fd < 0)
+		return EBADF;
+
+	if ((datasync ? fdatasync(f->fd) : ::fsync(f->fd)) == -1)
+		return errno;
+	return 0;
+}
+
+int Virtio9P::lock(P9Reader &r, P9Writer &w) {
+	get_fid(r.u32());
+
+	/* locks are not emulated, every request succeeds */
+	w.u8(P9_LOCK_SUCCESS);
+	return 0;
+}
+
+int Virtio9P::getlock(P9Reader &r, P9Writer &w) {
+	get_fid(r.u32());
+	r.u8();
+	uint64_t start = r.u64();
+	uint64_t length = r.u64();
+	uint32_t proc_id = r.u32();
+	std::string client_id = r.str();
+
+	w.u8(P9_LOCK_TYPE_UNLCK);
+	w.u64(start);
+	w.u64(length);
+	w.u32(proc_id);
+	w.str(client_id);
+	return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef RISCV_VP_VIRTIO_9P_H
+#define RISCV_VP_VIRTIO_9P_H
+
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+
+#include "virtio.h"
+
+class P9Reader;
+class P9Writer;
+
+/**
+ * virtio 9P transport (device ID 9) exporting a host directory
+ * with the 9P2000.L protocol. In the guest:
+ *
+ *	mount -t 9p -o trans=virtio,version=9p2000.L <tag> /mnt
+ *
+ * Requests are served synchronously when the driver notifies the queue.
+ * The payload of Tread/Twrite is transferred with preadv(2)/pwritev(2)
+ * directly between the host file and the guest buffers.
+ *
+ * Paths are resolved component by component relative to the exported
+ * directory without following symbolic links on the host, the guest can
+ * create them but they are only interpreted by the guest. The guest may
+ * only create FIFOs and sockets with Tmknod, no device nodes. Ownership and
+ * locks are not emulated. If no directory is configured the device reports
+ * device ID zero, which the driver ignores.
+ */
+class Virtio9P : public VirtioMMIO {
+public:
+	Virtio9P(sc_core::sc_module_name, uint32_t, MemoryDMI, std::string, std::string = "hostshare");
+	~Virtio9P(void);
+
+private:
+	struct Fid {
+		std::string path; /* relative to the exported directory, empty for the root */
+		int fd = -1;
+		DIR *dir = nullptr;
+	};
+
+	int root = -1; /* O_PATH descriptor of the exported directory */
+	std::map<uint32_t, Fid> fids;
+	uint32_t msize = 8192;
+
+	uint64_t device_features(void) override;
+	void queue_notify(unsigned) override;
+	void device_reset(void) override;
+
+	bool handle(const VirtioQueue::Chain &, uint32_t &);
+	int dispatch(uint8_t, P9Reader &, P9Writer &, const VirtioQueue::Chain &);
+
+	int open_parent(const std::string &, std::string &);
+	int stat_path(const std::string &, struct stat &);
+	Fid *get_fid(uint32_t);
+	void close_fid(Fid &);
+	void clunk_all(void);
+	int walk_name(const std::string &, const std::string &, std::string &);
+	int put_qid(P9Writer &, const std::string &);
+
+	int version(P9Reader &, P9Writer &);
+	int attach(P9Reader &, P9Writer &);
+	int walk(P9Reader &, P9Writer &);
+	int lopen(P9Reader &, P9Writer &);
+	int lcreate(P9Reader &, P9Writer &);
+	int read(P9Reader &, P9Writer &, const VirtioQueue::Chain &);
+	int write(P9Reader &, P9Writer &, const VirtioQueue::Chain &);
+	int clunk(P9Reader &, P9Writer &, bool);
+	int getattr(P9Reader &, P9Writer &);
+	int setattr(P9Reader &, P9Writer &);
+	int readdir(P9Reader &, P9Writer &);
+	int statfs(P9Reader &, P9Writer &);
+	int mkdir(P9Reader &, P9Writer &);
+	int symlink(P9Reader &, P9Writer &);
+	int mknod(P9Reader &, P9Writer &);
+	int readlink(P9Reader &, P9Writer &);
+	int link(P9Reader &, P9Writer &);
+	int rename(P9Reader &, P9Writer &);
+	int renameat(P9Reader &, P9Writer &);
+	int unlinkat(P9Reader &, P9Writer &);
+	int fsync(P9Reader &, P9Writer &);
+	int lock(P9Reader &, P9Writer &);
+	int getlock(P9Reader &, P9Writer &);
+};
+
+#endif  // RISCV_VP_VIRTIO_9P_H
@@ -0,0 +1,288 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include "virtio_blk.h"
+
+#define VIRTIO_ID_BLOCK 2
+
+/* feature bits, see section 5.2.3 */
+#define VIRTIO_BLK_F_SEG_MAX 2
+#define VIRTIO_BLK_F_RO 5
+#define VIRTIO_BLK_F_BLK_SIZE 6
+#define VIRTIO_BLK_F_FLUSH 9
+
+/* request types and status values, see section 5.2.6 */
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_T_FLUSH 4
+#define VIRTIO_BLK_T_GET_ID 8
+
+#define VIRTIO_BLK_S_OK 0
+#define VIRTIO_BLK_S_IOERR 1
+#define VIRTIO_BLK_S_UNSUPP 2
+
+#define VIRTIO_BLK_ID_BYTES 20
+
+#define SECTOR_SIZE 512
+/* granularity of the copy-on-write overlay */
+#define CLUSTER_SIZE 4096
+
+/* layout of the configuration space */
+enum {
+	CONFIG_CAPACITY = 0,
+	CONFIG_SIZE_MAX = 8,
+	CONFIG_SEG_MAX = 12,
+	CONFIG_GEOMETRY = 16,
+	CONFIG_BLK_SIZE = 20,
+	CONFIG_SIZE = 24,
+};
+
+/* header of every request, located in the device-readable buffers */
+struct virtio_blk_req {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t sector;
+};
+
+static void *map_file(int fd, size_t len, int prot) {
+	void *p = mmap(NULL, len, prot, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		throw std::system_error(errno, std::generic_category());
+	return p;
+}
+
+VirtioBlock::VirtioBlock(sc_core::sc_module_name name, uint32_t irqsrc, MemoryDMI mem, std::string path,
+                         std::string overlay_path)
+    : VirtioMMIO(name, irqsrc, mem, path.empty() ? 0 : VIRTIO_ID_BLOCK, 1, CONFIG_SIZE) {
+	if (path.empty())
+		return;
+
+	open_image(path);
+	if (!overlay_path.empty())
+		open_overlay(overlay_path);
+
+	uint64_t capacity = size / SECTOR_SIZE;
+	uint32_t seg_max = VIRTIO_QUEUE_MAX - 2; /* minus header and status */
+	uint32_t blk_size = SECTOR_SIZE;
+	memcpy(&config[CONFIG_CAPACITY], &capacity, sizeof(capacity));
+	memcpy(&config[CONFIG_SEG_MAX], &seg_max, sizeof(seg_max));
+	memcpy(&config[CONFIG_BLK_SIZE], &blk_size, sizeof(blk_size));
+}
+
+VirtioBlock::~VirtioBlock(void) {
+	if (overlay) {
+		munmap(overlay, overlay_size);
+		close(overlayfd);
+	}
+	if (image) {
+		munmap(image, size);
+		close(imgfd);
+	}
+}
+
+void VirtioBlock::open_image(const std::string &path) {
+	if ((imgfd = open(path.c_str(), O_RDWR | O_CLOEXEC)) == -1) {
+		if (errno != EACCES && errno != EROFS)
+			throw std::system_error(errno, std::generic_category());
+		if ((imgfd = open(path.c_str(), O_RDONLY | O_CLOEXEC)) == -1)
+			throw std::system_error(errno, std::generic_category());
+		readonly = true;
+	}
+
+	struct stat st;
+	if (fstat(imgfd, &st) == -1)
+		throw std::system_error(errno, std::generic_category());
+	size = st.st_size - st.st_size % SECTOR_SIZE;
+	if (size == 0)
+		throw std::runtime_error("disk image " + path + " is smaller than one sector");
+
+	image = (uint8_t *)map_file(imgfd, size, PROT_READ);
+}
+
+void VirtioBlock::open_overlay(const std::string &path) {
+	if ((overlayfd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	uint64_t clusters = (size + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+	overlay_size = size + (clusters + 7) / 8;
+
+	struct stat st;
+	if (fstat(overlayfd, &st) == -1)
+		throw std::system_error(errno, std::generic_category());
+	if (st.st_size == 0) {
+		if (ftruncate(overlayfd, overlay_size) == -1)
+			throw std::system_error(errno, std::generic_category());
+	} else if ((uint64_t)st.st_size != overlay_size) {
+		throw std::runtime_error("overlay " + path + " does not match the disk image");
+	}
+
+	overlay = (uint8_t *)map_file(overlayfd, overlay_size, PROT_READ | PROT_WRITE);
+	present = overlay + size;
+	readonly = false;
+}
+
+uint64_t VirtioBlock::device_features(void) {
+	uint64_t features = (1ULL << VIRTIO_BLK_F_SEG_MAX) | (1ULL << VIRTIO_BLK_F_BLK_SIZE) |
+	                    (1ULL << VIRTIO_BLK_F_FLUSH) | (1ULL << VIRTIO_F_RING_EVENT_IDX);
+	if (readonly)
+		features |= 1ULL << VIRTIO_BLK_F_RO;
+	return features;
+}
+
+bool VirtioBlock::cluster_present(uint64_t cluster) {
+	return overlay && (present[cluster / 8] & (1 << (cluster % 8)));
+}
+
+const uint8_t *VirtioBlock::cluster_data(uint64_t cluster) {
+	return cluster_present(cluster) ? overlay : image;
+}
+
+/* Copies the clusters touched by a write of the given range from the base
+ * image into the overlay, unless the write replaces them entirely. */
+void VirtioBlock::copy_up(uint64_t offset, uint64_t len) {
+	uint64_t first = offset / CLUSTER_SIZE;
+	uint64_t last = (offset + len - 1) / CLUSTER_SIZE;
+
+	for (uint64_t c = first; c <= last; c++) {
+		if (cluster_present(c))
+			continue;
+
+		uint64_t start = c * CLUSTER_SIZE;
+		uint64_t n = std::min((uint64_t)CLUSTER_SIZE, size - start);
+		if (offset > start || offset + len < start + n) {
+			if (pwrite(overlayfd, image + start, n, start) != (ssize_t)n)
+				throw std::system_error(errno, std::generic_category());
+		}
+	}
+}
+
+uint8_t VirtioBlock::read(uint64_t offset, const std::vector<struct iovec> &iov) {
+	for (auto &v : iov) {
+		uint8_t *dst = (uint8_t *)v.iov_base;
+		size_t left = v.iov_len;
+
+		/* the source may change at every cluster boundary */
+		while (left > 0) {
+			uint64_t cluster = offset / CLUSTER_SIZE;
+			size_t n = std::min((uint64_t)left, (cluster + 1) * CLUSTER_SIZE - offset);
+			memcpy(dst, cluster_data(cluster) + offset, n);
+
+			dst += n;
+			left -= n;
+			offset += n;
+		}
+	}
+
+	return VIRTIO_BLK_S_OK;
+}
+
+uint8_t VirtioBlock::write(uint64_t offset, const std::vector<struct iovec> &iov, size_t len) {
+	if (readonly)
+		return VIRTIO_BLK_S_IOERR;
+	if (len == 0)
+		return VIRTIO_BLK_S_OK;
+
+	int fd = imgfd;
+	if (overlay) {
+		copy_up(offset, len);
+		fd = overlayfd;
+	}
+
+	/* guest buffers are passed to the kernel as is, at most
+	 * VIRTIO_QUEUE_MAX of them, hence below IOV_MAX */
+	ssize_t n = pwritev(fd, iov.data(), iov.size(), offset);
+	if (n != (ssize_t)len)
+		return VIRTIO_BLK_S_IOERR;
+
+	if (overlay) {
+		for (uint64_t c = offset / CLUSTER_SIZE; c <= (offset + len - 1) / CLUSTER_SIZE; c++)
+			present[c / 8] |= 1 << (c % 8);
+	}
+
+	return VIRTIO_BLK_S_OK;
+}
+
+void VirtioBlock::queue_notify(unsigned idx) {
+	std::lock_guard<std::mutex> lock(mtx);
+	VirtioQueue &q = queues[idx];
+	VirtioQueue::Chain chain;
+	std::vector<VirtioQueue::Chain> flushes;
+
+	while (q.pop(chain)) {
+		struct virtio_blk_req req;
+		if (chain.read(0, &req, sizeof(req)) != sizeof(req) || chain.in_len < 1) {
+			q.fail("virtio-blk: malformed request");
+			break;
+		}
+
+		/* the last writable byte holds the status */
+		size_t data_len = chain.in_len - 1;
+		uint64_t offset = req.sector * SECTOR_SIZE;
+		uint8_t status;
+		uint32_t written = 0;
+
+		switch (req.type) {
+			case VIRTIO_BLK_T_IN:
+				if (offset > size || data_len > size - offset) {
+					status = VIRTIO_BLK_S_IOERR;
+					break;
+				}
+				status = read(offset, VirtioQueue::slice(chain.in, 0, data_len));
+				written = data_len;
+				break;
+
+			case VIRTIO_BLK_T_OUT: {
+				size_t len = chain.out_len - sizeof(req);
+				if (offset > size || len > size - offset) {
+					status = VIRTIO_BLK_S_IOERR;
+					break;
+				}
+				status = write(offset, VirtioQueue::slice(chain.out, sizeof(req), len), len);
+				break;
+			}
+
+			case VIRTIO_BLK_T_FLUSH:
+				/* completed after the remaining requests of this batch */
+				flushes.push_back(chain);
+				continue;
+
+			case VIRTIO_BLK_T_GET_ID: {
+				char id[VIRTIO_BLK_ID_BYTES] = "riscv-vp";
+				written = chain.write(0, id, std::min(data_len, sizeof(id)));
+				status = VIRTIO_BLK_S_OK;
+				break;
+			}
+
+			default:
+				status = VIRTIO_BLK_S_UNSUPP;
+				break;
+		}
+
+		chain.write(data_len, &status, sizeof(status));
+		q.push(chain, written + sizeof(status));
+	}
+
+	if (!flushes.empty()) {
+		uint8_t status = VIRTIO_BLK_S_OK;
+		if (fsync(overlay ? overlayfd : imgfd) == -1)
+			status = VIRTIO_BLK_S_IOERR;
+
+		for (auto &c : flushes) {
+			c.write(c.in_len - 1, &status, sizeof(status));
+			q.push(c, sizeof(status));
+		}
+	}
+
+	signal_used(q);
+}
@@ -0,0 +1,58 @@
+#ifndef RISCV_VP_VIRTIO_BLK_H
+#define RISCV_VP_VIRTIO_BLK_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+#include "virtio.h"
+
+/**
+ * virtio block device (virtio 1.1, section 5.2) backed by a raw disk image.
+ *
+ * The image is mapped into the host address space, reads are copied from
+ * the mapping straight into the guest buffers. Writes are passed to the
+ * image file with a single pwritev(2) per request, flush requests arriving
+ * in the same batch are combined into one fsync(2).
+ *
+ * Optionally, writes are redirected to a copy-on-write overlay file. This
+ * allows several instances to share one read-only base image. The overlay
+ * consists of a (sparse) copy of the image followed by a bitmap of the
+ * clusters present in the overlay and is created on first use.
+ *
+ * If no image is configured the device reports device ID zero, which the
+ * driver ignores.
+ */
+class VirtioBlock : public VirtioMMIO {
+public:
+	VirtioBlock(sc_core::sc_module_name, uint32_t, MemoryDMI, std::string, std::string = "");
+	~VirtioBlock(void);
+
+private:
+	int imgfd = -1;
+	uint8_t *image = nullptr;
+	uint64_t size = 0;
+	bool readonly = false;
+
+	int overlayfd = -1;
+	uint8_t *overlay = nullptr;
+	uint8_t *present = nullptr; /* cluster bitmap inside the overlay mapping */
+	size_t overlay_size = 0;
+
+	uint64_t device_features(void) override;
+	void queue_notify(unsigned) override;
+
+	void open_image(const std::string &);
+	void open_overlay(const std::string &);
+
+	bool cluster_present(uint64_t);
+	const uint8_t *cluster_data(uint64_t);
+	void copy_up(uint64_t, uint64_t);
+
+	uint8_t read(uint64_t, const std::vector<struct iovec> &);
+	uint8_t write(uint64_t, const std::vector<struct iovec> &, size_t);
+};
+
+#endif  // RISCV_VP_VIRTIO_BLK_H
@@ -0,0 +1,163 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/uio.h>
+
+#include <system_error>
+
+#include "core/common/rawmode.h"
+#include "io_reactor.h"
+#include "virtio_console.h"
+
+#define VIRTIO_ID_CONSOLE 3
+
+VirtioConsole::VirtioConsole(sc_core::sc_module_name name, uint32_t irqsrc, MemoryDMI mem, bool enabled)
+    : VirtioMMIO(name, irqsrc, mem, enabled ? VIRTIO_ID_CONSOLE : 0, 2, 0), enabled(enabled) {
+	if (!enabled)
+		return;
+
+	enableRawMode(STDIN_FILENO);
+	/* input is only polled once the driver is ready */
+	IOReactor::get().add(STDIN_FILENO, 0, std::bind(&VirtioConsole::handle_io, this, std::placeholders::_1));
+}
+
+VirtioConsole::~VirtioConsole(void) {
+	if (!enabled)
+		return;
+
+	IOReactor::get().remove(STDIN_FILENO);
+	disableRawMode(STDIN_FILENO);
+}
+
+uint64_t VirtioConsole::device_features(void) {
+	return 1ULL << VIRTIO_F_RING_EVENT_IDX;
+}
+
+void VirtioConsole::queue_notify(unsigned idx) {
+	if (idx == TX_QUEUE || rx_stalled)
+		IOReactor::get().wakeup(STDIN_FILENO);
+}
+
+void VirtioConsole::device_reset(void) {
+	running = false;
+	rx_stalled = false;
+	if (enabled)
+		IOReactor::get().modify(STDIN_FILENO, 0);
+}
+
+void VirtioConsole::driver_ok(void) {
+	if (!enabled)
+		return;
+
+	running = true;
+	if (!rx_eof)
+		IOReactor::get().modify(STDIN_FILENO, EPOLLIN);
+	IOReactor::get().wakeup(STDIN_FILENO);
+}
+
+void VirtioConsole::handle_io(uint32_t events) {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (!running)
+		return;
+
+	transmit();
+	receive(events);
+}
+
+void VirtioConsole::transmit(void) {
+	VirtioQueue &q = queues[TX_QUEUE];
+	std::vector<VirtioQueue::Chain> chains;
+	std::vector<struct iovec> iov;
+	VirtioQueue::Chain chain;
+
+	for (;;) {
+		/* coalesce all pending buffers into as few writes as possible */
+		while (iov.size() < IOV_MAX - VIRTIO_QUEUE_MAX && q.pop(chain)) {
+			iov.insert(iov.end(), chain.out.begin(), chain.out.end());
+			chains.push_back(chain);
+		}
+		if (chains.empty())
+			break;
+
+		struct iovec *v = iov.data();
+		size_t cnt = iov.size();
+		while (cnt > 0) {
+			ssize_t n = writev(STDOUT_FILENO, v, cnt);
+			if (n == -1) {
+				if (errno == EINTR)
+					continue;
+				throw std::system_error(errno, std::generic_category());
+			}
+
+			/* skip what was written, writev(2) may return early */
+			while (cnt > 0 && (size_t)n >= v->iov_len) {
+				n -= v->iov_len;
+				v++;
+				cnt--;
+			}
+			if (cnt > 0) {
+				v->iov_base = (uint8_t *)v->iov_base + n;
+				v->iov_len -= n;
+			}
+		}
+
+		for (auto &c : chains)
+			q.push(c, 0);
+		chains.clear();
+		iov.clear();
+	}
+
+	signal_used(q);
+}
+
+void VirtioConsole::receive(uint32_t events) {
+	VirtioQueue &q = queues[RX_QUEUE];
+	VirtioQueue::Chain chain;
+
+	if (rx_eof)
+		return;
+
+	if (!q.pop(chain)) {
+		/* Out of receive buffers, stop polling stdin until the driver
+		 * adds buffers. Check again after setting the flag to not
+		 * miss a concurrent notify. */
+		if (!rx_stalled) {
+			rx_stalled = true;
+			IOReactor::get().modify(STDIN_FILENO, 0);
+			if (q.available())
+				IOReactor::get().wakeup(STDIN_FILENO);
+		}
+		return;
+	}
+
+	if (rx_stalled) {
+		/* wait for input before reading, read(2) might block */
+		rx_stalled = false;
+		IOReactor::get().modify(STDIN_FILENO, EPOLLIN);
+		q.unpop();
+		return;
+	}
+
+	if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+		q.unpop();
+		return;
+	}
+
+	ssize_t n = readv(STDIN_FILENO, chain.in.data(), chain.in.size());
+	if (n <= 0) {
+		q.unpop();
+		if (n == -1 && errno != EAGAIN && errno != EINTR)
+			throw std::system_error(errno, std::generic_category());
+		if (n == 0) {
+			rx_eof = true;
+			IOReactor::get().modify(STDIN_FILENO, 0);
+		}
+		return;
+	}
+
+	q.push(chain, n);
+	signal_used(q);
+}
@@ -0,0 +1,46 @@
+#ifndef RISCV_VP_VIRTIO_CONSOLE_H
+#define RISCV_VP_VIRTIO_CONSOLE_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "virtio.h"
+
+/**
+ * virtio console device (virtio 1.1, section 5.3) with a single port
+ * connected to stdin/stdout. The guest hands over whole buffers instead
+ * of single characters. All transmit buffers pending at a time are written
+ * to the host with one writev(2), input is read directly into the receive
+ * buffers. Both happens on the IOReactor thread.
+ *
+ * Linux uses the device as hvc0 (console=hvc0). If disabled the device
+ * reports device ID zero, which the driver ignores.
+ */
+class VirtioConsole : public VirtioMMIO {
+public:
+	VirtioConsole(sc_core::sc_module_name, uint32_t, MemoryDMI, bool);
+	~VirtioConsole(void);
+
+private:
+	enum {
+		RX_QUEUE = 0,
+		TX_QUEUE = 1,
+	};
+
+	bool enabled;
+	bool running = false;
+	bool rx_eof = false;
+	std::atomic<bool> rx_stalled{false};
+
+	uint64_t device_features(void) override;
+	void queue_notify(unsigned) override;
+	void device_reset(void) override;
+	void driver_ok(void) override;
+
+	void handle_io(uint32_t);
+	void transmit(void);
+	void receive(uint32_t);
+};
+
+#endif  // RISCV_VP_VIRTIO_CONSOLE_H
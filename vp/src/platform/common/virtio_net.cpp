@@ -0,0 +1,165 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#include <system_error>
+
+#include "io_reactor.h"
+#include "virtio_net.h"
+
+#define VIRTIO_ID_NET 1
+
+/* feature bits, see section 5.1.3 */
+#define VIRTIO_NET_F_MAC 5
+#define VIRTIO_NET_F_STATUS 16
+
+#define VIRTIO_NET_S_LINK_UP 1
+
+/* struct virtio_net_hdr including num_buffers, mandatory with VIRTIO_F_VERSION_1 */
+#define VIRTIO_NET_HDR_SIZE 12
+
+/* layout of the configuration space */
+enum {
+	CONFIG_MAC = 0,
+	CONFIG_STATUS = 6,
+	CONFIG_SIZE = 8,
+};
+
+VirtioNet::VirtioNet(sc_core::sc_module_name name, uint32_t irqsrc, MemoryDMI mem, std::string netdev)
+    : VirtioMMIO(name, irqsrc, mem, netdev.empty() ? 0 : VIRTIO_ID_NET, 2, CONFIG_SIZE) {
+	/* locally administered unicast address */
+	config[CONFIG_MAC + 0] = 0x02;
+	for (size_t i = 1; i < 6; i++)
+		config[CONFIG_MAC + i] = std::rand() & 0xff;
+	config[CONFIG_STATUS] = VIRTIO_NET_S_LINK_UP;
+
+	if (netdev.empty())
+		return;
+
+	open_tap(netdev);
+	/* input is only polled once the driver is ready */
+	IOReactor::get().add(tapfd, 0, std::bind(&VirtioNet::handle_io, this, std::placeholders::_1));
+}
+
+VirtioNet::~VirtioNet(void) {
+	if (tapfd < 0)
+		return;
+
+	IOReactor::get().remove(tapfd);
+	close(tapfd);
+}
+
+void VirtioNet::open_tap(const std::string &netdev) {
+	tapfd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (tapfd == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	/* ethernet frames prefixed with the virtio-net header */
+	struct ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_VNET_HDR;
+	strncpy(ifr.ifr_name, netdev.c_str(), IFNAMSIZ - 1);
+
+	int hdrsz = VIRTIO_NET_HDR_SIZE;
+	if (ioctl(tapfd, TUNSETIFF, (void *)&ifr) == -1 || ioctl(tapfd, TUNSETVNETHDRSZ, &hdrsz) == -1) {
+		int err = errno;
+		close(tapfd);
+		throw std::system_error(err, std::generic_category());
+	}
+}
+
+uint64_t VirtioNet::device_features(void) {
+	return (1ULL << VIRTIO_NET_F_MAC) | (1ULL << VIRTIO_NET_F_STATUS) | (1ULL << VIRTIO_F_RING_EVENT_IDX);
+}
+
+void VirtioNet::queue_notify(unsigned idx) {
+	/* new transmit buffers, or receive buffers while input is stalled */
+	if (idx == TX_QUEUE || rx_stalled)
+		IOReactor::get().wakeup(tapfd);
+}
+
+void VirtioNet::device_reset(void) {
+	running = false;
+	rx_stalled = false;
+	if (tapfd >= 0)
+		IOReactor::get().modify(tapfd, 0);
+}
+
+void VirtioNet::driver_ok(void) {
+	if (tapfd < 0)
+		return;
+
+	running = true;
+	IOReactor::get().modify(tapfd, EPOLLIN);
+	IOReactor::get().wakeup(tapfd);
+}
+
+void VirtioNet::handle_io(uint32_t) {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (!running)
+		return;
+
+	transmit();
+	receive();
+}
+
+void VirtioNet::transmit(void) {
+	VirtioQueue &q = queues[TX_QUEUE];
+	VirtioQueue::Chain chain;
+
+	while (q.pop(chain)) {
+		/* the tap device drops the frame if its queue is full, which
+		 * is fine for an ethernet device */
+		if (writev(tapfd, chain.out.data(), chain.out.size()) == -1 && errno != EAGAIN && errno != EIO)
+			throw std::system_error(errno, std::generic_category());
+		q.push(chain, 0);
+	}
+
+	signal_used(q);
+}
+
+void VirtioNet::receive(void) {
+	VirtioQueue &q = queues[RX_QUEUE];
+	VirtioQueue::Chain chain;
+
+	for (;;) {
+		if (!q.pop(chain)) {
+			/* Out of receive buffers, stop polling the tap device
+			 * until the driver adds buffers. Check again after
+			 * setting the flag to not miss a concurrent notify. */
+			if (!rx_stalled) {
+				rx_stalled = true;
+				IOReactor::get().modify(tapfd, 0);
+				if (q.available())
+					continue;
+			}
+			break;
+		}
+
+		if (rx_stalled) {
+			rx_stalled = false;
+			IOReactor::get().modify(tapfd, EPOLLIN);
+		}
+
+		ssize_t n = readv(tapfd, chain.in.data(), chain.in.size());
+		if (n == -1) {
+			q.unpop();
+			if (errno == EAGAIN || errno == EINTR)
+				break;
+			throw std::system_error(errno, std::generic_category());
+		}
+		q.push(chain, n);
+	}
+
+	signal_used(q);
+}
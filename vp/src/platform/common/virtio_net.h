@@ -0,0 +1,47 @@
+#ifndef RISCV_VP_VIRTIO_NET_H
+#define RISCV_VP_VIRTIO_NET_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "virtio.h"
+
+/**
+ * virtio network device (virtio 1.1, section 5.1) backed by a host tap
+ * device. Frames are moved between the tap device and the guest buffers
+ * with readv(2)/writev(2) on the IOReactor thread without intermediate
+ * copies, the virtio-net header is produced and consumed by the tap device
+ * itself (IFF_VNET_HDR).
+ *
+ * If no tap device is configured the device reports device ID zero, which
+ * the driver ignores.
+ */
+class VirtioNet : public VirtioMMIO {
+public:
+	VirtioNet(sc_core::sc_module_name, uint32_t, MemoryDMI, std::string);
+	~VirtioNet(void);
+
+private:
+	enum {
+		RX_QUEUE = 0,
+		TX_QUEUE = 1,
+	};
+
+	int tapfd = -1;
+	bool running = false;
+	std::atomic<bool> rx_stalled{false};
+
+	uint64_t device_features(void) override;
+	void queue_notify(unsigned) override;
+	void device_reset(void) override;
+	void driver_ok(void) override;
+
+	void open_tap(const std::string &);
+	void handle_io(uint32_t);
+	void transmit(void);
+	void receive(void);
+};
+
+#endif  // RISCV_VP_VIRTIO_NET_H
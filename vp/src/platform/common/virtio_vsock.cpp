@@ -0,0 +1,520 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include "io_reactor.h"
+#include "virtio_vsock.h"
+
+#define VIRTIO_ID_VSOCK 19
+
+#define VSOCK_HOST_CID 2
+#define VSOCK_TYPE_STREAM 1
+
+/* packet operations, see section 5.10.6 */
+enum {
+	VSOCK_OP_REQUEST = 1,
+	VSOCK_OP_RESPONSE = 2,
+	VSOCK_OP_RST = 3,
+	VSOCK_OP_SHUTDOWN = 4,
+	VSOCK_OP_RW = 5,
+	VSOCK_OP_CREDIT_UPDATE = 6,
+	VSOCK_OP_CREDIT_REQUEST = 7,
+};
+
+#define VSOCK_SHUTDOWN_RCV 1
+#define VSOCK_SHUTDOWN_SEND 2
+
+/* receive buffer space per connection announced to the guest */
+#define VSOCK_BUF_ALLOC (256 * 1024)
+/* maximum payload per packet sent to the guest */
+#define VSOCK_MAX_PKT (64 * 1024)
+/* maximum length of the "CONNECT <port>\n" line */
+#define VSOCK_MAX_LINE 32
+
+struct virtio_vsock_hdr {
+	uint64_t src_cid;
+	uint64_t dst_cid;
+	uint32_t src_port;
+	uint32_t dst_port;
+	uint32_t len;
+	uint16_t type;
+	uint16_t op;
+	uint32_t flags;
+	uint32_t buf_alloc;
+	uint32_t fwd_cnt;
+} __attribute__((packed));
+
+VirtioVsock::VirtioVsock(sc_core::sc_module_name name, uint32_t irqsrc, MemoryDMI mem, std::string path,
+                         uint64_t cid)
+    : VirtioMMIO(name, irqsrc, mem, path.empty() ? 0 : VIRTIO_ID_VSOCK, 3, sizeof(uint64_t)),
+      path(path),
+      guest_cid(cid) {
+	memcpy(&config[0], &guest_cid, sizeof(guest_cid));
+
+	if (path.empty())
+		return;
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path) - 16)
+		throw std::runtime_error("vsock path " + path + " is too long");
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	if ((listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1)
+		throw std::system_error(errno, std::generic_category());
+	unlink(path.c_str());
+	if (bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listenfd, 16) == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	/* only used to request invocations of handle_device() */
+	if ((evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	IOReactor::get().add(listenfd, EPOLLIN, std::bind(&VirtioVsock::handle_listen, this, std::placeholders::_1));
+	IOReactor::get().add(evfd, 0, std::bind(&VirtioVsock::handle_device, this, std::placeholders::_1));
+}
+
+VirtioVsock::~VirtioVsock(void) {
+	if (path.empty())
+		return;
+
+	IOReactor::get().remove(evfd);
+	IOReactor::get().remove(listenfd);
+	close(evfd);
+	close(listenfd);
+	unlink(path.c_str());
+
+	while (!conns.empty())
+		close_conn(*conns.begin()->second);
+}
+
+uint64_t VirtioVsock::device_features(void) {
+	return 1ULL << VIRTIO_F_RING_EVENT_IDX;
+}
+
+void VirtioVsock::queue_notify(unsigned) {
+	if (evfd >= 0)
+		IOReactor::get().wakeup(evfd);
+}
+
+void VirtioVsock::device_reset(void) {
+	running = false;
+	ctrl.clear();
+	while (!conns.empty())
+		close_conn(*conns.begin()->second);
+}
+
+void VirtioVsock::driver_ok(void) {
+	running = true;
+	if (evfd >= 0)
+		IOReactor::get().wakeup(evfd);
+}
+
+std::shared_ptr<VirtioVsock::Conn> VirtioVsock::find(uint32_t host_port, uint32_t guest_port) {
+	for (auto &e : conns) {
+		Conn &c = *e.second;
+		if (c.state != Conn::HANDSHAKE && c.host_port == host_port && c.guest_port == guest_port)
+			return e.second;
+	}
+	return nullptr;
+}
+
+std::shared_ptr<VirtioVsock::Conn> VirtioVsock::add_conn(int fd) {
+	std::shared_ptr<Conn> c = std::make_shared<Conn>();
+	c->fd = fd;
+	conns[fd] = c;
+
+	IOReactor::get().add(fd, 0, std::bind(&VirtioVsock::handle_conn, this, fd, std::placeholders::_1));
+	return c;
+}
+
+void VirtioVsock::close_conn(Conn &c) {
+	int fd = c.fd;
+
+	IOReactor::get().remove(fd);
+	close(fd);
+	c.state = Conn::CLOSED;
+	conns.erase(fd); /* only referenced by the caller afterwards */
+}
+
+void VirtioVsock::reset_conn(Conn &c) {
+	send_ctrl(c.host_port, c.guest_port, VSOCK_OP_RST);
+	close_conn(c);
+}
+
+/* Poll the socket for input only while it is not known to be readable,
+ * the data is fetched once receive buffers and credit are available. */
+void VirtioVsock::update_events(Conn &c) {
+	uint32_t events = 0;
+
+	if (c.state == Conn::HANDSHAKE)
+		events |= EPOLLIN;
+	else if (c.state == Conn::ESTABLISHED && !c.eof && !c.readable)
+		events |= EPOLLIN;
+	if (!c.pending.empty())
+		events |= EPOLLOUT;
+
+	if (events != c.events) {
+		c.events = events;
+		IOReactor::get().modify(c.fd, events);
+	}
+}
+
+uint32_t VirtioVsock::peer_credit(Conn &c) {
+	uint32_t in_flight = c.tx_cnt - c.peer_fwd_cnt;
+	return (in_flight < c.peer_buf_alloc) ? c.peer_buf_alloc - in_flight : 0;
+}
+
+void VirtioVsock::send_ctrl(uint32_t src_port, uint32_t dst_port, uint16_t op, uint32_t flags) {
+	ctrl.push_back({src_port, dst_port, op, flags});
+}
+
+void VirtioVsock::fill_header(VirtioQueue::Chain &chain, uint32_t src_port, uint32_t dst_port, uint16_t op,
+                              uint32_t flags, uint32_t len) {
+	struct virtio_vsock_hdr hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.src_cid = VSOCK_HOST_CID;
+	hdr.dst_cid = guest_cid;
+	hdr.src_port = src_port;
+	hdr.dst_port = dst_port;
+	hdr.len = len;
+	hdr.type = VSOCK_TYPE_STREAM;
+	hdr.op = op;
+	hdr.flags = flags;
+
+	/* every packet announces our credit */
+	std::shared_ptr<Conn> c = find(src_port, dst_port);
+	if (c) {
+		hdr.buf_alloc = VSOCK_BUF_ALLOC;
+		hdr.fwd_cnt = c->fwd_cnt;
+		c->fwd_cnt_sent = c->fwd_cnt;
+	}
+
+	chain.write(0, &hdr, sizeof(hdr));
+}
+
+void VirtioVsock::handle_device(uint32_t) {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (!running)
+		return;
+
+	transmit();
+	receive();
+}
+
+void VirtioVsock::handle_listen(uint32_t) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	int fd;
+	while ((fd = accept4(listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		if (!running) {
+			close(fd);
+			continue;
+		}
+
+		std::shared_ptr<Conn> c = add_conn(fd);
+		c->state = Conn::HANDSHAKE;
+		update_events(*c);
+	}
+
+	if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+		throw std::system_error(errno, std::generic_category());
+}
+
+void VirtioVsock::handle_conn(int fd, uint32_t events) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	auto it = conns.find(fd);
+	if (it == conns.end())
+		return;
+	std::shared_ptr<Conn> c = it->second;
+
+	if (c->state == Conn::HANDSHAKE) {
+		handshake(*c);
+		receive();
+		return;
+	}
+
+	if (events & EPOLLOUT)
+		flush(*c);
+	if (c->state == Conn::ESTABLISHED && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+		c->readable = true;
+		update_events(*c);
+	}
+
+	receive();
+}
+
+void VirtioVsock::handshake(Conn &c) {
+	char buf[VSOCK_MAX_LINE];
+	ssize_t n = read(c.fd, buf, sizeof(buf));
+	if (n == -1 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if (n <= 0) {
+		close_conn(c);
+		return;
+	}
+
+	c.line.append(buf, n);
+	size_t nl = c.line.find('\n');
+	if (nl == std::string::npos) {
+		if (c.line.size() > VSOCK_MAX_LINE)
+			close_conn(c);
+		return;
+	}
+
+	unsigned port;
+	if (sscanf(c.line.c_str(), "CONNECT %u", &port) != 1 || nl + 1 != c.line.size()) {
+		close_conn(c);
+		return;
+	}
+
+	c.state = Conn::CONNECTING;
+	c.host_port = next_port++;
+	c.guest_port = port;
+	update_events(c);
+	send_ctrl(c.host_port, c.guest_port, VSOCK_OP_REQUEST);
+}
+
+/* Guest connects to a host port, forward it to the corresponding socket */
+void VirtioVsock::connect_host(uint32_t host_port, uint32_t guest_port) {
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s_%u", path.c_str(), host_port);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1)
+		throw std::system_error(errno, std::generic_category());
+
+	/* connecting to a Unix socket either succeeds or fails right away,
+	 * except if its backlog is full */
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(fd);
+		send_ctrl(host_port, guest_port, VSOCK_OP_RST);
+		return;
+	}
+
+	std::shared_ptr<Conn> c = add_conn(fd);
+	c->state = Conn::ESTABLISHED;
+	c->host_port = host_port;
+	c->guest_port = guest_port;
+	update_events(*c);
+	send_ctrl(host_port, guest_port, VSOCK_OP_RESPONSE);
+}
+
+void VirtioVsock::flush(Conn &c) {
+	while (!c.pending.empty()) {
+		ssize_t n = write(c.fd, c.pending.data(), c.pending.size());
+		if (n == -1) {
+			if (errno == EAGAIN || errno == EINTR)
+				break;
+			/* host closed the connection, pending data is lost */
+			reset_conn(c);
+			return;
+		}
+
+		c.pending.erase(c.pending.begin(), c.pending.begin() + n);
+		c.fwd_cnt += n;
+	}
+
+	if (c.pending.empty() && c.shut_wr) {
+		/* both directions are shut down, the connection is done */
+		if (c.eof) {
+			reset_conn(c);
+			return;
+		}
+		shutdown(c.fd, SHUT_WR);
+	}
+
+	/* let the guest continue once half of the buffer is free again */
+	if (c.fwd_cnt - c.fwd_cnt_sent >= VSOCK_BUF_ALLOC / 2)
+		send_ctrl(c.host_port, c.guest_port, VSOCK_OP_CREDIT_UPDATE);
+
+	update_events(c);
+}
+
+void VirtioVsock::transmit(void) {
+	VirtioQueue &q = queues[TX_QUEUE];
+	VirtioQueue::Chain chain;
+
+	while (q.pop(chain)) {
+		struct virtio_vsock_hdr hdr;
+		if (chain.read(0, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+			q.fail("virtio-vsock: malformed packet");
+			break;
+		}
+		q.push(chain, 0);
+
+		if (hdr.dst_cid != VSOCK_HOST_CID || hdr.type != VSOCK_TYPE_STREAM) {
+			if (hdr.op != VSOCK_OP_RST)
+				send_ctrl(hdr.dst_port, hdr.src_port, VSOCK_OP_RST);
+			continue;
+		}
+
+		std::shared_ptr<Conn> c = find(hdr.dst_port, hdr.src_port);
+		if (c) {
+			c->peer_buf_alloc = hdr.buf_alloc;
+			c->peer_fwd_cnt = hdr.fwd_cnt;
+		}
+
+		switch (hdr.op) {
+			case VSOCK_OP_REQUEST:
+				if (c)
+					send_ctrl(hdr.dst_port, hdr.src_port, VSOCK_OP_RST);
+				else
+					connect_host(hdr.dst_port, hdr.src_port);
+				break;
+
+			case VSOCK_OP_RESPONSE:
+				if (!c || c->state != Conn::CONNECTING) {
+					send_ctrl(hdr.dst_port, hdr.src_port, VSOCK_OP_RST);
+					break;
+				}
+				/* the socket buffer is still empty, hence this does not block */
+				c->line = "OK " + std::to_string(c->host_port) + "\n";
+				if (write(c->fd, c->line.data(), c->line.size()) != (ssize_t)c->line.size()) {
+					reset_conn(*c);
+					break;
+				}
+				c->state = Conn::ESTABLISHED;
+				update_events(*c);
+				break;
+
+			case VSOCK_OP_RW: {
+				if (!c || c->state != Conn::ESTABLISHED) {
+					send_ctrl(hdr.dst_port, hdr.src_port, VSOCK_OP_RST);
+					break;
+				}
+
+				size_t len = std::min((size_t)hdr.len, chain.out_len - sizeof(hdr));
+				std::vector<struct iovec> iov = VirtioQueue::slice(chain.out, sizeof(hdr), len);
+				size_t done = 0;
+
+				/* write directly from the guest buffers, keep the rest */
+				if (c->pending.empty()) {
+					ssize_t n = writev(c->fd, iov.data(), iov.size());
+					if (n == -1 && errno != EAGAIN && errno != EINTR) {
+						reset_conn(*c);
+						break;
+					}
+					if (n > 0)
+						done = n;
+					c->fwd_cnt += done;
+				}
+				for (auto &v : VirtioQueue::slice(iov, done, len - done))
+					c->pending.insert(c->pending.end(), (uint8_t *)v.iov_base, (uint8_t *)v.iov_base + v.iov_len);
+
+				flush(*c);
+				break;
+			}
+
+			case VSOCK_OP_SHUTDOWN:
+				if (!c)
+					break;
+				/* the connection is reset once pending data was written */
+				if (hdr.flags & VSOCK_SHUTDOWN_RCV)
+					c->eof = true;
+				if (hdr.flags & VSOCK_SHUTDOWN_SEND)
+					c->shut_wr = true;
+				flush(*c);
+				break;
+
+			case VSOCK_OP_RST:
+				if (c)
+					close_conn(*c);
+				break;
+
+			case VSOCK_OP_CREDIT_REQUEST:
+				if (c)
+					send_ctrl(c->host_port, c->guest_port, VSOCK_OP_CREDIT_UPDATE);
+				break;
+
+			case VSOCK_OP_CREDIT_UPDATE:
+			default:
+				break;
+		}
+	}
+
+	signal_used(q);
+}
+
+void VirtioVsock::receive(void) {
+	VirtioQueue &q = queues[RX_QUEUE];
+	VirtioQueue::Chain chain;
+	int last = -1;
+
+	while (q.available()) {
+		if (!ctrl.empty()) {
+			if (!q.pop(chain))
+				break;
+			Control &p = ctrl.front();
+			fill_header(chain, p.src_port, p.dst_port, p.op, p.flags, 0);
+			q.push(chain, sizeof(struct virtio_vsock_hdr));
+			ctrl.pop_front();
+			continue;
+		}
+
+		/* serve readable connections round-robin */
+		std::shared_ptr<Conn> c;
+		auto it = conns.upper_bound(last);
+		for (size_t i = 0; i < conns.size(); i++, it++) {
+			if (it == conns.end())
+				it = conns.begin();
+
+			Conn &x = *it->second;
+			if (x.state == Conn::ESTABLISHED && x.readable && !x.eof && peer_credit(x) > 0) {
+				c = it->second;
+				break;
+			}
+		}
+		if (!c)
+			break;
+		last = c->fd;
+
+		if (!q.pop(chain))
+			break;
+		if (chain.in_len <= sizeof(struct virtio_vsock_hdr)) {
+			q.fail("virtio-vsock: receive buffer too small");
+			break;
+		}
+
+		size_t len = std::min({chain.in_len - sizeof(struct virtio_vsock_hdr), (size_t)peer_credit(*c),
+		                       (size_t)VSOCK_MAX_PKT});
+		std::vector<struct iovec> iov = VirtioQueue::slice(chain.in, sizeof(struct virtio_vsock_hdr), len);
+		ssize_t n = readv(c->fd, iov.data(), iov.size());
+
+		if (n > 0) {
+			c->tx_cnt += n;
+			fill_header(chain, c->host_port, c->guest_port, VSOCK_OP_RW, 0, n);
+			q.push(chain, sizeof(struct virtio_vsock_hdr) + n);
+		} else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+			/* host closed the connection, the guest answers with a reset */
+			c->eof = true;
+			fill_header(chain, c->host_port, c->guest_port, VSOCK_OP_SHUTDOWN,
+			            VSOCK_SHUTDOWN_RCV | VSOCK_SHUTDOWN_SEND, 0);
+			q.push(chain, sizeof(struct virtio_vsock_hdr));
+			update_events(*c);
+		} else {
+			q.unpop();
+			c->readable = false;
+			update_events(*c);
+		}
+	}
+
+	signal_used(q);
+}
@@ -0,0 +1,115 @@
+#ifndef RISCV_VP_VIRTIO_VSOCK_H
+#define RISCV_VP_VIRTIO_VSOCK_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "virtio.h"
+
+/**
+ * virtio socket device (virtio 1.1, section 5.10) providing stream
+ * connections between guest programs (AF_VSOCK, host CID 2) and host
+ * programs through Unix domain sockets, hence no privileges are required.
+ * The host side follows the "hybrid vsock" convention of Firecracker:
+ *
+ *  - A guest connection to host port P is forwarded to the Unix socket
+ *    "<path>_<P>", which has to be listened on by the host program.
+ *  - Host programs connect to the Unix socket "<path>" and send the line
+ *    "CONNECT <P>\n" to connect to guest port P. The device answers with
+ *    "OK <host port>\n" once the guest accepted the connection.
+ *
+ * Payloads are moved with readv(2)/writev(2) directly between the sockets
+ * and the guest buffers on the IOReactor thread. If no path is configured
+ * the device reports device ID zero, which the driver ignores.
+ */
+class VirtioVsock : public VirtioMMIO {
+public:
+	VirtioVsock(sc_core::sc_module_name, uint32_t, MemoryDMI, std::string, uint64_t = 3);
+	~VirtioVsock(void);
+
+private:
+	enum {
+		RX_QUEUE = 0,
+		TX_QUEUE = 1,
+		EVENT_QUEUE = 2,
+	};
+
+	struct Conn {
+		enum {
+			HANDSHAKE,  /* host connection waiting for the CONNECT line */
+			CONNECTING, /* request sent to the guest, waiting for the response */
+			ESTABLISHED,
+			CLOSED,
+		} state;
+
+		int fd;
+		uint32_t host_port = 0;
+		uint32_t guest_port = 0;
+		std::string line;
+
+		/* data from the guest which was not yet written to the socket */
+		std::vector<uint8_t> pending;
+		bool readable = false;
+		bool eof = false;     /* no more data to the guest */
+		bool shut_wr = false; /* no more data from the guest */
+		uint32_t events = 0;
+
+		/* credit of the guest (virtio 1.1, section 5.10.6.3) */
+		uint32_t peer_buf_alloc = 0;
+		uint32_t peer_fwd_cnt = 0;
+		uint32_t tx_cnt = 0;
+
+		/* our credit as announced to the guest */
+		uint32_t fwd_cnt = 0;
+		uint32_t fwd_cnt_sent = 0;
+	};
+
+	/* control packet waiting for a receive buffer */
+	struct Control {
+		uint32_t src_port;
+		uint32_t dst_port;
+		uint16_t op;
+		uint32_t flags;
+	};
+
+	std::string path;
+	uint64_t guest_cid;
+	int listenfd = -1;
+	int evfd = -1;
+	bool running = false;
+	uint32_t next_port = 1024;
+
+	std::map<int, std::shared_ptr<Conn>> conns;
+	std::deque<Control> ctrl;
+
+	uint64_t device_features(void) override;
+	void queue_notify(unsigned) override;
+	void device_reset(void) override;
+	void driver_ok(void) override;
+
+	void handle_device(uint32_t);
+	void handle_listen(uint32_t);
+	void handle_conn(int, uint32_t);
+
+	std::shared_ptr<Conn> find(uint32_t, uint32_t);
+	std::shared_ptr<Conn> add_conn(int);
+	void close_conn(Conn &);
+	void reset_conn(Conn &);
+	void update_events(Conn &);
+	uint32_t peer_credit(Conn &);
+	void send_ctrl(uint32_t, uint32_t, uint16_t, uint32_t = 0);
+	void fill_header(VirtioQueue::Chain &, uint32_t, uint32_t, uint16_t, uint32_t, uint32_t);
+
+	void handshake(Conn &);
+	void connect_host(uint32_t, uint32_t);
+	void flush(Conn &);
+	void transmit(void);
+	void receive(void);
+};
+
+#endif  // RISCV_VP_VIRTIO_VSOCK_H
@@ -7,13 +7,16 @@
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "platform/common/io_reactor.h"
+
 CAN::CAN() {
 	state = State::init;
 	status = 0;
-	stop = false;
+	listening = false;
 
 	s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
 	if (s < 0) {
@@ -38,13 +41,13 @@ CAN::CAN() {
 		return;
 	}
 
-	listener = std::thread(&CAN::listen, this);
+	IOReactor::get().add(s, EPOLLIN, std::bind(&CAN::listen, this, std::placeholders::_1));
+	listening = true;
 }
 
 CAN::~CAN() {
-	stop = true;
-	if (listener.joinable())
-		listener.join();
+	if (listening)
+		IOReactor::get().remove(s);
 }
 
 const char* CAN::registerName(uint8_t id) {
@@ -134,6 +137,8 @@ const char* CAN::spiInstName(uint8_t id) {
 }
 
 uint8_t CAN::write(uint8_t byte) {
+	fetchIncomingCanFrames();
+
 	uint8_t ret = 0;
 	uint8_t whichBuf = 0;
 	switch (state) {
@@ -434,10 +439,10 @@ void CAN::mcp2515_buf_to_id(unsigned& id, bool& extended, uint8_t* idField) {
 	}
 }
 
-void CAN::enqueueIncomingCanFrame(const struct can_frame& frame) {
+bool CAN::enqueueIncomingCanFrame(const struct can_frame& frame) {
 	if ((status & 0b11) == 0b11) {
 		// all buffers full
-		return;
+		return false;
 	}
 
 	for (unsigned i = 0; i < 2; i++) {
@@ -449,20 +454,33 @@ void CAN::enqueueIncomingCanFrame(const struct can_frame& frame) {
 			rxBuf[i].length = frame.can_dlc;
 			memcpy(rxBuf[i].payload, frame.data, frame.can_dlc);
 			status |= 1 << i;
-			return;
+			return true;
 		}
 	}
+	return false;
 }
 
-void CAN::listen() {
-	while (!stop) {
+void CAN::fetchIncomingCanFrames() {
+	struct can_frame* frame;
+
+	while ((frame = rx_queue.front())) {
+		if (!enqueueIncomingCanFrame(*frame))
+			break;
+		rx_queue.release();
+	}
+}
+
+void CAN::listen(uint32_t) {
+	// called on the reactor thread, frames are dropped if the queue is full
+	for (;;) {
 		struct can_frame frame;
 
-		int nbytes = read(s, &frame, sizeof(struct can_frame));
+		int nbytes = recv(s, &frame, sizeof(struct can_frame), MSG_DONTWAIT);
 
 		if (nbytes < 0) {
-			perror("can raw socket read");
-			continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				perror("can raw socket read");
+			return;
 		}
 
 		/* paranoid check ... */
@@ -471,6 +489,6 @@ void CAN::listen() {
 			continue;
 		}
 
-		enqueueIncomingCanFrame(frame);
+		rx_queue.push(frame);
 	}
 }
@@ -7,7 +7,8 @@
 #include <net/if.h>
 
 #include <functional>
-#include <thread>
+
+#include "util/spsc_queue.h"
 
 class CAN : public SpiInterface {
 	enum class State {
@@ -38,7 +39,8 @@ class CAN : public SpiInterface {
 		dick,
 	} state;
 
-	std::thread listener;
+	// frames received by the IOReactor thread, moved into rxBuf on SPI access
+	SPSCQueue<struct can_frame, 16> rx_queue;
 
 	uint8_t registers[MCP_RXB1SIDH + 1];
 
@@ -74,7 +76,7 @@ class CAN : public SpiInterface {
 	struct sockaddr_can addr;
 	struct ifreq ifr;
 
-	volatile bool stop;
+	bool listening;
 
    public:
 	CAN();
@@ -99,6 +101,7 @@ class CAN : public SpiInterface {
 	void mcp2515_id_to_buf(const unsigned long id, uint8_t* idField, const bool extended = false);
 	void mcp2515_buf_to_id(unsigned& id, bool& extended, uint8_t* idField);
 
-	void enqueueIncomingCanFrame(const struct can_frame& frame);
-	void listen();
+	bool enqueueIncomingCanFrame(const struct can_frame& frame);
+	void fetchIncomingCanFrames();
+	void listen(uint32_t events);
 };
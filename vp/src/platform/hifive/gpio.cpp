@@ -63,12 +63,14 @@ void GPIO::register_access_callback(const vp::map::register_access_t &r) {
 			// client and the interrupt was not fired yet.
 			value = (value & ~output_en) | (port & output_en);
 			server.state = (server.state & ~output_en) | (port & output_en);
+			server.publish(sc_core::sc_time_stamp() / sc_core::sc_time(1, sc_core::SC_NS));
 		} else if (r.vptr == &pullup_en) {
 			// cout << "[GPIO] pullup changed" << endl;
 			// bitPrint(reinterpret_cast<unsigned char*>(&pullup_en),
 			// sizeof(uint32_t));
 			value |= reg_bak ^ pullup_en;
 			server.state |= reg_bak ^ pullup_en;
+			server.publish(sc_core::sc_time_stamp() / sc_core::sc_time(1, sc_core::SC_NS));
 		} else if (r.vptr == &fall_intr_en) {
 			// cout << "[GPIO] set fall_intr_en to ";
 			// bitPrint(reinterpret_cast<unsigned char*>(&fall_intr_en),
@@ -109,6 +111,9 @@ void GPIO::synchronousChange() {
 	// cout << "[GPIO] might have changed!" << endl;
 
 	GpioCommon::Reg serverSnapshot = server.state;
+	// pin changes of the client are published from the SystemC thread,
+	// asyncOnchange runs on the server thread
+	server.publish(sc_core::sc_time_stamp() / sc_core::sc_time(1, sc_core::SC_NS));
 	uint32_t diff = (serverSnapshot ^ value) & input_en;
 
 	// bitPrint(reinterpret_cast<unsigned char*>(&diff), 4);
@@ -9,11 +9,13 @@
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -31,15 +33,109 @@ void *get_in_addr(struct sockaddr *sa) {
 	return &(((struct sockaddr_in6 *)sa)->sin6_addr);
 }
 
-GpioClient::GpioClient() : fd(-1) {}
+GpioClient::GpioClient() : fd(-1), subscribed(false), ring(nullptr), tail(0), toggled(0) {}
 
 GpioClient::~GpioClient() {
+	if (ring) {
+		munmap(ring, sizeof(ChangeRing));
+	}
 	if (fd >= 0) {
 		close(fd);
 	}
 }
 
+bool GpioClient::subscribe(bool shm) {
+	Request req;
+	memset(&req, 0, sizeof(Request));
+	req.op = SUBSCRIBE;
+	req.subscribe.shm = shm;
+	if (write(fd, &req, sizeof(Request)) != sizeof(Request)) {
+		cerr << "Error in write " << fd << endl;
+		return false;
+	}
+	uint8_t ok;
+	if (read(fd, &ok, sizeof(ok)) != sizeof(ok) || !ok) {
+		cerr << "Subscription refused" << endl;
+		return false;
+	}
+
+	if (ring) {
+		munmap(ring, sizeof(ChangeRing));
+		ring = nullptr;
+	}
+	if (shm) {
+		// the server created and cleared the ring before answering
+		int shmfd = shm_open(ringName(port.c_str()).c_str(), O_RDONLY, 0);
+		if (shmfd < 0) {
+			perror("client: shm_open");
+			return false;
+		}
+		void *p = mmap(NULL, sizeof(ChangeRing), PROT_READ, MAP_SHARED, shmfd, 0);
+		close(shmfd);
+		if (p == MAP_FAILED) {
+			perror("client: mmap");
+			return false;
+		}
+		ring = reinterpret_cast<ChangeRing *>(p);
+		tail = 0;
+	}
+	subscribed = true;
+	return true;
+}
+
+bool GpioClient::receiveChanges() {
+	uint32_t count;
+	ssize_t bytes;
+	while ((bytes = recv(fd, &count, sizeof(count), MSG_DONTWAIT)) == sizeof(count)) {
+		// a batch is written at once, hence the rest follows immediately
+		for (uint32_t i = 0; i < count; i++) {
+			Change c;
+			if (recv(fd, &c, sizeof(Change), MSG_WAITALL) != sizeof(Change)) {
+				cerr << "Error in read " << fd << endl;
+				return false;
+			}
+			state = c.state;
+			toggled |= c.toggled;
+		}
+	}
+	if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return true;
+	cerr << "Error in read " << fd << endl;
+	return false;
+}
+
+void GpioClient::readRing() {
+	for (;;) {
+		uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if (head == tail)
+			break;
+		// the server writes the entry at head before incrementing it, which
+		// is the entry head - ring_size, hence skip it and the overwritten ones
+		if (head - tail >= ring_size)
+			tail = head - ring_size + 1;
+
+		Change c = ring->changes[tail % ring_size];
+
+		// the entry may have been overwritten while copying it
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) - tail >= ring_size)
+			continue;
+
+		tail++;
+		state = c.state;
+		toggled |= c.toggled;
+	}
+}
+
 bool GpioClient::update() {
+	if (subscribed) {
+		toggled = 0;
+		if (!ring)
+			return receiveChanges();
+		readRing();
+		return true;
+	}
+
 	Request req;
 	memset(&req, 0, sizeof(Request));
 	req.op = GET_BANK;
@@ -73,6 +169,8 @@ bool GpioClient::setupConnection(const char *host, const char *port) {
 	int rv;
 	char s[INET6_ADDRSTRLEN];
 
+	this->port = port;
+
 	memset(&hints, 0, sizeof hints);
 	hints.ai_family = AF_UNSPEC;
 	hints.ai_socktype = SOCK_STREAM;
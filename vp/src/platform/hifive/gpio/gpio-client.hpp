@@ -7,15 +7,30 @@
 
 #pragma once
 
+#include <string>
+
 #include "gpiocommon.hpp"
 
 class GpioClient : public GpioCommon {
 	int fd;
+	std::string port;
+
+	bool subscribed;
+	ChangeRing* ring;
+	uint64_t tail;
+
+	bool receiveChanges();
+	void readRing();
 
    public:
+	// pins that toggled since the last update, also catches short pulses
+	Reg toggled;
+
 	GpioClient();
 	~GpioClient();
 	bool setupConnection(const char* host, const char* port);
+	// let the server push changes, through shared memory if shm (same host only)
+	bool subscribe(bool shm);
 	bool update();
 	bool setBit(uint8_t pos, Tristate val);
 };
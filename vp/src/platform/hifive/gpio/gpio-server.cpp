@@ -9,15 +9,19 @@
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <chrono>
 #include <iostream>
 #include <thread>
 
@@ -32,9 +36,10 @@ void *get_in_addr(struct sockaddr *sa) {
 	return &(((struct sockaddr_in6 *)sa)->sin6_addr);
 }
 
-GpioServer::GpioServer() : fd(-1), stop(false), fun(nullptr) {}
+GpioServer::GpioServer() : fd(-1), stop(false), fun(nullptr), subscribed(false), publishedState(0), ring(nullptr) {}
 
 GpioServer::~GpioServer() {
+	unsubscribe();
 	if (fd >= 0) {
 		cout << "closing gpio-server socket " << fd << endl;
 		close(fd);
@@ -47,6 +52,8 @@ bool GpioServer::setupConnection(const char *port) {
 	int yes = 1;
 	int rv;
 
+	this->port = port;
+
 	memset(&hints, 0, sizeof hints);
 	hints.ai_family = AF_UNSPEC;
 	hints.ai_socktype = SOCK_STREAM;
@@ -129,13 +136,139 @@ void GpioServer::startListening() {
 	}
 }
 
+void GpioServer::publish(uint64_t time) {
+	if (!subscribed)
+		return;
+
+	lock_guard<mutex> lock(pendingMutex);
+	Reg now = state;
+	Reg diff = now ^ publishedState;
+	if (diff == 0)
+		return;
+	publishedState = now;
+
+	// coalesce toggles beyond the batch limit into the last change
+	if (pending.size() < max_batch) {
+		pending.push_back({time, now, diff, 1, 0});
+	} else {
+		Change &last = pending.back();
+		last.time = time;
+		last.state = now;
+		last.toggled |= diff;
+		last.merged++;
+	}
+}
+
+bool GpioServer::subscribe(int conn, bool shm) {
+	uint8_t ok = 1;
+
+	if (shm) {
+		std::string name = ringName(port.c_str());
+		int shmfd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+		if (shmfd < 0 || ftruncate(shmfd, sizeof(ChangeRing)) < 0) {
+			perror("gpio-server: shm_open");
+			ok = 0;
+		} else {
+			void *p = mmap(NULL, sizeof(ChangeRing), PROT_READ | PROT_WRITE, MAP_SHARED, shmfd, 0);
+			if (p == MAP_FAILED) {
+				perror("gpio-server: mmap");
+				ok = 0;
+			} else {
+				ring = reinterpret_cast<ChangeRing *>(p);
+				memset(ring, 0, sizeof(ChangeRing));
+			}
+		}
+		if (shmfd >= 0)
+			close(shmfd);
+	}
+
+	if (write(conn, &ok, sizeof(ok)) != sizeof(ok) || !ok)
+		return false;
+
+	// the first change carries the initial state
+	lock_guard<mutex> lock(pendingMutex);
+	publishedState = state;
+	pending.clear();
+	pending.push_back({0, publishedState, 0, 0, 0});
+	subscribed = true;
+	return true;
+}
+
+void GpioServer::unsubscribe() {
+	subscribed = false;
+	if (ring) {
+		munmap(ring, sizeof(ChangeRing));
+		shm_unlink(ringName(port.c_str()).c_str());
+		ring = nullptr;
+	}
+}
+
+bool GpioServer::flush(int conn) {
+	vector<Change> batch;
+	{
+		lock_guard<mutex> lock(pendingMutex);
+		batch.swap(pending);
+	}
+	if (batch.empty())
+		return true;
+
+	if (ring) {
+		for (auto &c : batch) {
+			ring->changes[ring->head % ring_size] = c;
+			__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+		}
+		return true;
+	}
+
+	uint32_t count = batch.size();
+	if (write(conn, &count, sizeof(count)) != sizeof(count))
+		return false;
+	size_t size = count * sizeof(Change);
+	return write(conn, batch.data(), size) == (ssize_t)size;
+}
+
 void GpioServer::handleConnection(int conn) {
 	Request req;
 	memset(&req, 0, sizeof(Request));
-	int bytes;
-	while ((bytes = read(conn, &req, sizeof(Request))) == sizeof(Request)) {
+	int bytes = 0;
+	auto lastFlush = chrono::steady_clock::now();
+	while (!stop) {
+		// wait for requests, while subscribed at most until the next flush
+		int timeout = -1;
+		if (subscribed) {
+			auto next = lastFlush + chrono::milliseconds(flush_interval_ms);
+			auto now = chrono::steady_clock::now();
+			if (now >= next) {
+				if (!flush(conn)) {
+					cerr << "could not write changes" << endl;
+					break;
+				}
+				lastFlush = now;
+				next = now + chrono::milliseconds(flush_interval_ms);
+			}
+			timeout = chrono::duration_cast<chrono::milliseconds>(next - now).count() + 1;
+		}
+
+		struct pollfd pfd = {conn, POLLIN, 0};
+		int ready = poll(&pfd, 1, timeout);
+		if (ready < 0 && errno != EINTR)
+			break;
+		if (ready <= 0)
+			continue;
+
+		if ((bytes = read(conn, &req, sizeof(Request))) != sizeof(Request))
+			break;
+
 		// hexPrint(reinterpret_cast<char*>(&req), bytes);
 		switch (req.op) {
+			case SUBSCRIBE:
+				if (!subscribe(conn, req.subscribe.shm)) {
+					cerr << "could not subscribe" << endl;
+					unsubscribe();
+					close(conn);
+					return;
+				}
+				break;
 			case GET_BANK:
 				if (write(conn, &state, sizeof(Reg)) != sizeof(Reg)) {
 					cerr << "could not write answer" << endl;
@@ -173,5 +306,6 @@ void GpioServer::handleConnection(int conn) {
 		}
 	}
 	cout << "gpio-client disconnected. (" << bytes << ")" << endl;
+	unsubscribe();
 	close(conn);
 }
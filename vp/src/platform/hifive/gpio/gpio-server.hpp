@@ -7,14 +7,31 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "gpiocommon.hpp"
 
 class GpioServer : public GpioCommon {
 	int fd;
 	volatile bool stop;
 	std::function<void(uint8_t bit, Tristate val)> fun;
+	std::string port;
+
+	// changes not yet sent to the subscriber
+	std::atomic<bool> subscribed;
+	std::mutex pendingMutex;
+	std::vector<Change> pending;
+	Reg publishedState;
+
+	ChangeRing* ring;
+
 	void handleConnection(int conn);
+	bool subscribe(int conn, bool shm);
+	void unsubscribe();
+	bool flush(int conn);
 
    public:
 	GpioServer();
@@ -24,4 +41,6 @@ class GpioServer : public GpioCommon {
 	bool isStopped();
 	void registerOnChange(std::function<void(uint8_t bit, Tristate val)> fun);
 	void startListening();
+	// to be called after state changed, time is the simulation time in ns
+	void publish(uint64_t time);
 };
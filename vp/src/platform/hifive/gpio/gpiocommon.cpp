@@ -36,6 +36,9 @@ void GpioCommon::printRequest(Request* req) {
 		case GET_BANK:
 			cout << "GET BANK";
 			break;
+		case SUBSCRIBE:
+			cout << "SUBSCRIBE" << (req->subscribe.shm ? " SHM" : "");
+			break;
 		case SET_BIT:
 			cout << "SET BIT ";
 			cout << to_string(req->setBit.pos) << " to ";
@@ -59,6 +62,15 @@ void GpioCommon::printRequest(Request* req) {
 	cout << endl;
 };
 
+// odr-used constants (C++14)
+constexpr unsigned GpioCommon::flush_interval_ms;
+constexpr unsigned GpioCommon::max_batch;
+constexpr unsigned GpioCommon::ring_size;
+
+std::string GpioCommon::ringName(const char* port) {
+	return std::string("/riscv-vp-gpio-") + port;
+}
+
 GpioCommon::GpioCommon() {
 	state = 0;
 }
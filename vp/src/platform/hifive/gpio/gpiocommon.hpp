@@ -9,6 +9,7 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <string>
 
 
 void hexPrint(unsigned char* buf, size_t size);
@@ -19,7 +20,7 @@ struct GpioCommon {
 	typedef uint64_t Reg;
 	typedef uint8_t Tristate;
 
-	enum Operation : uint8_t { GET_BANK = 1, SET_BIT, SET_PWM };
+	enum Operation : uint8_t { GET_BANK = 1, SET_BIT, SET_PWM, SUBSCRIBE };
 
 	struct Request {
 		Operation op;
@@ -28,6 +29,9 @@ struct GpioCommon {
 				uint8_t pos : 6;
 				Tristate val : 2;
 			} setBit;
+			struct {
+				uint8_t shm;  // changes go to the shared memory ring instead
+			} subscribe;
 			/*
 			struct
 			{
@@ -38,6 +42,38 @@ struct GpioCommon {
 		};
 	};
 
+	/*
+	 * After SUBSCRIBE the server answers with one byte (1 on success) and
+	 * then pushes changes of the state, GET_BANK must not be used anymore.
+	 * Changes are collected for flush_interval_ms, a batch holds at most
+	 * max_batch changes; further ones are merged into the last one.
+	 * On TCP a batch is a uint32_t count followed by the changes.
+	 */
+	static constexpr unsigned flush_interval_ms = 5;
+	static constexpr unsigned max_batch = 64;
+
+	struct Change {
+		uint64_t time;     // simulation time in ns of the (last merged) change
+		Reg state;         // state after the change
+		Reg toggled;       // bits which changed, including merged changes
+		uint32_t merged;   // number of changes merged into this one
+		uint32_t reserved;
+	};
+
+	/*
+	 * Shared memory transport for clients on the same host. The server
+	 * writes a change and then increments head, hence the entry at head is
+	 * not valid. A reader which fell behind by ring_size changes continues
+	 * with the oldest valid one and retries an entry which was overwritten
+	 * while it copied it.
+	 */
+	static constexpr unsigned ring_size = 1024;
+	struct ChangeRing {
+		uint64_t head;
+		Change changes[ring_size];
+	};
+	static std::string ringName(const char* port);
+
 	Reg state;
 	void printRequest(Request* req);
 	GpioCommon();
@@ -18,6 +18,7 @@
 #include "spi.h"
 #include "uart.h"
 #include "oled.hpp"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -185,10 +186,16 @@ int sc_main(int argc, char **argv) {
 	uart0.plic = &plic;
 	slip.plic = &plic;
 
+	Instrumentation instrumentation(opt, RV32);
+	instrumentation.add_plic(plic, 53, 1, core.cycle_time);
+	instrumentation.add_hart(core);
+	instrumentation.add_bus(bus);
+
 	std::vector<debug_target_if *> threads;
 	threads.push_back(&core);
 
 	core.trace = opt.trace_mode;  // switch for printing instructions
+
 	if (opt.use_debug_runner) {
 		auto server = new GDBServer("GDBServer", threads, &dbg_if, opt.debug_port);
 		new GDBServerRunner("GDBRunner", server, &core);
@@ -196,9 +203,13 @@ int sc_main(int argc, char **argv) {
 		new DirectCoreRunner(core);
 	}
 
+	instrumentation.start();
+
 	sc_core::sc_start();
 
 	core.show();
 
+	instrumentation.report();
+
 	return 0;
 }
@@ -11,10 +11,16 @@
 #include "mmu.h"
 #include "platform/common/slip.h"
 #include "platform/common/uart.h"
+#include "platform/common/virtio_9p.h"
+#include "platform/common/virtio_blk.h"
+#include "platform/common/virtio_console.h"
+#include "platform/common/virtio_net.h"
+#include "platform/common/virtio_vsock.h"
 #include "prci.h"
 #include "syscall.h"
 #include "debug.h"
 #include "util/options.h"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -57,10 +63,26 @@ public:
 	addr_t plic_end_addr = 0x10000000;
 	addr_t prci_start_addr = 0x10000000;
 	addr_t prci_end_addr = 0x1000FFFF;
+	addr_t virtio_net_start_addr = 0x10020000;
+	addr_t virtio_net_end_addr = 0x10020fff;
+	addr_t virtio_blk_start_addr = 0x10021000;
+	addr_t virtio_blk_end_addr = 0x10021fff;
+	addr_t virtio_console_start_addr = 0x10022000;
+	addr_t virtio_console_end_addr = 0x10022fff;
+	addr_t virtio_9p_start_addr = 0x10023000;
+	addr_t virtio_9p_end_addr = 0x10023fff;
+	addr_t virtio_vsock_start_addr = 0x10024000;
+	addr_t virtio_vsock_end_addr = 0x10024fff;
 
 	OptionValue<unsigned long> entry_point;
 	std::string dtb_file;
 	std::string tun_device = "tun0";
+	std::string tap_device;
+	std::string disk_image;
+	std::string disk_overlay;
+	bool virtio_console = false;
+	std::string share_dir;
+	std::string vsock_path;
 
 	LinuxOptions(void) {
         	// clang-format off
@@ -69,7 +91,13 @@ public:
 			("memory-size", po::value<unsigned int>(&mem_size), "set memory size")
 			("entry-point", po::value<std::string>(&entry_point.option),"set entry point address (ISS program counter)")
 			("dtb-file", po::value<std::string>(&dtb_file)->required(), "dtb file for boot loading")
-			("tun-device", po::value<std::string>(&tun_device), "tun device used by SLIP");
+			("tun-device", po::value<std::string>(&tun_device), "tun device used by SLIP")
+			("tap-device", po::value<std::string>(&tap_device), "tap device used by virtio-net (disabled if empty)")
+			("disk-image", po::value<std::string>(&disk_image), "raw disk image used by virtio-blk (disabled if empty)")
+			("disk-overlay", po::value<std::string>(&disk_overlay), "copy-on-write overlay for the disk image, created if missing")
+			("virtio-console", po::bool_switch(&virtio_console), "connect stdin to a virtio console instead of the UART")
+			("share-dir", po::value<std::string>(&share_dir), "host directory exported with virtio-9p as 'hostshare' (disabled if empty)")
+			("vsock-path", po::value<std::string>(&vsock_path), "Unix socket path used by virtio-vsock (disabled if empty)");
         	// clang-format on
 	}
 
@@ -119,15 +147,20 @@ int sc_main(int argc, char **argv) {
 	SimpleMemory mem("SimpleMemory", opt.mem_size);
 	SimpleMemory dtb_rom("DBT_ROM", opt.dtb_rom_size);
 	ELFLoader loader(opt.input_program.c_str());
-	SimpleBus<NUM_CORES + 1, 8> bus("SimpleBus");
+	SimpleBus<NUM_CORES + 1, 13> bus("SimpleBus");
 	SyscallHandler sys("SyscallHandler");
 	FU540_PLIC plic("PLIC", NUM_CORES);
 	CLINT<NUM_CORES> clint("CLINT");
 	PRCI prci("PRCI");
-	UART uart0("UART0", 3);
+	UART uart0("UART0", 3, !opt.virtio_console);
 	SLIP slip("SLIP", 4, opt.tun_device);
 	DebugMemoryInterface dbg_if("DebugMemoryInterface");
 	MemoryDMI dmi = MemoryDMI::create_start_size_mapping(mem.data, opt.mem_start_addr, mem.size);
+	VirtioNet virtio_net("VirtioNet", 5, dmi, opt.tap_device);
+	VirtioBlock virtio_blk("VirtioBlock", 6, dmi, opt.disk_image, opt.disk_overlay);
+	VirtioConsole virtio_console("VirtioConsole", 7, dmi, opt.virtio_console);
+	Virtio9P virtio_9p("Virtio9P", 8, dmi, opt.share_dir);
+	VirtioVsock virtio_vsock("VirtioVsock", 9, dmi, opt.vsock_path);
 
 	Core *cores[NUM_CORES];
 	for (unsigned i = 0; i < NUM_CORES; i++) {
@@ -163,6 +196,11 @@ int sc_main(int argc, char **argv) {
 	bus.ports[5] = new PortMapping(opt.uart1_start_addr, opt.uart1_end_addr);
 	bus.ports[6] = new PortMapping(opt.plic_start_addr, opt.plic_end_addr);
 	bus.ports[7] = new PortMapping(opt.prci_start_addr, opt.prci_end_addr);
+	bus.ports[8] = new PortMapping(opt.virtio_net_start_addr, opt.virtio_net_end_addr);
+	bus.ports[9] = new PortMapping(opt.virtio_blk_start_addr, opt.virtio_blk_end_addr);
+	bus.ports[10] = new PortMapping(opt.virtio_console_start_addr, opt.virtio_console_end_addr);
+	bus.ports[11] = new PortMapping(opt.virtio_9p_start_addr, opt.virtio_9p_end_addr);
+	bus.ports[12] = new PortMapping(opt.virtio_vsock_start_addr, opt.virtio_vsock_end_addr);
 
 	// connect TLM sockets
 	for (size_t i = 0; i < NUM_CORES; i++) {
@@ -177,6 +215,11 @@ int sc_main(int argc, char **argv) {
 	bus.isocks[5].bind(slip.tsock);
 	bus.isocks[6].bind(plic.tsock);
 	bus.isocks[7].bind(prci.tsock);
+	bus.isocks[8].bind(virtio_net.tsock);
+	bus.isocks[9].bind(virtio_blk.tsock);
+	bus.isocks[10].bind(virtio_console.tsock);
+	bus.isocks[11].bind(virtio_9p.tsock);
+	bus.isocks[12].bind(virtio_vsock.tsock);
 
 	// connect interrupt signals/communication
 	for (size_t i = 0; i < NUM_CORES; i++) {
@@ -185,10 +228,20 @@ int sc_main(int argc, char **argv) {
 	}
 	uart0.plic = &plic;
 	slip.plic = &plic;
+	virtio_net.plic = &plic;
+	virtio_blk.plic = &plic;
+	virtio_console.plic = &plic;
+	virtio_9p.plic = &plic;
+	virtio_vsock.plic = &plic;
+
+	Instrumentation instrumentation(opt, RV64);
+	instrumentation.add_plic(plic, FU540_PLIC_NUMIRQ + 1, NUM_CORES, cores[0]->iss.cycle_time);
+	instrumentation.add_bus(bus);
 
 	for (size_t i = 0; i < NUM_CORES; i++) {
 		// switch for printing instructions
 		cores[i]->iss.trace = opt.trace_mode;
+		instrumentation.add_hart(cores[i]->iss);
 
 		// ignore WFI instructions (handle them as a NOP, which is ok according to the RISC-V ISA) to avoid running too
 		// fast ahead with simulation time when the CPU is idle
@@ -228,10 +281,13 @@ int sc_main(int argc, char **argv) {
 		}
 	}
 
+	instrumentation.start();
+
 	sc_core::sc_start();
 	for (size_t i = 0; i < NUM_CORES; i++) {
 		cores[i]->iss.show();
 	}
+	instrumentation.report();
 
 	return 0;
 }
@@ -15,6 +15,7 @@
 #include "syscall.h"
 #include "debug.h"
 #include "util/options.h"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -186,9 +187,14 @@ int sc_main(int argc, char **argv) {
 	uart0.plic = &plic;
 	slip.plic = &plic;
 
+	Instrumentation instrumentation(opt, RV32);
+	instrumentation.add_plic(plic, FU540_PLIC_NUMIRQ + 1, NUM_CORES, cores[0]->iss.cycle_time);
+	instrumentation.add_bus(bus);
+
 	for (size_t i = 0; i < NUM_CORES; i++) {
 		// switch for printing instructions
 		cores[i]->iss.trace = opt.trace_mode;
+		instrumentation.add_hart(cores[i]->iss);
 
 		// ignore WFI instructions (handle them as a NOP, which is ok according to the RISC-V ISA) to avoid running too
 		// fast ahead with simulation time when the CPU is idle
@@ -232,10 +238,13 @@ int sc_main(int argc, char **argv) {
 		}
 	}
 
+	instrumentation.start();
+
 	sc_core::sc_start();
 	for (size_t i = 0; i < NUM_CORES; i++) {
 		cores[i]->iss.show();
 	}
+	instrumentation.report();
 
 	return 0;
 }
@@ -0,0 +1,513 @@
+/*
+ * Microbenchmarks of the building blocks on the hot paths of the simulation:
+ * instruction decoding, address translation, bus and register routing, the
+ * PLIC interrupt selection, CSR accesses and traps. Each component is driven
+ * directly, without a platform or a running simulation, and the time per
+ * operation is reported. Use it to measure optimizations of one component in
+ * isolation, the whole program benchmarks live in bench/.
+ *
+ * Every benchmark runs in batches, doubling the batch size until a batch
+ * takes long enough for a stable clock reading. The best of several batches
+ * is reported, being the least disturbed by the host.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bus.h"
+#include "core/common/instr.h"
+#include "core/rv32/iss.h"
+#include "core/rv32/mmu.h"
+#include "fe310_plic.h"
+#include "util/memory_map.h"
+#include "util/tlm_map.h"
+
+using namespace rv32;
+namespace po = boost::program_options;
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+// forces the compiler to compute the value, without storing it anywhere
+template <typename T>
+inline void do_not_optimize(const T &value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// xorshift, for reproducible access patterns
+struct Random {
+	uint32_t state = 0x2545f491;
+
+	uint32_t next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+};
+
+// inputs of randomized benchmarks are precomputed, indexed with i & PATTERN_MASK
+constexpr unsigned PATTERN_SIZE = 4096;
+constexpr unsigned PATTERN_MASK = PATTERN_SIZE - 1;
+
+struct Benchmark {
+	std::string name;
+	std::function<void(uint64_t iterations)> run;
+};
+
+double run_batch(const Benchmark &b, uint64_t iterations) {
+	auto start = bench_clock::now();
+	b.run(iterations);
+	return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+double measure_ns_per_op(const Benchmark &b, double min_time, unsigned repetitions) {
+	double batch_time = min_time / repetitions;
+	uint64_t iterations = 1;
+	double t;
+	while ((t = run_batch(b, iterations)) < batch_time) iterations *= 2;
+
+	double best = t / iterations;
+	for (unsigned i = 1; i < repetitions; ++i) best = std::min(best, run_batch(b, iterations) / iterations);
+	return best * 1e9;
+}
+
+/*
+ * Decoder
+ */
+
+// typical mix: ALU, loads/stores, branches, jumps, M, A, F and CSR instructions
+const uint32_t normal_instrs[16] = {
+    0x00108093,  // addi ra, ra, 1
+    0x00012283,  // lw t0, 0(sp)
+    0x00512223,  // sw t0, 4(sp)
+    0x00208463,  // beq ra, sp, 8
+    0x010000ef,  // jal ra, 16
+    0x022081b3,  // mul gp, ra, sp
+    0x002081b3,  // add gp, ra, sp
+    0x123452b7,  // lui t0, 0x12345
+    0x0020a1af,  // amoadd.w gp, sp, (ra)
+    0x003100d3,  // fadd.s ft1, ft2, ft3
+    0x34009073,  // csrw mscratch, ra
+    0x40208133,  // sub sp, ra, sp
+    0x0040a303,  // lw t1, 4(ra)
+    0xfe209ee3,  // bne ra, sp, -4
+    0x00008067,  // ret
+    0x0060f1b3,  // and gp, ra, t1
+};
+
+const uint16_t compressed_instrs[16] = {
+    0x0405,  // c.addi s0, 1
+    0x4104,  // c.lw s1, 0(a0)
+    0xc104,  // c.sw s1, 0(a0)
+    0x852e,  // c.mv a0, a1
+    0x952e,  // c.add a0, a1
+    0xa001,  // c.j 0
+    0xc001,  // c.beqz s0, 0
+    0x4082,  // c.lwsp ra, 0(sp)
+    0x4515,  // c.li a0, 5
+    0x8082,  // c.ret
+    0x1141,  // c.addi sp, -16
+    0xc606,  // c.swsp ra, 12(sp)
+    0x0505,  // c.addi a0, 1
+    0x8d05,  // c.sub a0, s1
+    0xe011,  // c.bnez s0, 4
+    0x4501,  // c.li a0, 0
+};
+
+void add_decoder_benchmarks(std::vector<Benchmark> &benchmarks) {
+	benchmarks.push_back({"decode_normal", [](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      Instruction instr(normal_instrs[i & 15]);
+			                      do_not_optimize(instr.decode_normal(RV32));
+		                      }
+	                      }});
+	benchmarks.push_back({"decode_and_expand_compressed", [](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      Instruction instr(compressed_instrs[i & 15]);
+			                      do_not_optimize(instr.decode_and_expand_compressed(RV32));
+			                      do_not_optimize(instr.data());
+		                      }
+	                      }});
+}
+
+/*
+ * MMU
+ */
+
+// page tables in host memory, physical address zero is the first byte
+struct PageTableMemory : public mmu_memory_if {
+	std::vector<uint8_t> mem;
+
+	PageTableMemory(size_t size) : mem(size) {}
+
+	uint64_t v2p(uint64_t vaddr, MemoryAccessType) override {
+		return vaddr;
+	}
+
+	uint64_t mmu_load_pte64(uint64_t addr) override {
+		uint64_t pte;
+		memcpy(&pte, &mem.at(addr), sizeof(pte));
+		return pte;
+	}
+
+	uint64_t mmu_load_pte32(uint64_t addr) override {
+		uint32_t pte;
+		memcpy(&pte, &mem.at(addr), sizeof(pte));
+		return pte;
+	}
+
+	void mmu_store_pte32(uint64_t addr, uint32_t value) override {
+		memcpy(&mem.at(addr), &value, sizeof(value));
+	}
+};
+
+// satisfies the trap handling of the ISS, which releases LR/SC reservations
+struct NullDataMemory : public data_memory_if {
+	int64_t load_double(uint64_t) override {
+		return 0;
+	}
+	int32_t load_word(uint64_t) override {
+		return 0;
+	}
+	int32_t load_half(uint64_t) override {
+		return 0;
+	}
+	int32_t load_byte(uint64_t) override {
+		return 0;
+	}
+	uint32_t load_uhalf(uint64_t) override {
+		return 0;
+	}
+	uint32_t load_ubyte(uint64_t) override {
+		return 0;
+	}
+	void store_double(uint64_t, uint64_t) override {}
+	void store_word(uint64_t, uint32_t) override {}
+	void store_half(uint64_t, uint16_t) override {}
+	void store_byte(uint64_t, uint8_t) override {}
+	int32_t atomic_load_word(uint64_t) override {
+		return 0;
+	}
+	void atomic_store_word(uint64_t, uint32_t) override {}
+	int32_t atomic_load_reserved_word(uint64_t) override {
+		return 0;
+	}
+	bool atomic_store_conditional_word(uint64_t, uint32_t) override {
+		return false;
+	}
+	void atomic_unlock() override {}
+	void flush_tlb() override {}
+};
+
+// Sv32 mapping of MMU_PAGES pages at MMU_VA_BASE in S-mode, scattered over
+// the physical address space
+constexpr unsigned MMU_PAGES = 4096;
+constexpr uint32_t MMU_VA_BASE = 0x40000000;
+
+struct MMUFixture {
+	ISS core{0};
+	PageTableMemory mem{(1 + MMU_PAGES / 1024) * PGSIZE};
+	MMU mmu{core};
+	std::vector<uint32_t> addrs;
+
+	MMUFixture() {
+		Random rand;
+		const uint32_t root = 0;
+		for (unsigned t = 0; t < MMU_PAGES / 1024; ++t) {
+			uint32_t table = (1 + t) * PGSIZE;
+			uint32_t pte = ((table >> PGSHIFT) << PTE_PPN_SHIFT) | PTE_V;
+			mem.mmu_store_pte32(root + ((MMU_VA_BASE >> 22) + t) * 4, pte);
+
+			for (unsigned i = 0; i < 1024; ++i) {
+				uint32_t ppn = 0x80000 + (rand.next() & 0x3ffff);
+				mem.mmu_store_pte32(table + i * 4,
+				                    (ppn << PTE_PPN_SHIFT) | PTE_V | PTE_R | PTE_W | PTE_A | PTE_D);
+			}
+		}
+
+		core.csrs.satp.mode = SATP_MODE_SV32;
+		core.csrs.satp.ppn = root >> PGSHIFT;
+		core.prv = SupervisorMode;
+		mmu.mem = &mem;
+
+		for (unsigned i = 0; i < PATTERN_SIZE; ++i)
+			addrs.push_back(MMU_VA_BASE + (rand.next() % MMU_PAGES) * PGSIZE + (rand.next() & PGMASK));
+	}
+};
+
+void add_mmu_benchmarks(std::vector<Benchmark> &benchmarks) {
+	auto f = std::make_shared<MMUFixture>();
+
+	benchmarks.push_back({"mmu_tlb_hit", [f](uint64_t n) {
+		                      // 64 pages, each in its own TLB entry
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      uint32_t addr = MMU_VA_BASE + (i & 63) * PGSIZE;
+			                      do_not_optimize(f->mmu.translate_virtual_to_physical_addr(addr, LOAD));
+		                      }
+	                      }});
+	benchmarks.push_back({"mmu_translate_random", [f](uint64_t n) {
+		                      // mostly TLB misses, 256 entries for 4096 pages
+		                      for (uint64_t i = 0; i < n; ++i)
+			                      do_not_optimize(
+			                          f->mmu.translate_virtual_to_physical_addr(f->addrs[i & PATTERN_MASK], LOAD));
+	                      }});
+	benchmarks.push_back({"mmu_walk_sv32", [f](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i)
+			                      do_not_optimize(f->mmu.walk(f->addrs[i & PATTERN_MASK], LOAD, SupervisorMode));
+	                      }});
+}
+
+/*
+ * Bus and register routing
+ */
+
+constexpr unsigned BUS_TARGETS = 16;
+
+struct BusFixture {
+	SimpleBus<1, BUS_TARGETS> bus{"SimpleBus"};
+	std::vector<std::unique_ptr<PortMapping>> mappings;
+	std::vector<uint64_t> addrs;
+
+	BusFixture() {
+		Random rand;
+		// a memory at zero and peripherals in the usual 0x02000000 - 0x20000000 range
+		for (unsigned i = 0; i < BUS_TARGETS; ++i) {
+			uint64_t start = i == 0 ? 0 : 0x02000000 + (uint64_t)i * 0x01000000;
+			uint64_t end = start + (i == 0 ? 0x01ffffff : 0xffff);
+			mappings.emplace_back(new PortMapping(start, end));
+			bus.ports[i] = mappings.back().get();
+		}
+		for (unsigned i = 0; i < PATTERN_SIZE; ++i) {
+			auto &m = *mappings[rand.next() % BUS_TARGETS];
+			addrs.push_back(m.start + rand.next() % (m.end - m.start + 1));
+		}
+	}
+};
+
+// a peripheral register file like the CLINT
+struct RegisterRangeFixture {
+	RegisterRange regs_a{0x0, 4 * 4};
+	RegisterRange regs_b{0x4000, 8 * 4};
+	RegisterRange regs_c{0xbff8, 8};
+	std::vector<RegisterRange *> register_ranges{&regs_a, &regs_b, &regs_c};
+
+	tlm::tlm_generic_payload trans;
+	sc_core::sc_time delay;
+	uint32_t data = 0;
+
+	RegisterRangeFixture() {
+		trans.set_command(tlm::TLM_READ_COMMAND);
+		trans.set_data_ptr((unsigned char *)&data);
+		trans.set_data_length(4);
+	}
+};
+
+// a peripheral based on vp::map like the UART
+struct LocalRouterFixture {
+	vp::map::LocalRouter router{"LocalRouter"};
+	std::array<uint32_t, 8> regs{};
+
+	tlm::tlm_generic_payload trans;
+	sc_core::sc_time delay;
+	uint32_t data = 0;
+
+	LocalRouterFixture() {
+		std::vector<vp::map::reg_mapping_t> mappings;
+		for (unsigned i = 0; i < regs.size(); ++i) mappings.push_back({i * 4, &regs[i]});
+		router.add_register_bank(mappings).register_handler([](const vp::map::register_access_t &r) { r.fn(); });
+
+		trans.set_command(tlm::TLM_READ_COMMAND);
+		trans.set_data_ptr((unsigned char *)&data);
+		trans.set_data_length(4);
+	}
+};
+
+void add_routing_benchmarks(std::vector<Benchmark> &benchmarks) {
+	auto bus = std::make_shared<BusFixture>();
+	benchmarks.push_back({"SimpleBus::decode", [bus](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) do_not_optimize(bus->bus.decode(bus->addrs[i & PATTERN_MASK]));
+	                      }});
+
+	auto ranges = std::make_shared<RegisterRangeFixture>();
+	benchmarks.push_back({"vp::mm::route", [ranges](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      // alternate between the first and the last range
+			                      ranges->trans.set_address(i & 1 ? 0xbff8 : 0x4);
+			                      vp::mm::route("RegisterRangeFixture", ranges->register_ranges, ranges->trans,
+			                                    ranges->delay);
+			                      do_not_optimize(ranges->data);
+		                      }
+	                      }});
+
+	auto router = std::make_shared<LocalRouterFixture>();
+	benchmarks.push_back({"LocalRouter::transport", [router](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      router->trans.set_address((i & 7) * 4);
+			                      router->router.transport(router->trans, router->delay);
+			                      do_not_optimize(router->data);
+		                      }
+	                      }});
+}
+
+/*
+ * PLIC
+ */
+
+// same configuration as on the HiFive1
+typedef FE310_PLIC<1, 53, 64, 7> PLIC;
+
+void add_plic_benchmarks(std::vector<Benchmark> &benchmarks) {
+	auto plic = std::make_shared<PLIC>("PLIC");
+
+	// all sources enabled and with mixed priorities, one of them pending (set
+	// directly, gateway_trigger_interrupt would schedule the PLIC thread)
+	for (unsigned i = 0; i < PLIC::NumberInterruptWords; ++i) plic->hart_enabled_interrupts(0, i) = ~0u;
+	for (unsigned i = 1; i < 53; ++i) plic->interrupt_priorities[i] = 1 + i % 7;
+	plic->pending_interrupts[42 / 32] |= 1u << (42 % 32);
+
+	benchmarks.push_back({"FE310_PLIC::hart_get_next_pending_interrupt(1 pending)", [plic](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i)
+			                      do_not_optimize(plic->hart_get_next_pending_interrupt(0, true));
+	                      }});
+
+	auto busy = std::make_shared<PLIC>("PLIC-busy");
+	for (unsigned i = 0; i < PLIC::NumberInterruptWords; ++i) busy->hart_enabled_interrupts(0, i) = ~0u;
+	for (unsigned i = 1; i < 53; ++i) {
+		busy->interrupt_priorities[i] = 1 + i % 7;
+		busy->pending_interrupts[i / 32] |= 1u << (i % 32);
+	}
+
+	benchmarks.push_back({"FE310_PLIC::hart_get_next_pending_interrupt(all pending)", [busy](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i)
+			                      do_not_optimize(busy->hart_get_next_pending_interrupt(0, true));
+	                      }});
+}
+
+/*
+ * ISS: CSRs and traps
+ */
+
+struct ISSFixture {
+	ISS core{0};
+	NullDataMemory mem;
+
+	ISSFixture() {
+		core.mem = &mem;
+		core.csrs.mtvec.reg = 0x100;
+		core.pc = core.last_pc = 0x1000;
+	}
+};
+
+void add_iss_benchmarks(std::vector<Benchmark> &benchmarks) {
+	auto f = std::make_shared<ISSFixture>();
+
+	// mscratch takes the generic path through csr_table::register_mapping,
+	// mstatus one of the special cases
+	benchmarks.push_back({"csr_read(mscratch)", [f](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) do_not_optimize(f->core.get_csr_value(csr::MSCRATCH_ADDR));
+	                      }});
+	benchmarks.push_back({"csr_write(mscratch)", [f](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) f->core.set_csr_value(csr::MSCRATCH_ADDR, i);
+		                      do_not_optimize(f->core.csrs.mscratch.reg);
+	                      }});
+	benchmarks.push_back({"csr_read(mstatus)", [f](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) do_not_optimize(f->core.get_csr_value(csr::MSTATUS_ADDR));
+	                      }});
+	benchmarks.push_back({"csr_write(mstatus)", [f](uint64_t n) {
+		                      for (uint64_t i = 0; i < n; ++i) f->core.set_csr_value(csr::MSTATUS_ADDR, (i & 1) << 3);
+		                      do_not_optimize(f->core.csrs.mstatus.reg);
+	                      }});
+
+	// the state transitions only, as for an ecall followed by mret
+	benchmarks.push_back({"trap_entry_exit", [f](uint64_t n) {
+		                      auto &core = f->core;
+		                      SimulationTrap e{EXC_ECALL_M_MODE, 0};
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      auto target_mode = core.prepare_trap(e);
+			                      core.switch_to_trap_handler(target_mode);
+			                      core.return_from_trap_handler(MachineMode);
+			                      core.pc = 0x1000;
+		                      }
+		                      do_not_optimize(core.pc);
+	                      }});
+	// including the C++ exception, which is how the ISS raises traps
+	benchmarks.push_back({"trap_raise_entry_exit", [f](uint64_t n) {
+		                      auto &core = f->core;
+		                      for (uint64_t i = 0; i < n; ++i) {
+			                      try {
+				                      raise_trap(EXC_ECALL_M_MODE, 0);
+			                      } catch (SimulationTrap &e) {
+				                      auto target_mode = core.prepare_trap(e);
+				                      core.switch_to_trap_handler(target_mode);
+			                      }
+			                      core.return_from_trap_handler(MachineMode);
+			                      core.pc = 0x1000;
+		                      }
+		                      do_not_optimize(core.pc);
+	                      }});
+}
+
+}  // namespace
+
+int sc_main(int argc, char **argv) {
+	std::string filter;
+	double min_time = 0.5;
+	unsigned repetitions = 5;
+
+	po::options_description desc("Usage: microbench [options]\nOptions");
+	// clang-format off
+	desc.add_options()
+		("help", "produce help message")
+		("filter", po::value<std::string>(&filter), "only run benchmarks whose name contains the given string")
+		("min-time", po::value<double>(&min_time), "minimum host seconds spent per benchmark (default 0.5)")
+		("repetitions", po::value<unsigned>(&repetitions), "number of timed batches, the best is reported (default 5)")
+		("list", "list the benchmarks without running them");
+	// clang-format on
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		if (vm.count("help")) {
+			std::cout << desc << std::endl;
+			return 0;
+		}
+		po::notify(vm);
+	} catch (po::error &e) {
+		std::cerr << "Error parsing command line options: " << e.what() << std::endl;
+		return 1;
+	}
+	if (repetitions == 0)
+		repetitions = 1;
+
+	// required by the ISS, which is created without a platform
+	tlm::tlm_global_quantum::instance().set(sc_core::sc_time(10, sc_core::SC_US));
+
+	std::vector<Benchmark> benchmarks;
+	add_decoder_benchmarks(benchmarks);
+	add_mmu_benchmarks(benchmarks);
+	add_routing_benchmarks(benchmarks);
+	add_plic_benchmarks(benchmarks);
+	add_iss_benchmarks(benchmarks);
+
+	for (auto &b : benchmarks) {
+		if (b.name.find(filter) == std::string::npos)
+			continue;
+		if (vm.count("list")) {
+			std::cout << b.name << std::endl;
+			continue;
+		}
+		printf("%-58s %10.2f ns/op\n", b.name.c_str(), measure_ns_per_op(b, min_time, repetitions));
+		fflush(stdout);
+	}
+
+	return 0;
+}
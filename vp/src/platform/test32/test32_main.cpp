@@ -8,6 +8,7 @@
 #include "mem.h"
 #include "memory.h"
 #include "syscall.h"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -149,6 +150,10 @@ int sc_main(int argc, char **argv) {
     // switch for printing instructions
     core.trace = opt.trace_mode;
 
+    Instrumentation instrumentation(opt, RV32);
+    instrumentation.add_hart(core);
+    instrumentation.add_bus(bus);
+
     std::vector<debug_target_if *> threads;
     threads.push_back(&core);
 
@@ -201,10 +206,14 @@ int sc_main(int argc, char **argv) {
             core.csrs.misa.extensions |= core.csrs.misa.S | core.csrs.misa.U; // NOTE: S mode implies U mode
     }
 
+    instrumentation.start();
+
     sc_core::sc_start();
 
     core.show();
 
+    instrumentation.report();
+
     if (!opt.test_signature.empty()) {
         dump_test_signature(opt, mem.data, loader);
     }
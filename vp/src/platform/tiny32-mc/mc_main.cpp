@@ -7,6 +7,7 @@
 #include "mem.h"
 #include "memory.h"
 #include "syscall.h"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -111,6 +112,11 @@ int sc_main(int argc, char **argv) {
 	core0.trace = opt.trace_mode;
 	core1.trace = opt.trace_mode;
 
+	Instrumentation instrumentation(opt, RV32);
+	instrumentation.add_hart(core0);
+	instrumentation.add_hart(core1);
+	instrumentation.add_bus(bus);
+
 	std::vector<debug_target_if *> threads;
 	threads.push_back(&core0);
 	threads.push_back(&core1);
@@ -127,11 +133,15 @@ int sc_main(int argc, char **argv) {
 	if (opt.quiet)
 		sc_core::sc_report_handler::set_verbosity_level(sc_core::SC_NONE);
 
+	instrumentation.start();
+
 	sc_core::sc_start();
 	if (!opt.quiet) {
 		core0.show();
 		core1.show();
 	}
 
+	instrumentation.report();
+
 	return 0;
 }
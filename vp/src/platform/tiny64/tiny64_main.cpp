@@ -9,6 +9,7 @@
 #include "memory.h"
 #include "mmu.h"
 #include "syscall.h"
+#include "platform/common/instrumentation.h"
 #include "platform/common/options.h"
 
 #include "gdb-mc/gdb_server.h"
@@ -113,6 +114,10 @@ int sc_main(int argc, char **argv) {
 	// switch for printing instructions
 	core.trace = opt.trace_mode;
 
+	Instrumentation instrumentation(opt, RV64);
+	instrumentation.add_hart(core);
+	instrumentation.add_bus(bus);
+
 	std::vector<debug_target_if *> threads;
 	threads.push_back(&core);
 
@@ -126,10 +131,14 @@ int sc_main(int argc, char **argv) {
 	if (opt.quiet)
 		 sc_core::sc_report_handler::set_verbosity_level(sc_core::SC_NONE);
 
+	instrumentation.start();
+
 	sc_core::sc_start();
 	if (!opt.quiet) {
 		core.show();
 	}
 
+	instrumentation.report();
+
 	return 0;
 }
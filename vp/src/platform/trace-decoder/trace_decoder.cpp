@@ -0,0 +1,227 @@
+/*
+ * Converts binary instruction traces (--trace-file) to text, one line per
+ * instruction like --trace-mode prints them, followed by the recorded
+ * effects: the register written, the memory address accessed or the
+ * exception raised. Chunks of different harts are printed in file order.
+ * With --elf the pc is annotated with the enclosing function.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "core/common/instr.h"
+#include "core/common/symbol_index.h"
+#include "core/common/trace.h"
+
+namespace io = boost::iostreams;
+namespace po = boost::program_options;
+
+static const char *regnames[] = {
+    "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6",   "a7", "s2", "s3", "s4",  "s5",  "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+};
+
+struct Decoder {
+	Architecture arch;
+	unsigned hex_digits;
+	int hart = -1;
+	bool show_count = false;
+	SymbolIndex symbols;
+
+	const uint8_t *p;
+	const uint8_t *end;
+
+	uint8_t byte() {
+		if (p >= end)
+			throw std::runtime_error("truncated record");
+		return *p++;
+	}
+
+	uint64_t varint() {
+		uint64_t v = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7) {
+			uint8_t b = byte();
+			v |= (uint64_t)(b & 0x7f) << shift;
+			if (!(b & 0x80))
+				return v;
+		}
+		throw std::runtime_error("invalid varint");
+	}
+
+	int64_t delta() {
+		uint64_t v = varint();
+		return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+	}
+
+	void print_operands(Instruction instr, Opcode::Mapping op) {
+		switch (Opcode::getType(op)) {
+			case Opcode::Type::R:
+				printf("%s, %s, %s", regnames[instr.rd()], regnames[instr.rs1()], regnames[instr.rs2()]);
+				break;
+			case Opcode::Type::I:
+				printf("%s, %s, 0x%x", regnames[instr.rd()], regnames[instr.rs1()], instr.I_imm());
+				break;
+			case Opcode::Type::S:
+				printf("%s, %s, 0x%x", regnames[instr.rs1()], regnames[instr.rs2()], instr.S_imm());
+				break;
+			case Opcode::Type::B:
+				printf("%s, %s, 0x%x", regnames[instr.rs1()], regnames[instr.rs2()], instr.B_imm());
+				break;
+			case Opcode::Type::U:
+				printf("%s, 0x%x", regnames[instr.rd()], instr.U_imm());
+				break;
+			case Opcode::Type::J:
+				printf("%s, 0x%x", regnames[instr.rd()], instr.J_imm());
+				break;
+			default:;
+		}
+	}
+
+	void decode_chunk(const TraceFormat::ChunkHeader &header, const std::vector<uint8_t> &data) {
+		p = data.data();
+		end = p + data.size();
+
+		uint64_t n = header.first_instr;
+		uint64_t next_pc = 0;
+		uint64_t addr = 0;
+		unsigned prv = 0;
+		uint64_t mask = arch == RV32 ? UINT32_MAX : UINT64_MAX;
+
+		for (uint32_t i = 0; i < header.count; ++i) {
+			uint8_t f = byte();
+			if (f & TraceFormat::SKIP)
+				n += varint();
+			uint64_t pc = next_pc;
+			if (f & TraceFormat::JUMP)
+				pc = (pc + delta()) & mask;
+			if (f & TraceFormat::PRV)
+				prv = byte();
+			bool trapped = f & TraceFormat::TRAP;
+			uint64_t cause = trapped ? varint() : 0;
+			if (f & TraceFormat::MEM)
+				addr = (addr + delta()) & mask;
+			unsigned xreg = 0, freg = 0;
+			uint64_t xval = 0, fval = 0;
+			if (f & TraceFormat::XREG) {
+				xreg = byte();
+				xval = varint();
+			}
+			if (f & TraceFormat::FREG) {
+				freg = byte();
+				fval = varint();
+			}
+
+			unsigned len = (f & TraceFormat::RVC) ? 2 : 4;
+			uint32_t word = 0;
+			for (unsigned k = 0; k < len; ++k) word |= (uint32_t)byte() << (8 * k);
+			next_pc = (pc + len) & mask;
+
+			Instruction instr(word);
+			Opcode::Mapping op = len == 2 ? instr.decode_and_expand_compressed(arch) : instr.decode_normal(arch);
+
+			if (show_count)
+				printf("%10lu ", (unsigned long)n);
+			printf("core %2u: prv %1x: pc %*lx: ", header.hart, prv, hex_digits, (unsigned long)pc);
+			if (!symbols.empty())
+				printf("<%s> ", symbols.describe(pc).c_str());
+			printf("%s ", Opcode::mappingStr.at(op));
+			print_operands(instr, op);
+			if (f & TraceFormat::MEM)
+				printf(" [%lx]", (unsigned long)addr);
+			if (f & TraceFormat::XREG)
+				printf(" %s=%lx", regnames[xreg], (unsigned long)xval);
+			if (f & TraceFormat::FREG)
+				printf(" f%u=%016lx", freg, (unsigned long)fval);
+			if (trapped)
+				printf(" trap %lu", (unsigned long)cause);
+			puts("");
+
+			++n;
+		}
+	}
+
+	void run(std::istream &in) {
+		TraceFormat::FileHeader file_header;
+		if (!in.read((char *)&file_header, sizeof(file_header)) ||
+		    memcmp(file_header.magic, TraceFormat::magic, sizeof(file_header.magic)) != 0)
+			throw std::runtime_error("not an instruction trace");
+		if (file_header.version != TraceFormat::version)
+			throw std::runtime_error("unsupported trace version " + std::to_string(file_header.version));
+		arch = file_header.xlen == 32 ? RV32 : RV64;
+		hex_digits = file_header.xlen / 4;
+
+		TraceFormat::ChunkHeader header;
+		std::vector<uint8_t> data;
+		while (in.read((char *)&header, sizeof(header))) {
+			data.resize(header.size);
+			if (!in.read((char *)data.data(), header.size))
+				throw std::runtime_error("truncated chunk");
+			if (hart < 0 || (unsigned)hart == header.hart)
+				decode_chunk(header, data);
+		}
+	}
+};
+
+int main(int argc, char **argv) {
+	Decoder decoder;
+	std::string input;
+	std::vector<std::string> elfs;
+
+	po::options_description desc("Usage: trace-decoder [options] trace-file\nOptions");
+	// clang-format off
+	desc.add_options()
+		("help", "produce help message")
+		("hart", po::value<int>(&decoder.hart), "only print instructions of the given hart")
+		("elf", po::value<std::vector<std::string>>(&elfs)->composing(), "annotate pcs with the symbols of ELF FILE[@OFFSET] (repeatable)")
+		("instr-count", po::bool_switch(&decoder.show_count), "prefix lines with the number of the executed instruction")
+		("input-file", po::value<std::string>(&input)->required(), "trace file written with --trace-file");
+	// clang-format on
+	po::positional_options_description pos;
+	pos.add("input-file", 1);
+
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+		if (vm.count("help")) {
+			std::cout << desc << std::endl;
+			return 0;
+		}
+		po::notify(vm);
+	} catch (po::error &e) {
+		std::cerr << "Error parsing command line options: " << e.what() << std::endl;
+		return 1;
+	}
+
+	try {
+		for (auto &spec : elfs) decoder.symbols.add_elf(SymbolIndex::File::parse(spec));
+	} catch (std::exception &e) {
+		std::cerr << "trace-decoder: " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::ifstream file(input, std::ios::binary);
+	if (!file) {
+		std::cerr << "unable to open " << input << std::endl;
+		return 1;
+	}
+
+	io::filtering_istream in;
+	in.push(io::gzip_decompressor());
+	in.push(file);
+
+	try {
+		decoder.run(in);
+	} catch (std::exception &e) {
+		std::cerr << "trace-decoder: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <array>
+#include <atomic>
+
+/*
+ * Bounded lock-free single-producer/single-consumer ring buffer. Used to hand
+ * data between host I/O threads and the SystemC thread without taking locks.
+ * Only one thread may push and only one (other) thread may pop.
+ */
+template <typename T, size_t Capacity>
+class SPSCQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+	std::array<T, Capacity> buf;
+
+	// indices grow monotonically, positions are taken modulo the capacity. The
+	// padding keeps producer and consumer index on separate cache lines (no
+	// alignas, over-aligned heap allocation is not available in C++14).
+	std::atomic<size_t> head{0};  // next element to pop, written by the consumer
+	char pad[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail{0};  // next free slot, written by the producer
+
+   public:
+	bool push(const T &value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) >= Capacity)
+			return false;
+
+		buf[t % Capacity] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Reserve the next free slot for in-place construction by the producer,
+	 * returns nullptr if the queue is full. Must be followed by commit(). */
+	T *reserve() {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) >= Capacity)
+			return nullptr;
+		return &buf[t % Capacity];
+	}
+
+	void commit() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	bool pop(T &value) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+
+		value = buf[h % Capacity];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Pop up to the given number of elements at once, returns the number
+	 * of elements actually popped. */
+	size_t pop(T *values, size_t max) {
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t n = tail.load(std::memory_order_acquire) - h;
+		if (n > max)
+			n = max;
+
+		for (size_t i = 0; i < n; i++)
+			values[i] = buf[(h + i) % Capacity];
+		head.store(h + n, std::memory_order_release);
+		return n;
+	}
+
+	/* Access the oldest element without removing it, returns nullptr if the
+	 * queue is empty. Must be followed by release() on the consumer side. */
+	T *front() {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return nullptr;
+		return &buf[h % Capacity];
+	}
+
+	void release() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	size_t size() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	bool full() const {
+		return size() >= Capacity;
+	}
+
+	static constexpr size_t capacity() {
+		return Capacity;
+	}
+};
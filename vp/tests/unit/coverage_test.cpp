@@ -0,0 +1,106 @@
+#define BOOST_TEST_MODULE coverage
+#include <boost/test/included/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/common/coverage.h"
+
+namespace {
+
+const uint32_t ADDI = 0x00100093;  // addi x1, x0, 1
+const uint32_t BEQ = 0x00000463;   // beq x0, x0, 8
+const uint16_t C_NOP = 0x0001;
+const uint32_t BNE = 0x00009263;   // bne x1, x0, 4
+
+// main.c: line 1 addi at 0x1000, line 2 beq at 0x1004, line 3 c.nop at 0x1008
+// and line 4 bne at 0x100a in the function unused
+Coverage::Image image(int64_t offset) {
+	Coverage::Image image;
+	image.arch = RV32;
+	image.offset = offset;
+
+	std::vector<uint8_t> code;
+	auto emit = [&](uint32_t v, unsigned n) {
+		for (unsigned i = 0; i < n; ++i) code.push_back(v >> (8 * i));
+	};
+	emit(ADDI, 4);
+	emit(BEQ, 4);
+	emit(C_NOP, 2);
+	emit(BNE, 4);
+	image.code.push_back({0x1000, code});
+
+	image.lines.files = {"main.c"};
+	image.lines.ranges = {
+	    {0x1000, 0x1004, 0, 1},
+	    {0x1004, 0x1008, 0, 2},
+	    {0x1008, 0x100a, 0, 3},
+	    {0x100a, 0x100e, 0, 4},
+	};
+	image.symbols = {{"main", 0x1000, 10, true}, {"unused", 0x100a, 4, true}, {"data", 0x1000, 4, false}};
+	return image;
+}
+
+std::string lcov(Coverage &coverage, int64_t offset) {
+	std::ostringstream out;
+	coverage.write(out, {image(offset)}, false);
+	return out.str();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(lcov_lines_and_branches) {
+	Coverage coverage("coverage-test.info", {});
+	coverage.step(0x1000, 0x1004, Instruction(ADDI), Opcode::ADDI);
+	coverage.step(0x1004, 0x1008, Instruction(BEQ), Opcode::BEQ);
+	// trapped, e.g. an ecall, but reached nonetheless
+	coverage.reached(0x1008);
+
+	BOOST_CHECK_EQUAL(lcov(coverage, 0),
+	                  "TN:\n"
+	                  "SF:main.c\n"
+	                  "FN:1,main\n"
+	                  "FN:4,unused\n"
+	                  "FNDA:1,main\n"
+	                  "FNDA:0,unused\n"
+	                  "FNF:2\n"
+	                  "FNH:1\n"
+	                  "BRDA:2,0,0,0\n"
+	                  "BRDA:2,0,1,1\n"
+	                  "BRDA:4,0,0,-\n"
+	                  "BRDA:4,0,1,-\n"
+	                  "BRF:4\n"
+	                  "BRH:1\n"
+	                  "DA:1,1\n"
+	                  "DA:2,1\n"
+	                  "DA:3,1\n"
+	                  "DA:4,0\n"
+	                  "LF:4\n"
+	                  "LH:3\n"
+	                  "end_of_record\n");
+}
+
+BOOST_AUTO_TEST_CASE(lcov_load_offset) {
+	// the ELF is loaded 0x80000000 above its link addresses
+	Coverage coverage("coverage-test.info", {});
+	coverage.step(0x80001004, 0x8000100c, Instruction(BEQ), Opcode::BEQ);
+	coverage.step(0x80001004, 0x80001008, Instruction(BEQ), Opcode::BEQ);
+
+	std::string out = lcov(coverage, 0x80000000);
+	BOOST_CHECK(out.find("BRDA:2,0,0,1\nBRDA:2,0,1,1\n") != std::string::npos);
+	BOOST_CHECK(out.find("BRH:2\n") != std::string::npos);
+	BOOST_CHECK(out.find("DA:1,0\nDA:2,1\nDA:3,0\nDA:4,0\n") != std::string::npos);
+	BOOST_CHECK(out.find("FNDA:0,main\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(code_outside_of_segments_is_ignored) {
+	Coverage coverage("coverage-test.info", {});
+	Coverage::Image i = image(0);
+	i.lines.ranges.push_back({0x2000, 0x2004, 0, 10});
+
+	std::ostringstream out;
+	coverage.write(out, {i}, false);
+	BOOST_CHECK(out.str().find("DA:10,") == std::string::npos);
+	BOOST_CHECK(out.str().find("LF:4\n") != std::string::npos);
+}
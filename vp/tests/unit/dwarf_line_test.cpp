@@ -0,0 +1,197 @@
+#define BOOST_TEST_MODULE dwarf_line
+#include <boost/test/included/unit_test.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/common/dwarf_line.h"
+
+namespace {
+
+// little endian encoder for hand written .debug_line sections
+struct Bytes : std::vector<uint8_t> {
+	Bytes &u8(uint8_t v) {
+		push_back(v);
+		return *this;
+	}
+
+	Bytes &fixed(uint64_t v, unsigned n) {
+		for (unsigned i = 0; i < n; ++i) push_back(v >> (8 * i));
+		return *this;
+	}
+
+	Bytes &uleb(uint64_t v) {
+		do {
+			uint8_t b = v & 0x7f;
+			v >>= 7;
+			push_back(v ? b | 0x80 : b);
+		} while (v);
+		return *this;
+	}
+
+	Bytes &sleb(int64_t v) {
+		bool more;
+		do {
+			uint8_t b = v & 0x7f;
+			v >>= 7;
+			more = !((v == 0 && !(b & 0x40)) || (v == -1 && (b & 0x40)));
+			push_back(more ? b | 0x80 : b);
+		} while (more);
+		return *this;
+	}
+
+	Bytes &str(const std::string &s) {
+		insert(end(), s.begin(), s.end());
+		push_back(0);
+		return *this;
+	}
+
+	Bytes &append(const Bytes &b) {
+		insert(end(), b.begin(), b.end());
+		return *this;
+	}
+};
+
+constexpr int line_base = -5;
+constexpr unsigned line_range = 14;
+constexpr unsigned opcode_base = 13;
+
+// the fields following header_length up to the directory table
+Bytes common_header(unsigned version) {
+	Bytes h;
+	h.u8(1);  // minimum instruction length
+	if (version >= 4)
+		h.u8(1);  // maximum operations per instruction
+	h.u8(1).u8((uint8_t)line_base).u8(line_range).u8(opcode_base);
+	for (uint8_t n : {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1}) h.u8(n);
+	return h;
+}
+
+// a 32 bit DWARF unit
+Bytes unit(unsigned version, const Bytes &header, const Bytes &program) {
+	Bytes u;
+	u.fixed(version, 2);
+	if (version >= 5)
+		u.u8(4).u8(0);  // address and segment selector size
+	u.fixed(header.size(), 4).append(header).append(program);
+	return Bytes().fixed(u.size(), 4).append(u);
+}
+
+uint8_t special(unsigned address_advance, int line_advance) {
+	return opcode_base + (line_advance - line_base) + line_range * address_advance;
+}
+
+Bytes set_address(uint32_t addr) {
+	return Bytes().u8(0).uleb(5).u8(2).fixed(addr, 4);
+}
+
+Bytes end_sequence() {
+	return Bytes().u8(0).uleb(1).u8(1);
+}
+
+void check_range(const DwarfLineTable &t, size_t i, uint64_t start, uint64_t end, const std::string &file,
+                 uint32_t line) {
+	BOOST_REQUIRE_LT(i, t.ranges.size());
+	auto &r = t.ranges[i];
+	BOOST_CHECK_EQUAL(r.start, start);
+	BOOST_CHECK_EQUAL(r.end, end);
+	BOOST_CHECK_EQUAL(t.files.at(r.file), file);
+	BOOST_CHECK_EQUAL(r.line, line);
+}
+
+// files src/a.c and b.c, rows a.c:1 at 0x1000, a.c:2 at 0x1004 and b.c:11 at 0x100a up to 0x100c
+Bytes version4_unit() {
+	Bytes header = common_header(4);
+	header.str("src").str("");
+	header.str("a.c").uleb(1).uleb(0).uleb(0);
+	header.str("b.c").uleb(0).uleb(0).uleb(0);
+	header.str("");
+
+	Bytes program = set_address(0x1000);
+	program.u8(1);                // DW_LNS_copy
+	program.u8(special(4, 1));    // 0x1004, line 2
+	program.u8(4).uleb(2);        // DW_LNS_set_file
+	program.u8(3).sleb(9);        // DW_LNS_advance_line
+	program.u8(2).uleb(6);        // DW_LNS_advance_pc
+	program.u8(1);                // 0x100a, line 11
+	program.u8(2).uleb(2);
+	program.append(end_sequence());
+
+	return unit(4, header, program);
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(version4) {
+	Bytes b = version4_unit();
+	DwarfLineTable t;
+	t.parse({b.data(), b.size()}, {}, {});
+
+	BOOST_REQUIRE_EQUAL(t.ranges.size(), 3u);
+	check_range(t, 0, 0x1000, 0x1004, "src/a.c", 1);
+	check_range(t, 1, 0x1004, 0x100a, "src/a.c", 2);
+	check_range(t, 2, 0x100a, 0x100c, "b.c", 11);
+}
+
+BOOST_AUTO_TEST_CASE(version4_file_zero_is_invalid) {
+	Bytes header = common_header(4);
+	header.str("").str("a.c").uleb(0).uleb(0).uleb(0).str("");
+
+	Bytes program = set_address(0x1000);
+	program.u8(4).uleb(0).u8(1);  // file 0 does not exist before DWARF 5
+	program.u8(2).uleb(4).u8(4).uleb(1).u8(1);
+	program.u8(2).uleb(4).append(end_sequence());
+
+	Bytes b = unit(4, header, program);
+	DwarfLineTable t;
+	t.parse({b.data(), b.size()}, {}, {});
+
+	BOOST_REQUIRE_EQUAL(t.ranges.size(), 1u);
+	check_range(t, 0, 0x1004, 0x1008, "a.c", 1);
+}
+
+BOOST_AUTO_TEST_CASE(version5) {
+	constexpr uint64_t DW_LNCT_path = 1, DW_LNCT_directory_index = 2;
+	constexpr uint64_t DW_FORM_string = 0x08, DW_FORM_line_strp = 0x1f, DW_FORM_udata = 0x0f;
+
+	Bytes line_str = Bytes().str("main.c").str("util.h");
+
+	Bytes header = common_header(5);
+	header.u8(1).uleb(DW_LNCT_path).uleb(DW_FORM_string);
+	header.uleb(2).str("/work").str("inc");
+	header.u8(2).uleb(DW_LNCT_path).uleb(DW_FORM_line_strp).uleb(DW_LNCT_directory_index).uleb(DW_FORM_udata);
+	header.uleb(2).fixed(0, 4).uleb(0).fixed(7, 4).uleb(1);
+
+	Bytes program = set_address(0x2000);
+	program.u8(4).uleb(0).u8(1);  // file numbers start at zero
+	program.u8(special(2, 1));
+	program.u8(4).uleb(1).u8(3).sleb(4).u8(2).uleb(4).u8(1);
+	program.u8(2).uleb(2).append(end_sequence());
+
+	Bytes b = unit(5, header, program);
+	DwarfLineTable t;
+	t.parse({b.data(), b.size()}, {line_str.data(), line_str.size()}, {});
+
+	BOOST_REQUIRE_EQUAL(t.ranges.size(), 3u);
+	check_range(t, 0, 0x2000, 0x2002, "/work/main.c", 1);
+	check_range(t, 1, 0x2002, 0x2006, "/work/main.c", 2);
+	check_range(t, 2, 0x2006, 0x2008, "inc/util.h", 6);
+}
+
+BOOST_AUTO_TEST_CASE(files_are_shared_by_units) {
+	Bytes b = version4_unit();
+	b.append(version4_unit());
+	DwarfLineTable t;
+	t.parse({b.data(), b.size()}, {}, {});
+
+	BOOST_CHECK_EQUAL(t.files.size(), 2u);
+	BOOST_REQUIRE_EQUAL(t.ranges.size(), 6u);
+	check_range(t, 5, 0x100a, 0x100c, "b.c", 11);
+}
+
+BOOST_AUTO_TEST_CASE(truncated_section) {
+	Bytes b = version4_unit();
+	DwarfLineTable t;
+	BOOST_CHECK_THROW(t.parse({b.data(), b.size() - 1}, {}, {}), std::runtime_error);
+}
@@ -0,0 +1,67 @@
+#define BOOST_TEST_MODULE instr_mix
+#include <boost/test/included/unit_test.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "core/common/instr_mix.h"
+#include "core/common/stats.h"
+
+using namespace Opcode;
+
+BOOST_AUTO_TEST_CASE(access_sizes) {
+	for (auto op : {LB, LBU, SB})
+		BOOST_CHECK_EQUAL(InstrMix::access_size(op), 1u);
+	for (auto op : {LH, LHU, SH})
+		BOOST_CHECK_EQUAL(InstrMix::access_size(op), 2u);
+	for (auto op : {LW, LWU, SW, FLW, FSW, LR_W, SC_W, AMOADD_W, AMOMAXU_W})
+		BOOST_CHECK_EQUAL(InstrMix::access_size(op), 4u);
+	for (auto op : {LD, SD, FLD, FSD, LR_D, SC_D, AMOADD_D, AMOMAXU_D})
+		BOOST_CHECK_EQUAL(InstrMix::access_size(op), 8u);
+	for (auto op : {UNDEF, ADD, BEQ, JAL, CSRRW, FENCE, FADD_D})
+		BOOST_CHECK_EQUAL(InstrMix::access_size(op), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(access_sizes_match_classes) {
+	// the report splits the access sizes by the class of the opcode
+	for (unsigned op = 0; op < NUMBER_OF_INSTRUCTIONS; ++op) {
+		auto c = Stats::classify((Mapping)op);
+		bool access = c == Stats::LOAD || c == Stats::STORE || c == Stats::ATOMIC;
+		BOOST_CHECK_MESSAGE(access == (InstrMix::access_size((Mapping)op) != 0), mappingStr[op]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(machine_mode_follows_from_stats) {
+	const char *path = "instr-mix-test.json";
+	HartStats stats;
+	{
+		InstrMix mix(path);
+		HartInstrMix *hart = mix.add_hart(0, stats);
+
+		// the ISS counts into both, HartStats regardless of the privilege level
+		auto exec = [&](PrivilegeLevel prv, Mapping op) {
+			hart->begin(prv, op);
+			++stats.instrs[op];
+		};
+		for (int i = 0; i < 3; ++i) exec(UserMode, ADD);
+		for (int i = 0; i < 2; ++i) exec(MachineMode, ADD);
+		exec(SupervisorMode, LW);
+		exec(MachineMode, BEQ);
+		hart->end(0x100, 0x108, Instruction(0x00000463), BEQ);  // beq x0, x0, 8 taken
+		exec(MachineMode, BNE);
+		hart->end(0x108, 0x10c, Instruction(0x00009463), BNE);  // bne x1, x0, 8 not taken
+	}
+
+	std::ifstream in(path);
+	std::stringstream json;
+	json << in.rdbuf();
+	std::string s = json.str();
+
+	BOOST_CHECK(s.find("\"U\": {\"instructions\": 3, \"opcodes\": {\"ADD\": 3}}") != std::string::npos);
+	BOOST_CHECK(s.find("\"S\": {\"instructions\": 1, \"opcodes\": {\"LW\": 1}}") != std::string::npos);
+	BOOST_CHECK(s.find("\"M\": {\"instructions\": 4, \"opcodes\": {\"ADD\": 2, \"BEQ\": 1, \"BNE\": 1}}") !=
+	            std::string::npos);
+	BOOST_CHECK(s.find("\"load\": {\"1\": 0, \"2\": 0, \"4\": 1, \"8\": 0}") != std::string::npos);
+	BOOST_CHECK(s.find("\"all\": {\"taken\": 1, \"not_taken\": 1, \"taken_ratio\": 0.5}") != std::string::npos);
+}
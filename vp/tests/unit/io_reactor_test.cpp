@@ -0,0 +1,77 @@
+#define BOOST_TEST_MODULE io_reactor
+#include <boost/test/included/unit_test.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#include "platform/common/io_reactor.h"
+
+namespace {
+
+// waits up to a second for the reactor thread
+bool eventually(const std::function<bool(void)> &cond) {
+	for (int i = 0; i < 1000; i++) {
+		if (cond())
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return cond();
+}
+
+struct Pipe {
+	int fds[2];
+
+	Pipe(void) {
+		BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+	}
+
+	~Pipe(void) {
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	void put(void) {
+		char c = 'x';
+		BOOST_REQUIRE_EQUAL(write(fds[1], &c, 1), 1);
+	}
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(failing_handler_is_disabled) {
+	IOReactor &reactor = IOReactor::get();
+	Pipe bad, good;
+	std::atomic<int> bad_calls{0}, good_calls{0};
+
+	// never reads, hence it would be called again and again if not disabled
+	reactor.add(bad.fds[0], EPOLLIN, [&](uint32_t) {
+		bad_calls++;
+		throw std::runtime_error("handler failed");
+	});
+	reactor.add(good.fds[0], EPOLLIN, [&](uint32_t) {
+		char c;
+		if (read(good.fds[0], &c, 1) == 1)
+			good_calls++;
+	});
+
+	bad.put();
+	BOOST_REQUIRE(eventually([&] { return bad_calls > 0; }));
+
+	// the other sources are still served, the failed one neither by
+	// events, nor by wake-ups or after modify
+	reactor.modify(bad.fds[0], EPOLLIN);
+	reactor.wakeup(bad.fds[0]);
+	good.put();
+	BOOST_CHECK(eventually([&] { return good_calls == 1; }));
+	good.put();
+	BOOST_CHECK(eventually([&] { return good_calls == 2; }));
+	BOOST_CHECK_EQUAL(bad_calls, 1);
+
+	reactor.remove(bad.fds[0]);
+	reactor.remove(good.fds[0]);
+}
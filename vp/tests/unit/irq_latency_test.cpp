@@ -0,0 +1,95 @@
+#define BOOST_TEST_MODULE irq_latency
+#include <boost/test/included/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+
+#include "core/common/irq_latency.h"
+
+namespace {
+
+sc_core::sc_time at(uint64_t t) {
+	return sc_core::sc_time::from_value(t);
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(small_values_are_exact) {
+	for (uint64_t v = 0; v < 16; ++v) {
+		BOOST_CHECK_EQUAL(LatencyHistogram::bucket(v), v);
+		BOOST_CHECK_EQUAL(LatencyHistogram::bucket_max(v), v);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(buckets_are_log_linear) {
+	// a copy, the checks take their arguments by reference
+	const unsigned num_buckets = LatencyHistogram::num_buckets;
+
+	// the buckets are contiguous and every one spans at most 1/8 of its values
+	uint64_t lower = 0;
+	for (unsigned i = 0; i < num_buckets; ++i) {
+		uint64_t upper = LatencyHistogram::bucket_max(i);
+		BOOST_REQUIRE_GE(upper, lower);
+		BOOST_CHECK_EQUAL(LatencyHistogram::bucket(lower), i);
+		BOOST_CHECK_EQUAL(LatencyHistogram::bucket(upper), i);
+		BOOST_CHECK_LE(upper - lower, lower / 8);
+		lower = upper + 1;
+	}
+	// the last bucket ends at the largest value, hence lower wrapped around
+	BOOST_CHECK_EQUAL(lower, 0u);
+
+	// 1000 is 0b1111101000, its bucket holds 960..1023
+	BOOST_CHECK_EQUAL(LatencyHistogram::bucket(1000), 63u);
+	BOOST_CHECK_EQUAL(LatencyHistogram::bucket_max(63), 1023u);
+}
+
+BOOST_AUTO_TEST_CASE(percentiles) {
+	LatencyHistogram h;
+	BOOST_CHECK_EQUAL(h.percentile(99), 0u);
+	BOOST_CHECK_EQUAL(h.avg(), 0);
+
+	for (uint64_t v = 1; v <= 100; ++v) h.add(v);
+	BOOST_CHECK_EQUAL(h.count, 100u);
+	BOOST_CHECK_EQUAL(h.min, 1u);
+	BOOST_CHECK_EQUAL(h.max, 100u);
+	BOOST_CHECK_CLOSE(h.avg(), 50.5, 1e-9);
+
+	BOOST_CHECK_EQUAL(h.percentile(1), 1u);
+	// 50 is in the bucket 48..51
+	BOOST_CHECK_EQUAL(h.percentile(50), 51u);
+	// 99 is in the bucket 96..103, the upper bound is clamped to the maximum
+	BOOST_CHECK_EQUAL(h.percentile(99), 100u);
+	BOOST_CHECK_EQUAL(h.percentile(100), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(stages_of_an_interrupt) {
+	// 10 time units per cycle
+	IrqLatency latency(4, 1, at(10));
+
+	latency.trigger(2, at(100));
+	latency.trigger(2, at(110));  // only the first trigger until the claim counts
+	latency.raise(0, at(130));
+	latency.enter(0, at(150));
+	latency.claim(0, 2, at(200));
+	latency.complete(0, 2, at(300));
+
+	// polled, neither raised nor entered after the trigger
+	latency.trigger(3, at(1000));
+	latency.claim(0, 3, at(1040));
+	latency.complete(0, 3, at(1050));
+
+	std::ostringstream out;
+	latency.write_json(out);
+	std::string s = out.str();
+
+	BOOST_CHECK(s.find("{\"irq\": 2, \"trigger_to_raise\": {\"count\": 1, \"min\": 3, \"avg\": 3, \"p99\": 3, \"max\": 3}, "
+	                   "\"trigger_to_entry\": {\"count\": 1, \"min\": 5, \"avg\": 5, \"p99\": 5, \"max\": 5}, "
+	                   "\"trigger_to_claim\": {\"count\": 1, \"min\": 10, \"avg\": 10, \"p99\": 10, \"max\": 10}, "
+	                   "\"claim_to_complete\": {\"count\": 1, \"min\": 10, \"avg\": 10, \"p99\": 10, \"max\": 10}}") !=
+	            std::string::npos);
+	BOOST_CHECK(s.find("{\"irq\": 3, \"trigger_to_raise\": {\"count\": 0}, \"trigger_to_entry\": {\"count\": 0}, "
+	                   "\"trigger_to_claim\": {\"count\": 1, \"min\": 4, \"avg\": 4, \"p99\": 4, \"max\": 4}, "
+	                   "\"claim_to_complete\": {\"count\": 1, \"min\": 1, \"avg\": 1, \"p99\": 1, \"max\": 1}}") !=
+	            std::string::npos);
+	BOOST_CHECK(s.find("\"irq\": 1") == std::string::npos);
+}
@@ -0,0 +1,44 @@
+#define BOOST_TEST_MODULE stats
+#include <boost/test/included/unit_test.hpp>
+
+#include "core/common/stats.h"
+
+using namespace Opcode;
+
+BOOST_AUTO_TEST_CASE(classify_memory_accesses) {
+	for (auto op : {LB, LH, LW, LBU, LHU, LWU, LD, FLW, FLD})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::LOAD);
+	for (auto op : {SB, SH, SW, SD, FSW, FSD})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::STORE);
+	for (auto op : {LR_W, SC_W, AMOSWAP_W, AMOMAXU_W, LR_D, SC_D, AMOADD_D, AMOMAXU_D})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::ATOMIC);
+}
+
+BOOST_AUTO_TEST_CASE(classify_control_flow) {
+	for (auto op : {BEQ, BNE, BLT, BGE, BLTU, BGEU})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::BRANCH);
+	for (auto op : {JAL, JALR})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::JUMP);
+	for (auto op : {UNDEF, FENCE, FENCE_I, ECALL, EBREAK, URET, SRET, MRET, WFI, SFENCE_VMA})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::SYSTEM);
+}
+
+BOOST_AUTO_TEST_CASE(classify_ranges) {
+	// the boundaries of the opcode ranges
+	for (auto op : {MUL, REMU, MULW, REMUW})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::MULDIV);
+	for (auto op : {FMADD_S, FADD_D, FMV_D_X})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::FLOAT);
+	for (auto op : {CSRRW, CSRRS, CSRRC, CSRRWI, CSRRSI, CSRRCI})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::CSR);
+	for (auto op : {LUI, AUIPC, ADDI, ADD, SUB, SRAIW, ADDW, SRAW})
+		BOOST_CHECK_EQUAL(Stats::classify(op), Stats::ALU);
+}
+
+BOOST_AUTO_TEST_CASE(every_opcode_has_a_class) {
+	for (unsigned op = 0; op < NUMBER_OF_INSTRUCTIONS; ++op) {
+		auto c = Stats::classify((Mapping)op);
+		BOOST_CHECK_LT(c, Stats::NUM_INSTR_CLASSES);
+		BOOST_CHECK(Stats::class_name(c) != nullptr);
+	}
+}
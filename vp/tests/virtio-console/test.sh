@@ -0,0 +1,23 @@
+#!/bin/sh
+# UART0 output must still appear when stdin is connected to the
+# virtio console instead of the UART.
+
+set -e
+
+tmpdir=$(mktemp -d)
+trap 'rm -rf "${tmpdir}"' EXIT
+
+riscv64-unknown-elf-as uart.S -o "${tmpdir}/uart.o" -march=rv64i -mabi=lp64
+riscv64-unknown-elf-ld "${tmpdir}/uart.o" -Ttext=0x80000000 -o "${tmpdir}/uart"
+# the program does not use the device tree
+printf '\0\0\0\0' > "${tmpdir}/dtb"
+
+printf "Running UART with virtio console: "
+if linux-vp --intercept-syscalls --virtio-console \
+	--dtb-file "${tmpdir}/dtb" "${tmpdir}/uart" </dev/null 2>/dev/null |
+	grep -q "^uart output with virtio console$"; then
+	printf "OK.\n"
+else
+	printf "FAIL.\n"
+	exit 1
+fi